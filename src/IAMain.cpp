@@ -0,0 +1,63 @@
+//
+//  IAMain.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "Iota.h"
+
+#include "view/IAGUIMain.h"
+#include "printer/IAPrinter.h"
+
+#include <FL/Fl_Tooltip.H>
+
+
+// ==== main() =================================================================
+
+
+/**
+ * Launch our app.
+ *
+ * \todo The whole user interface must be in its own class.
+ */
+int main (int argc, char **argv)
+{
+    Fl::scheme("gtk+");
+  	Fl::args(argc, argv);
+    Fl::set_color(FL_BACKGROUND_COLOR, 0xeeeeee00);
+    Fl::use_high_res_GL(1);
+    Fl_Tooltip::size(12);
+
+    Iota.pPrinterPrototypeList.generatePrototypes();
+    Iota.pCustomPrinterList.loadCustomPrinters(Iota.pCurrentPrinter);
+
+    Iota.gMainWindow = createIotaAppWindow();
+    {
+        char buf[80];
+        snprintf(buf, 79, "Iota Voxel Slicer %s", gVersion);
+        Iota.gMainWindow->copy_label(buf);
+    }
+    if (Iota.gPreferences.pMainWindowX==-1) {
+        Iota.gMainWindow->size(Iota.gPreferences.pMainWindowW,
+                               Iota.gPreferences.pMainWindowH);
+    } else {
+        Iota.gMainWindow->resize(Iota.gPreferences.pMainWindowX,
+                                 Iota.gPreferences.pMainWindowY,
+                                 Iota.gPreferences.pMainWindowW,
+                                 Iota.gPreferences.pMainWindowH);
+    }
+    Iota.pCustomPrinterList.updatePrinterSelectMenu();
+    int currentPrinter = Iota.gPreferences.pCurrentPrinterIndex;
+    if (currentPrinter>=Iota.pCustomPrinterList.size())
+        currentPrinter = 0;
+    wPrinterChoice->value(currentPrinter);
+    Iota.pCurrentPrinter = Iota.pCustomPrinterList[currentPrinter];
+    Iota.pCurrentPrinter->buildSessionSettings(wSessionSettings);
+    Iota.gMainWindow->show();
+
+    Iota.loadDemoFiles();
+    gSceneView->redraw();
+
+    return Fl::run();
+}
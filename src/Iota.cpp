@@ -14,6 +14,7 @@
 #include "fileformats/IAFmtObj3ds.h"
 #include "fileformats/IAGeometryReader.h"
 #include "fileformats/IAGeometryReaderBinaryStl.h"
+#include "fileformats/IAGeometryReaderMeshCache.h"
 #include "opengl/IAFramebuffer.h"
 #include "toolpath/IAToolpath.h"
 #include "printer/IAPrinter.h"
@@ -22,7 +23,6 @@
 #include <FL/fl_ask.H>
 #include <FL/fl_utf8.h>
 #include <FL/Fl_Native_File_Chooser.H>
-#include <FL/Fl_Tooltip.H>
 
 #include <errno.h>
 
@@ -44,10 +44,6 @@ IAVersioneer gVersioneer;
  */
 const char *gVersion = /*[ver*/"v0.3.2b"/*]*/;
 
-//const int kFramebufferSize = 2048;
-//const int kFramebufferSize = 4096;
-const int kFramebufferSize = 214*20;
-
 #ifdef __APPLE__
 #pragma mark -
 #endif
@@ -452,14 +448,29 @@ bool IAIota::addGeometry(const char *name, uint8_t *data, size_t size)
 /**
  * Read a geometry from an external file.
  *
+ * If the same file was loaded before, the mesh is restored from the mesh
+ * cache. Otherwise, the file is read and the resulting mesh is written to
+ * the cache.
+ *
  * \param filename the extension of the file name is used to help determine the file type
  */
 bool IAIota::addGeometry(const char *filename)
 {
     bool ret = false;
-    auto reader = IAGeometryReader::findReaderFor(filename);
-    if (reader)
+    auto reader = IAGeometryReaderMeshCache::findReaderFor(filename);
+    if (reader) {
         ret = addGeometry(reader);
+        if (pMesh)
+            return ret;
+        // the cache was damaged, so read the original file instead
+        Error.clear();
+    }
+    reader = IAGeometryReader::findReaderFor(filename);
+    if (reader) {
+        ret = addGeometry(reader);
+        if (pMesh)
+            IAGeometryReaderMeshCache::write(filename, pMesh);
+    }
     return ret;
 }
 
@@ -502,54 +513,3 @@ void IAIota::loadDemoFiles()
 }
 
 
-#ifdef __APPLE__
-#pragma mark -
-#endif
-// ==== main() =================================================================
-
-
-/**
- * Launch our app.
- *
- * \todo The whole user interface must be in its own class.
- */
-int main (int argc, char **argv)
-{
-    Fl::scheme("gtk+");
-  	Fl::args(argc, argv);
-    Fl::set_color(FL_BACKGROUND_COLOR, 0xeeeeee00);
-    Fl::use_high_res_GL(1);
-    Fl_Tooltip::size(12);
-
-    Iota.pPrinterPrototypeList.generatePrototypes();
-    Iota.pCustomPrinterList.loadCustomPrinters(Iota.pCurrentPrinter);
-
-    Iota.gMainWindow = createIotaAppWindow();
-    {
-        char buf[80];
-        snprintf(buf, 79, "Iota Voxel Slicer %s", gVersion);
-        Iota.gMainWindow->copy_label(buf);
-    }
-    if (Iota.gPreferences.pMainWindowX==-1) {
-        Iota.gMainWindow->size(Iota.gPreferences.pMainWindowW,
-                               Iota.gPreferences.pMainWindowH);
-    } else {
-        Iota.gMainWindow->resize(Iota.gPreferences.pMainWindowX,
-                                 Iota.gPreferences.pMainWindowY,
-                                 Iota.gPreferences.pMainWindowW,
-                                 Iota.gPreferences.pMainWindowH);
-    }
-    Iota.pCustomPrinterList.updatePrinterSelectMenu();
-    int currentPrinter = Iota.gPreferences.pCurrentPrinterIndex;
-    if (currentPrinter>=Iota.pCustomPrinterList.size())
-        currentPrinter = 0;
-    wPrinterChoice->value(currentPrinter);
-    Iota.pCurrentPrinter = Iota.pCustomPrinterList[currentPrinter];
-    Iota.pCurrentPrinter->buildSessionSettings(wSessionSettings);
-    Iota.gMainWindow->show();
-
-    Iota.loadDemoFiles();
-    gSceneView->redraw();
-
-    return Fl::run();
-}
@@ -34,20 +34,6 @@ class IAPrinter;
  */
 extern const char *gVersion;
 
-/**
- * The resolution of all frame buffer objects.
- * 1024 is pretty much the minimum. 2048 brings ok results. At 4096,
- * tool paths are really nice, but rendering time slows down considerably.
- * At higher resolutions, tool paths are perfect, but rendering time and
- * memory usage explode.
- *
- * \todo nothing is optimized here yet. There is a great potential for
- *        accelerating, manly potrace, and reduced memory allocation by
- *        smart clipping.
- * \todo draw scene viewer with antaliasing!
- */
-extern const int kFramebufferSize;
-
 /**
  * temp kludge
  * \todo these are currently only for testing textures, but should be removed.
@@ -0,0 +1,143 @@
+//
+//  IAParallel.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IAParallel.h"
+
+
+/// set in threads that are running tasks of a job, so that jobs don't nest
+static thread_local bool tInTask = false;
+
+
+/**
+ * Get the pool that all parallel loops share.
+ *
+ * The workers are started when the pool is used for the first time.
+ *
+ * \return the pool
+ */
+IAThreadPool &IAThreadPool::shared()
+{
+    static IAThreadPool pool;
+    return pool;
+}
+
+
+/**
+ * Start one worker less than there are hardware threads.
+ */
+IAThreadPool::IAThreadPool()
+{
+    unsigned int n = ia_num_threads();
+    for (unsigned int i=1; i<n; i++)
+        pWorker.emplace_back(&IAThreadPool::work, this);
+}
+
+
+/**
+ * End all workers.
+ */
+IAThreadPool::~IAThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(pMutex);
+        pQuit = true;
+    }
+    pWake.notify_all();
+    for (auto &t: pWorker) t.join();
+}
+
+
+/**
+ * Run a number of tasks in parallel, and wait until all of them are done.
+ *
+ * Tasks are taken in order by the caller and by all workers, one at a time.
+ *
+ * \param nTasks number of tasks
+ * \param task called as task(i) for every i in [0, nTasks)
+ */
+void IAThreadPool::run(size_t nTasks, std::function<void(size_t)> const& task)
+{
+    if (nTasks==0) return;
+    bool expected = false;
+    if (nTasks==1 || pWorker.empty() || tInTask
+        || !pBusy.compare_exchange_strong(expected, true))
+    {
+        for (size_t i=0; i<nTasks; i++) task(i);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(pMutex);
+        pTask = &task;
+        pNTasks = nTasks;
+        pNFinished = 0;
+        pNext = 0;
+        pGeneration++;
+    }
+    pWake.notify_all();
+    runTasks(task, nTasks);
+    {
+        // workers that joined late must be done before the task goes away
+        std::unique_lock<std::mutex> lock(pMutex);
+        pDone.wait(lock, [this]{ return pNFinished==pNTasks && pNActive==0; });
+        pTask = nullptr;
+    }
+    pBusy = false;
+}
+
+
+/**
+ * Take tasks of the current job until there are none left.
+ *
+ * \param task the current job
+ * \param nTasks number of tasks in the job
+ */
+void IAThreadPool::runTasks(std::function<void(size_t)> const& task, size_t nTasks)
+{
+    tInTask = true;
+    size_t nDone = 0;
+    for (;;) {
+        size_t i = pNext++;
+        if (i>=nTasks) break;
+        task(i);
+        nDone++;
+    }
+    tInTask = false;
+    if (nDone) {
+        std::lock_guard<std::mutex> lock(pMutex);
+        pNFinished += nDone;
+    }
+}
+
+
+/**
+ * Wait for jobs and help running them, until the pool is deleted.
+ */
+void IAThreadPool::work()
+{
+    unsigned long seen = 0;
+    for (;;) {
+        std::function<void(size_t)> const* task;
+        size_t nTasks;
+        {
+            std::unique_lock<std::mutex> lock(pMutex);
+            pWake.wait(lock, [&]{ return pQuit || pGeneration!=seen; });
+            if (pQuit) return;
+            seen = pGeneration;
+            // the job may be over already
+            if (!pTask) continue;
+            task = pTask;
+            nTasks = pNTasks;
+            pNActive++;
+        }
+        runTasks(*task, nTasks);
+        {
+            std::lock_guard<std::mutex> lock(pMutex);
+            pNActive--;
+        }
+        pDone.notify_all();
+    }
+}
@@ -0,0 +1,158 @@
+//
+//  IAParallel.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_PARALLEL_H
+#define IA_PARALLEL_H
+
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <algorithm>
+#include <stddef.h>
+
+
+/**
+ * Number of worker threads for parallel loops.
+ *
+ * \return the number of hardware threads, but at least one
+ */
+inline unsigned int ia_num_threads()
+{
+    unsigned int n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+
+/**
+ Worker threads that run the chunks of parallel loops.
+
+ Starting and joining threads for every loop costs more than many of the
+ loops themselves, so the workers are started once, and then wait for jobs.
+ The thread that starts a job runs tasks as well, until all tasks are done.
+
+ Jobs don't nest: a job that is started from within a task, or while another
+ thread runs a job, runs all its tasks in the calling thread.
+ */
+class IAThreadPool
+{
+public:
+    static IAThreadPool &shared();
+
+    void run(size_t nTasks, std::function<void(size_t)> const& task);
+
+    /** Threads that run tasks, including the caller. \return number of threads */
+    size_t size() const { return pWorker.size()+1; }
+
+private:
+    IAThreadPool();
+    ~IAThreadPool();
+    void work();
+    void runTasks(std::function<void(size_t)> const& task, size_t nTasks);
+
+    /// threads that wait for jobs; the caller of run() is not in here
+    std::vector<std::thread> pWorker;
+    /// guards all members below, except pNext and pBusy
+    std::mutex pMutex;
+    /// wakes the workers for a new job, or to quit
+    std::condition_variable pWake;
+    /// wakes the caller of run() when all tasks are done
+    std::condition_variable pDone;
+    /// the current job, or nullptr
+    std::function<void(size_t)> const* pTask = nullptr;
+    /// number of tasks in the current job
+    size_t pNTasks = 0;
+    /// tasks that are done
+    size_t pNFinished = 0;
+    /// workers that are running tasks of the current job
+    size_t pNActive = 0;
+    /// counts the jobs, so that workers know that a new one arrived
+    unsigned long pGeneration = 0;
+    /// set to end all workers
+    bool pQuit = false;
+    /// index of the next task that no thread has taken yet
+    std::atomic<size_t> pNext { 0 };
+    /// set while a job is running
+    std::atomic<bool> pBusy { false };
+};
+
+
+/**
+ * Run a function on contiguous ranges of [0, n) in parallel.
+ *
+ * The range is split into one chunk per thread of the shared IAThreadPool.
+ * Small ranges are handled in the calling thread.
+ *
+ * \param n number of elements
+ * \param fn called as fn(begin, end) for every chunk
+ * \param minChunk never create chunks smaller than this
+ */
+template <class F>
+void ia_parallel_for(size_t n, F fn, size_t minChunk = 4096)
+{
+    size_t nThreads = ia_num_threads();
+    if (minChunk<1) minChunk = 1;
+    nThreads = std::min(nThreads, (n+minChunk-1)/minChunk);
+    if (nThreads<=1) {
+        if (n) fn((size_t)0, n);
+        return;
+    }
+    size_t chunk = (n+nThreads-1)/nThreads;
+    IAThreadPool::shared().run((n+chunk-1)/chunk, [&](size_t i) {
+        fn(i*chunk, std::min(n, (i+1)*chunk));
+    });
+}
+
+
+/**
+ * Sort a vector using all available threads.
+ *
+ * Every thread of the shared IAThreadPool sorts one chunk, then neighbouring
+ * chunks are merged in parallel until a single sorted range remains.
+ *
+ * \param v the vector to sort
+ * \param cmp strict weak ordering, as for std::sort
+ */
+template <class T, class Cmp>
+void ia_parallel_sort(std::vector<T> &v, Cmp cmp)
+{
+    size_t n = v.size();
+    size_t nThreads = std::min((size_t)ia_num_threads(), n/16384);
+    if (nThreads<=1) {
+        std::sort(v.begin(), v.end(), cmp);
+        return;
+    }
+
+    size_t chunk = (n+nThreads-1)/nThreads;
+    std::vector<size_t> bounds;
+    for (size_t b=0; b<n; b+=chunk) bounds.push_back(b);
+    bounds.push_back(n);
+
+    IAThreadPool::shared().run(bounds.size()-1, [&](size_t i) {
+        std::sort(v.begin()+bounds[i], v.begin()+bounds[i+1], cmp);
+    });
+
+    while (bounds.size()>2) {
+        // merge pairs of neighbouring chunks, an odd chunk at the end stays
+        size_t nPairs = (bounds.size()-1)/2;
+        IAThreadPool::shared().run(nPairs, [&](size_t i) {
+            std::inplace_merge(v.begin()+bounds[2*i], v.begin()+bounds[2*i+1],
+                               v.begin()+bounds[2*i+2], cmp);
+        });
+        std::vector<size_t> merged;
+        for (size_t i=0; i<bounds.size(); i+=2) merged.push_back(bounds[i]);
+        if (merged.back()!=n) merged.push_back(n);
+        bounds.swap(merged);
+    }
+}
+
+
+#endif /* IA_PARALLEL_H */
+
+
@@ -23,6 +23,10 @@ IAPreferences::IAPreferences()
     pPrefs.getUserdataPath(buf, sizeof(buf));
     strcat(buf, "printerDefinitions/");
     pPrinterDefinitionsPath = strdup(buf);
+    buf[0] = 0;
+    pPrefs.getUserdataPath(buf, sizeof(buf));
+    strcat(buf, "meshCache/");
+    pMeshCachePath = strdup(buf);
 
     Fl_Preferences main(pPrefs, "main");
 
@@ -40,6 +44,9 @@ IAPreferences::IAPreferences()
     updateRecentfilesMenu();
 
     main.get("recentPrinterIndex", pCurrentPrinterIndex, 0);
+    main.get("coreCacheSize", pCoreCacheSize, 256);
+    main.get("meshCacheSize", pMeshCacheSize, 1024);
+    main.get("logSliceStats", pLogSliceStats, 0);
 }
 
 
@@ -50,6 +57,7 @@ IAPreferences::~IAPreferences()
 {
     flush();
     if (pPrinterDefinitionsPath) ::free((void*)pPrinterDefinitionsPath);
+    if (pMeshCachePath) ::free((void*)pMeshCachePath);
 }
 
 
@@ -75,6 +83,9 @@ void IAPreferences::flush()
     }
 
     main.set("recentPrinterIndex", wPrinterChoice->value());
+    main.set("coreCacheSize", pCoreCacheSize);
+    main.set("meshCacheSize", pMeshCacheSize);
+    main.set("logSliceStats", pLogSliceStats);
 
     pPrefs.flush();
 }
@@ -167,3 +178,14 @@ const char *IAPreferences::printerDefinitionsPath() const
     return pPrinterDefinitionsPath;
 }
 
+
+/**
+ * Get a file path for storing cached copies of imported meshes.
+ *
+ * \return path to a directory in the user data area.
+ */
+const char *IAPreferences::meshCachePath() const
+{
+    return pMeshCachePath;
+}
+
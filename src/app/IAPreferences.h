@@ -28,6 +28,7 @@ public:
     void addRecentFile(const char *filename);
     void clearRecentFileList();
     const char *printerDefinitionsPath() const;
+    const char *meshCachePath() const;
 
     /** main window position, or -1 if undefined. */
     int pMainWindowX = -1;
@@ -43,8 +44,16 @@ public:
     char *pRecentFile[pNRecentFiles] = { 0 };
     /** write preferences for individual printers here */
     char *pPrinterDefinitionsPath = nullptr;
+    /** cached copies of imported meshes are stored here */
+    char *pMeshCachePath = nullptr;
     /** stor ethe index of the currently selected printer of the printer list */
     int pCurrentPrinterIndex = 0;
+    /** memory budget for core patterns of sliced layers in MB */
+    int pCoreCacheSize = 256;
+    /** size limit of the mesh cache directory in MB */
+    int pMeshCacheSize = 1024;
+    /** print cache and framebuffer statistics after slicing all layers */
+    int pLogSliceStats = 0;
 };
 
 
@@ -43,6 +43,12 @@ protected:
     bool wordIs(const char *);
     void printWord();
 
+    /** Direct access to the data at the current read position.
+     \return pointer into the file data, don't free(). */
+    const uint8_t *currentData() const { return pCurrData; }
+    /** Number of bytes from the current read position to the end of the data.
+     \return remaining size in bytes */
+    size_t remainingSize() const { return pSize - (size_t)(pCurrData-pData); }
     /** Filename for this reader.
      \return a ponter to the filename, don't free(). */
     const char *getName() const { return pName; }
@@ -9,11 +9,13 @@
 
 #include "Iota.h"
 #include "geometry/IAMesh.h"
+#include "app/IAParallel.h"
 
 #include <FL/fl_utf8.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <string.h>
 
 #ifdef _WIN32
 # include <io.h>
@@ -174,6 +176,11 @@ IAGeometryReaderBinaryStl::~IAGeometryReaderBinaryStl()
 /**
  * Interprete the geometry data and create a mesh list.
  *
+ * Binary STL files are a list of fixed size records, so decoding is split
+ * across all available threads. Vertices are welded and the mesh topology is
+ * created in parallel as well. The resulting mesh is identical to adding
+ * the vertices and triangles one by one.
+ *
  * \return nullptr, if the mesh could not be generated
  *
  * \todo fix seams
@@ -186,35 +193,24 @@ IAMesh *IAGeometryReaderBinaryStl::load()
 
     skip(80);
     uint32_t nTriangle = getUInt32LSB();
-    for (int i=0; i<nTriangle; i++) {
-        float x, y, z;
-        IAVertex *p1, *p2, *p3;
-        // face normal
-        getFloatLSB();
-        getFloatLSB();
-        getFloatLSB();
-        // point 1
-        x = getFloatLSB();
-        y = getFloatLSB();
-        z = getFloatLSB();
-        p1 = msh->findOrAddNewVertex(IAVector3d(x, y, z));
-        p1->pTex.set(x*0.8+0.5, -z*0.8+0.5, 0.0);
-        // point 2
-        x = getFloatLSB();
-        y = getFloatLSB();
-        z = getFloatLSB();
-        p2 = msh->findOrAddNewVertex(IAVector3d(x, y, z));
-        p2->pTex.set(x*0.8+0.5, -z*0.8+0.5, 0.0);
-        // point 3
-        x = getFloatLSB();
-        y = getFloatLSB();
-        z = getFloatLSB();
-        p3 = msh->findOrAddNewVertex(IAVector3d(x, y, z));
-        p3->pTex.set(x*0.8+0.5, -z*0.8+0.5, 0.0);
-        // add face
-        msh->addNewTriangle(p1, p2, p3);
-        // color
-        getUInt16LSB(); // color information, if there was a standard
+    const uint8_t *records = currentData();
+
+    // copy the vertex coordinates out of the 50 byte records; STL stores
+    // little endian floats, which is what getFloatLSB() assumes as well
+    std::vector<float> coords(9*(size_t)nTriangle);
+    ia_parallel_for(nTriangle, [&coords, records](size_t b, size_t e) {
+        for (size_t i=b; i<e; i++)
+            memcpy(&coords[9*i], records + 50*i + 12, 9*sizeof(float));
+    });
+
+    // closed meshes have about half as many vertices as triangles
+    msh->vertexMap.reserve(nTriangle/2);
+    std::vector<uint32_t> corners;
+    if (weldVertices(msh, coords, corners)) {
+        msh->addNewTriangles(corners);
+    } else {
+        msh->clear();
+        weldAndAddTriangles(msh, coords);
     }
 
     if (!msh->validate()) {
@@ -228,3 +224,107 @@ IAMesh *IAGeometryReaderBinaryStl::load()
 }
 
 
+/**
+ * Find all unique vertices and create them in the order of first appearance.
+ *
+ * All corners are sorted in parallel by their exact coordinates, so that
+ * identical points form groups. Only the first point of every group is then
+ * welded against the vertex map. If two different points are within the
+ * welding tolerance, the result could differ from welding every corner in
+ * file order, and this function gives up.
+ *
+ * \param msh add the vertices to this mesh
+ * \param coords nine coordinates per triangle
+ * \param corners receives the index into vertexList for every corner
+ *
+ * \return false, if the points need to be welded one by one
+ */
+bool IAGeometryReaderBinaryStl::weldVertices(IAMesh *msh, std::vector<float> const& coords, std::vector<uint32_t> &corners)
+{
+    struct Point { uint32_t x, y, z, index; };
+    size_t nc = coords.size()/3;
+
+    std::vector<Point> points(nc);
+    ia_parallel_for(nc, [&points, &coords](size_t b, size_t e) {
+        for (size_t i=b; i<e; i++) {
+            uint32_t k[3];
+            memcpy(k, &coords[3*i], sizeof(k));
+            // -0.0 and 0.0 are the same point
+            for (int j=0; j<3; j++) if (k[j]==0x80000000) k[j] = 0;
+            points[i] = { k[0], k[1], k[2], (uint32_t)i };
+        }
+    });
+    ia_parallel_sort(points, [](Point const& a, Point const& b) {
+        if (a.x!=b.x) return a.x<b.x;
+        if (a.y!=b.y) return a.y<b.y;
+        if (a.z!=b.z) return a.z<b.z;
+        return a.index<b.index;
+    });
+
+    // the first point in every group is its first appearance in the file
+    std::vector<uint32_t> firstCorner;
+    std::vector<uint32_t> groupStart;
+    for (size_t i=0; i<nc; i++) {
+        if (i==0 || points[i].x!=points[i-1].x || points[i].y!=points[i-1].y || points[i].z!=points[i-1].z) {
+            groupStart.push_back((uint32_t)i);
+            firstCorner.push_back(points[i].index);
+        }
+    }
+    groupStart.push_back((uint32_t)nc);
+    size_t ng = firstCorner.size();
+
+    // create vertices in the same order as the serial loader would
+    std::vector<uint32_t> order(ng);
+    for (size_t i=0; i<ng; i++) order[i] = (uint32_t)i;
+    ia_parallel_sort(order, [&firstCorner](uint32_t a, uint32_t b) {
+        return firstCorner[a]<firstCorner[b];
+    });
+    std::vector<uint32_t> vertexOfGroup(ng);
+    msh->vertexList.reserve(ng);
+    for (size_t i=0; i<ng; i++) {
+        uint32_t g = order[i];
+        const float *c = &coords[3*firstCorner[g]];
+        IAVector3d pos(c[0], c[1], c[2]);
+        if (msh->vertexMap.find(pos))
+            return false;
+        IAVertex *v = msh->newVertex();
+        v->pLocalPosition = pos;
+        v->pTex.set(c[0]*0.8+0.5, -c[2]*0.8+0.5, 0.0);
+        msh->updateBoundingBox(pos);
+        msh->vertexList.push_back(v);
+        msh->vertexMap.insert(v);
+        vertexOfGroup[g] = (uint32_t)i;
+    }
+
+    corners.resize(nc);
+    ia_parallel_for(ng, [&](size_t b, size_t e) {
+        for (size_t g=b; g<e; g++)
+            for (uint32_t i=groupStart[g]; i<groupStart[g+1]; i++)
+                corners[points[i].index] = vertexOfGroup[g];
+    }, 1024);
+
+    return true;
+}
+
+
+/**
+ * Weld every corner in file order and add the triangles one by one.
+ *
+ * \param msh add vertices and triangles to this mesh
+ * \param coords nine coordinates per triangle
+ */
+void IAGeometryReaderBinaryStl::weldAndAddTriangles(IAMesh *msh, std::vector<float> const& coords)
+{
+    size_t nTriangle = coords.size()/9;
+    for (size_t i=0; i<nTriangle; i++) {
+        IAVertex *p[3];
+        for (int j=0; j<3; j++) {
+            float x = coords[9*i+3*j], y = coords[9*i+3*j+1], z = coords[9*i+3*j+2];
+            p[j] = msh->findOrAddNewVertex(IAVector3d(x, y, z));
+            p[j]->pTex.set(x*0.8+0.5, -z*0.8+0.5, 0.0);
+        }
+        msh->addNewTriangle(p[0], p[1], p[2]);
+    }
+}
+
+
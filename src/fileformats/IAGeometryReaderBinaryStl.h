@@ -26,6 +26,10 @@ public:
     IAGeometryReaderBinaryStl(const char *filename);
     virtual ~IAGeometryReaderBinaryStl() override;
     virtual IAMesh *load() override;
+
+private:
+    bool weldVertices(IAMesh *msh, std::vector<float> const& coords, std::vector<uint32_t> &corners);
+    void weldAndAddTriangles(IAMesh *msh, std::vector<float> const& coords);
 };
 
 
@@ -0,0 +1,434 @@
+//
+//  IAGeometryReaderMeshCache.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IAGeometryReaderMeshCache.h"
+
+#include "Iota.h"
+#include "geometry/IAMesh.h"
+
+#include <FL/fl_utf8.h>
+#include <FL/filename.H>
+
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <sys/stat.h>
+#include <string.h>
+#include <stddef.h>
+
+#ifdef _WIN32
+# include <sys/utime.h>
+# define utime _utime
+#else
+# include <utime.h>
+#endif
+
+
+static const char kMagic[8] = { 'I', 'A', 'M', 'E', 'S', 'H', '\r', '\n' };
+static const uint32_t kByteOrder = 0x01020304;
+static const uint32_t kNoTwin = 0xFFFFFFFF;
+
+
+/**
+ * Find a valid cache file for the given source file.
+ *
+ * \param sourceFilename the model file that the user wants to load
+ *
+ * \return a reader for the cache file, or nullptr if there is no cache file
+ *      or if it does not match the source file. No error is set.
+ */
+std::shared_ptr<IAGeometryReader> IAGeometryReaderMeshCache::findReaderFor(const char *sourceFilename)
+{
+    uint64_t size;
+    int64_t time;
+    if (!statFile(sourceFilename, size, time))
+        return nullptr;
+
+    char cacheName[FL_PATH_MAX];
+    cacheFilename(cacheName, sizeof(cacheName), sourceFilename);
+    struct stat st;
+    if (fl_stat(cacheName, &st)!=0 || (size_t)st.st_size<sizeof(Header))
+        return nullptr;
+
+    auto reader = std::make_shared<IAGeometryReaderMeshCache>(cacheName);
+    if (reader->remainingSize()!=(size_t)st.st_size)
+        return nullptr;
+    const Header *hdr = (const Header*)reader->currentData();
+    if (   memcmp(hdr->magic, kMagic, sizeof(kMagic))!=0
+        || hdr->version!=kVersion
+        || hdr->byteOrder!=kByteOrder
+        || hdr->sourceSize!=size
+        || expectedSize(hdr->nVertex, hdr->nTriangle)!=(size_t)st.st_size)
+    {
+        printf("Mesh cache file %s is outdated or damaged.\n", cacheName);
+        return nullptr;
+    }
+    if (hdr->sourceTime!=time) {
+        // the source file was touched or copied, so only its content can
+        // tell if it changed
+        uint64_t hash;
+        if (!hashFile(sourceFilename, hash, size) || hash!=hdr->sourceHash || size!=hdr->sourceSize) {
+            printf("Mesh cache file %s is outdated or damaged.\n", cacheName);
+            return nullptr;
+        }
+        // remember the new time, so the next lookup is quick again
+        FILE *f = fl_fopen(cacheName, "r+b");
+        if (f) {
+            fseek(f, (long)offsetof(Header, sourceTime), SEEK_SET);
+            fwrite(&time, sizeof(time), 1, f);
+            fclose(f);
+        }
+    }
+    markUsed(cacheName);
+    return reader;
+}
+
+
+/**
+ * Write a fully loaded and repaired mesh into the cache.
+ *
+ * \param sourceFilename the model file that the mesh was loaded from
+ * \param mesh the mesh as it was returned by the file reader
+ *
+ * \return false, if the cache file could not be written. This is not an error.
+ */
+bool IAGeometryReaderMeshCache::write(const char *sourceFilename, IAMesh *mesh)
+{
+    if (!mesh) return false;
+    size_t nv = mesh->vertexList.size(), nt = mesh->triangleList.size();
+    if (nv>=kNoTwin || 3*nt>=kNoTwin || mesh->edgeList.size()!=3*nt)
+        return false;
+
+    Header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    uint64_t size;
+    if (   !statFile(sourceFilename, size, hdr.sourceTime)
+        || !hashFile(sourceFilename, hdr.sourceHash, hdr.sourceSize)
+        || size!=hdr.sourceSize)
+        return false;
+    memcpy(hdr.magic, kMagic, sizeof(kMagic));
+    hdr.version = kVersion;
+    hdr.byteOrder = kByteOrder;
+    hdr.nVertex = (uint32_t)nv;
+    hdr.nTriangle = (uint32_t)nt;
+    for (int i=0; i<3; i++) {
+        hdr.min[i] = mesh->pMin.dataPointer()[i];
+        hdr.max[i] = mesh->pMax.dataPointer()[i];
+    }
+
+    // collect all data in the final layout
+    std::vector<double> pos(3*nv), tex(3*nv), nrm(3*nv), tNrm(3*nt);
+    std::vector<int32_t> nNrm(nv);
+    std::vector<uint32_t> tri(3*nt), twin(3*nt);
+    std::unordered_map<IAVertex*, uint32_t> vertexIndex;
+    vertexIndex.reserve(nv);
+    for (size_t i=0; i<nv; i++) {
+        IAVertex *v = mesh->vertexList[i];
+        vertexIndex[v] = (uint32_t)i;
+        memcpy(&pos[3*i], v->pLocalPosition.dataPointer(), 3*sizeof(double));
+        memcpy(&tex[3*i], v->pTex.dataPointer(), 3*sizeof(double));
+        memcpy(&nrm[3*i], v->pNormal.dataPointer(), 3*sizeof(double));
+        nNrm[i] = v->pNNormal;
+    }
+    std::unordered_map<IAHalfEdge*, uint32_t> edgeIndex;
+    edgeIndex.reserve(3*nt);
+    for (size_t i=0; i<nt; i++) {
+        IATriangle *t = mesh->triangleList[i];
+        memcpy(&tNrm[3*i], t->pNormal.dataPointer(), 3*sizeof(double));
+        for (int j=0; j<3; j++) {
+            // the half-edge list must be in triangle order to be restored
+            if (mesh->edgeList[3*i+j]!=t->edge(j))
+                return false;
+            edgeIndex[t->edge(j)] = (uint32_t)(3*i+j);
+            tri[3*i+j] = vertexIndex[t->vertex(j)];
+        }
+    }
+    for (size_t i=0; i<3*nt; i++) {
+        IAHalfEdge *e = mesh->edgeList[i]->twin();
+        twin[i] = e ? edgeIndex[e] : kNoTwin;
+    }
+
+    // write to a temporary file first, so that a crash can not leave a
+    // damaged cache file
+    const char *path = Iota.gPreferences.meshCachePath();
+    if (path) fl_make_path(path);
+    char cacheName[FL_PATH_MAX], tmpName[FL_PATH_MAX];
+    cacheFilename(cacheName, sizeof(cacheName), sourceFilename);
+    snprintf(tmpName, sizeof(tmpName), "%s.tmp", cacheName);
+    FILE *f = fl_fopen(tmpName, "wb");
+    if (!f) {
+        printf("Can't write mesh cache file %s.\n", tmpName);
+        return false;
+    }
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, f)==1;
+    if (nv) {
+        ok = ok && fwrite(pos.data(), sizeof(double), pos.size(), f)==pos.size();
+        ok = ok && fwrite(tex.data(), sizeof(double), tex.size(), f)==tex.size();
+        ok = ok && fwrite(nrm.data(), sizeof(double), nrm.size(), f)==nrm.size();
+    }
+    if (nt)
+        ok = ok && fwrite(tNrm.data(), sizeof(double), tNrm.size(), f)==tNrm.size();
+    if (nv)
+        ok = ok && fwrite(nNrm.data(), sizeof(int32_t), nNrm.size(), f)==nNrm.size();
+    if (nt) {
+        ok = ok && fwrite(tri.data(), sizeof(uint32_t), tri.size(), f)==tri.size();
+        ok = ok && fwrite(twin.data(), sizeof(uint32_t), twin.size(), f)==twin.size();
+    }
+    if (fclose(f)!=0) ok = false;
+    if (ok) {
+        fl_unlink(cacheName);
+        ok = (fl_rename(tmpName, cacheName)==0);
+    }
+    if (!ok) {
+        printf("Can't write mesh cache file %s.\n", cacheName);
+        fl_unlink(tmpName);
+    }
+    trim((uint64_t)Iota.gPreferences.pMeshCacheSize<<20);
+    return ok;
+}
+
+
+/**
+ * Create a reader for a cache file.
+ *
+ * The cache file is mapped into memory.
+ *
+ * \param cacheFilename read this file
+ */
+IAGeometryReaderMeshCache::IAGeometryReaderMeshCache(const char *cacheFilename)
+:   IAGeometryReader(cacheFilename)
+{
+}
+
+
+/**
+ * Release resources.
+ */
+IAGeometryReaderMeshCache::~IAGeometryReaderMeshCache()
+{
+}
+
+
+/**
+ * Restore the mesh from the cache file.
+ *
+ * Vertices, triangles, and half-edges are allocated in one go, and linked by
+ * their indices. The mesh was validated and repaired before it was written,
+ * so there is no need to do that again. Only the indices are checked, and
+ * every pair of twins must run in opposite directions between the same two
+ * vertices.
+ *
+ * \return nullptr, if the cache file is damaged
+ */
+IAMesh *IAGeometryReaderMeshCache::load()
+{
+    const uint8_t *data = currentData();
+    const Header *hdr = (const Header*)data;
+    uint32_t nv = hdr->nVertex, nt = hdr->nTriangle;
+    if (expectedSize(nv, nt)!=remainingSize()) {
+        Iota.Error.set("Mesh cache reader", IAError::FileContentCorrupt_STR, getName());
+        return nullptr;
+    }
+
+    const double *pos = (const double*)(data + sizeof(Header));
+    const double *tex = pos + 3*(size_t)nv;
+    const double *nrm = tex + 3*(size_t)nv;
+    const double *tNrm = nrm + 3*(size_t)nv;
+    const int32_t *nNrm = (const int32_t*)(tNrm + 3*(size_t)nt);
+    const uint32_t *tri = (const uint32_t*)(nNrm + nv);
+    const uint32_t *twin = tri + 3*(size_t)nt;
+
+    // never trust indices from a file
+    size_t ne = 3*(size_t)nt;
+    for (size_t i=0; i<ne; i++) {
+        if (tri[i]>=nv || (twin[i]!=kNoTwin && twin[i]>=ne)) {
+            Iota.Error.set("Mesh cache reader", IAError::FileContentCorrupt_STR, getName());
+            return nullptr;
+        }
+    }
+    // half-edge i runs from vertex tri[i] to the next vertex of its triangle
+    auto next = [](size_t i) { return (i%3==2) ? i-2 : i+1; };
+    for (size_t i=0; i<ne; i++) {
+        size_t t = twin[i];
+        if (t==kNoTwin) continue;
+        if (t==i || twin[t]!=i || tri[i]!=tri[next(t)] || tri[next(i)]!=tri[t]) {
+            Iota.Error.set("Mesh cache reader", IAError::FileContentCorrupt_STR, getName());
+            return nullptr;
+        }
+    }
+
+    IAMesh *msh = new IAMesh();
+    msh->vertexList.reserve(nv);
+    msh->vertexMap.reserve(nv);
+    for (size_t i=0; i<nv; i++) {
+        IAVertex *v = msh->newVertex();
+        v->pLocalPosition.read((double*)pos+3*i);
+        v->pTex.read((double*)tex+3*i);
+        v->pNormal.read((double*)nrm+3*i);
+        v->pNNormal = nNrm[i];
+        msh->vertexList.push_back(v);
+        msh->vertexMap.insert(v);
+    }
+    msh->pMin.read((double*)hdr->min);
+    msh->pMax.read((double*)hdr->max);
+
+    msh->addNewTriangles(tri, nt, twin);
+    for (size_t i=0; i<nt; i++)
+        msh->triangleList[i]->pNormal.read((double*)tNrm+3*i);
+
+    return msh;
+}
+
+
+/**
+ * Calculate the size of a cache file.
+ *
+ * \return the size in bytes of a file with the given number of elements
+ */
+size_t IAGeometryReaderMeshCache::expectedSize(uint32_t nVertex, uint32_t nTriangle)
+{
+    size_t nv = nVertex, nt = nTriangle;
+    return sizeof(Header)
+        + nv * (9*sizeof(double) + sizeof(int32_t))
+        + nt * (3*sizeof(double) + 6*sizeof(uint32_t));
+}
+
+
+/**
+ * Calculate a 64 bit hash over the content of a file.
+ *
+ * \param filename the file to hash
+ * \param[out] hash the hash value
+ * \param[out] size the size of the file in bytes
+ *
+ * \return false, if the file could not be read
+ */
+bool IAGeometryReaderMeshCache::hashFile(const char *filename, uint64_t &hash, uint64_t &size)
+{
+    FILE *f = fl_fopen(filename, "rb");
+    if (!f) return false;
+
+    const size_t kBufferSize = 1<<20;
+    std::vector<uint64_t> buf(kBufferSize/8);
+    uint64_t h = 0xCBF29CE484222325ULL;
+    size = 0;
+    for (;;) {
+        size_t n = fread(buf.data(), 1, kBufferSize, f);
+        if (n==0) break;
+        // pad the last word with zeros, the size is mixed in at the end
+        if (n&7) memset((uint8_t*)buf.data()+n, 0, 8-(n&7));
+        size_t nw = (n+7)/8;
+        for (size_t i=0; i<nw; i++) {
+            h ^= buf[i];
+            h *= 0x9E3779B97F4A7C15ULL;
+            h ^= h>>32;
+        }
+        size += n;
+        if (n<kBufferSize) break;
+    }
+    bool ok = !ferror(f);
+    fclose(f);
+
+    h ^= size;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h>>33;
+    hash = h;
+    return ok;
+}
+
+
+/**
+ * Find the size and modification time of a file.
+ *
+ * \param filename the file
+ * \param[out] size the size of the file in bytes
+ * \param[out] time the modification time in seconds
+ *
+ * \return false, if the file does not exist
+ */
+bool IAGeometryReaderMeshCache::statFile(const char *filename, uint64_t &size, int64_t &time)
+{
+    struct stat st;
+    if (fl_stat(filename, &st)!=0)
+        return false;
+    size = (uint64_t)st.st_size;
+    time = (int64_t)st.st_mtime;
+    return true;
+}
+
+
+/**
+ * Mark a cache file as the most recently used one.
+ *
+ * \param cacheFilename the cache file
+ */
+void IAGeometryReaderMeshCache::markUsed(const char *cacheFilename)
+{
+    ::utime(cacheFilename, nullptr);
+}
+
+
+/**
+ * Remove the least recently used cache files until the cache fits its size.
+ *
+ * \param maxSize size of all cache files in bytes
+ */
+void IAGeometryReaderMeshCache::trim(uint64_t maxSize)
+{
+    const char *path = Iota.gPreferences.meshCachePath();
+    if (!path) return;
+    struct dirent **list = nullptr;
+    int n = fl_filename_list(path, &list);
+    if (n<=0) return;
+
+    struct Entry { std::string name; uint64_t size; int64_t time; };
+    std::vector<Entry> files;
+    for (int i=0; i<n; i++) {
+        const char *ext = fl_filename_ext(list[i]->d_name);
+        if (!ext || strcmp(ext, ".iamesh")!=0) continue;
+        std::string name = std::string(path) + list[i]->d_name;
+        Entry e = { name, 0, 0 };
+        if (statFile(name.c_str(), e.size, e.time))
+            files.push_back(e);
+    }
+    fl_filename_free_list(&list, n);
+
+    // most recently used first
+    std::sort(files.begin(), files.end(), [](Entry const& a, Entry const& b) {
+        return a.time>b.time;
+    });
+    uint64_t total = 0;
+    for (auto const& e: files) {
+        total += e.size;
+        if (total>maxSize) {
+            printf("Removing mesh cache file %s.\n", e.name.c_str());
+            fl_unlink(e.name.c_str());
+        }
+    }
+}
+
+
+/**
+ * Create the full path and name of the cache file of a source file.
+ *
+ * \param dst receives the path
+ * \param n size of dst
+ * \param sourceFilename the model file
+ */
+void IAGeometryReaderMeshCache::cacheFilename(char *dst, size_t n, const char *sourceFilename)
+{
+    char abs[FL_PATH_MAX];
+    fl_filename_absolute(abs, sizeof(abs), sourceFilename);
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (const unsigned char *c = (const unsigned char*)abs; *c; c++) {
+        h ^= *c;
+        h *= 0x100000001B3ULL;
+    }
+    const char *path = Iota.gPreferences.meshCachePath();
+    snprintf(dst, n, "%s%016llx.iamesh", path ? path : "", (unsigned long long)h);
+}
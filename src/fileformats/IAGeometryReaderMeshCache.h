@@ -0,0 +1,84 @@
+//
+//  IAGeometryReaderMeshCache.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_GEOMETRY_READER_MESH_CACHE_H
+#define IA_GEOMETRY_READER_MESH_CACHE_H
+
+
+#include "IAGeometryReader.h"
+
+
+/**
+ * This class reads a mesh from the mesh cache.
+ *
+ * Importing a large model means parsing, welding vertices, linking twins,
+ * fixing holes, and calculating normals. The result of all this is written
+ * into a .iamesh file in the cache directory, so that the next time the same
+ * model is opened, it can be restored without any of these steps.
+ *
+ * Cache files are named after a hash of the full path of the source file.
+ * The header repeats the size and modification time of the source file, so
+ * finding the cache file of an unchanged source file needs no more than two
+ * calls to stat(). If only the modification time differs, a hash of the
+ * content of the source file, which is also in the header, confirms that the
+ * cache file is still valid.
+ *
+ * All data is stored in host byte order. A cache file written on a machine
+ * with a different byte order is simply ignored.
+ *
+ * Every use of a cache file updates its modification time. When the cache
+ * directory grows beyond the size set in the preferences, the files that
+ * were not used for the longest time are removed.
+ */
+class IAGeometryReaderMeshCache : public IAGeometryReader
+{
+    typedef IAGeometryReader super;
+
+public:
+    static std::shared_ptr<IAGeometryReader> findReaderFor(const char *sourceFilename);
+    static bool write(const char *sourceFilename, IAMesh *mesh);
+    static void trim(uint64_t maxSize);
+    static void cacheFilename(char *dst, size_t n, const char *sourceFilename);
+
+    IAGeometryReaderMeshCache(const char *cacheFilename);
+    virtual ~IAGeometryReaderMeshCache() override;
+    virtual IAMesh *load() override;
+
+    /** Bump this whenever the file layout changes. */
+    static const uint32_t kVersion = 2;
+
+private:
+    /**
+     * The header at the start of every .iamesh file.
+     *
+     * The header is followed by vertex positions, texture coordinates, and
+     * normals (3 doubles each), triangle normals (3 doubles), the normal
+     * count per vertex (int32), three vertex indices per triangle (uint32),
+     * and the twin index of every half-edge (uint32).
+     */
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        uint64_t sourceHash;
+        uint32_t nVertex;
+        uint32_t nTriangle;
+        double min[3];
+        double max[3];
+    };
+
+    static size_t expectedSize(uint32_t nVertex, uint32_t nTriangle);
+    static bool statFile(const char *filename, uint64_t &size, int64_t &time);
+    static bool hashFile(const char *filename, uint64_t &hash, uint64_t &size);
+    static void markUsed(const char *cacheFilename);
+};
+
+
+#endif /* IA_GEOMETRY_READER_MESH_CACHE_H */
+
+
@@ -9,9 +9,16 @@
 
 #include "Iota.h"
 #include "geometry/IAMesh.h"
+#include "app/IAParallel.h"
 
 #include <FL/fl_utf8.h>
 
+#include <charconv>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <ctype.h>
+
 #include <fcntl.h>
 #ifdef _WIN32
 # include <io.h>
@@ -121,12 +128,194 @@ IAGeometryReaderTextStl::~IAGeometryReaderTextStl()
 }
 
 
+// the scanner is only used in this file
+namespace {
+
+
+/**
+ * A single facet as it was read from the file.
+ *
+ * The standard requires three vertices per facet, but some exporters write
+ * quads, so we keep room for a fourth vertex.
+ */
+struct IATextStlFacet {
+    double v[4][3];
+    int n;
+};
+
+
+/**
+ * Scan a section of an ASCII STL file without creating any per-word state.
+ *
+ * Keywords are compared in place, and numbers are converted with
+ * std::from_chars. A section always starts at a "facet" keyword, or right
+ * after the first "solid" line, so that a large file can be split into
+ * sections that are scanned in parallel.
+ */
+class IATextStlScanner
+{
+public:
+    IATextStlScanner(const char *begin, const char *end) : p(begin), pEnd(end) { }
+    void scan();
+
+    /// all facets found in this section, in file order
+    std::vector<IATextStlFacet> facets;
+    /// set if the section contains an error
+    bool error = false;
+    /// set if the file ends after this section without an "endsolid"
+    bool inSolid = true;
+    /// set if an "endsolid" was not followed by another "solid"
+    bool stopped = false;
+
+    static bool isSpace(char c) { return c==' ' || c=='\t' || c=='\r' || c=='\n'; }
+    static const char *findFacet(const char *p, const char *end);
+
+private:
+    void skipSpace() { while (p<pEnd && isSpace(*p)) p++; }
+    void skipLine();
+    bool keyword(const char *key, size_t len);
+    double number();
+    bool vertex(double *v);
+
+    const char *p, *pEnd;
+};
+
+
+/**
+ * Skip the rest of the current line, including the line ending.
+ */
+void IATextStlScanner::skipLine()
+{
+    while (p<pEnd && *p!='\r' && *p!='\n') p++;
+    if (p<pEnd && *p=='\r') p++;
+    if (p<pEnd && *p=='\n') p++;
+}
+
+
+/**
+ * Check if the next word is the given keyword and skip it.
+ *
+ * \return false if the next word is something else; nothing is skipped
+ */
+bool IATextStlScanner::keyword(const char *key, size_t len)
+{
+    skipSpace();
+    if ((size_t)(pEnd-p)<len || memcmp(p, key, len)!=0)
+        return false;
+    if (p+len<pEnd && (isalnum((uint8_t)p[len]) || p[len]=='_'))
+        return false;
+    p += len;
+    return true;
+}
+
+
+/**
+ * Read the next number.
+ *
+ * Like atof(), anything that is not a number is skipped and reads as 0.0.
+ */
+double IATextStlScanner::number()
+{
+    skipSpace();
+    const char *q = p;
+    while (q<pEnd && !isSpace(*q)) q++;
+    double ret = 0.0;
+#if defined(__cpp_lib_to_chars) && (__cpp_lib_to_chars >= 201611L)
+    const char *s = p;
+    if (s<q && *s=='+') s++;
+    std::from_chars(s, q, ret);
+#else
+    char buf[64];
+    size_t n = std::min((size_t)(q-p), sizeof(buf)-1);
+    memcpy(buf, p, n);
+    buf[n] = 0;
+    ret = atof(buf);
+#endif
+    p = q;
+    return ret;
+}
+
+
+/**
+ * Read the keyword "vertex" followed by three coordinates.
+ */
+bool IATextStlScanner::vertex(double *v)
+{
+    if (!keyword("vertex", 6)) return false;
+    v[0] = number();
+    v[1] = number();
+    v[2] = number();
+    return true;
+}
+
+
+/**
+ * Read all facets in this section.
+ */
+void IATextStlScanner::scan()
+{
+    for (;;) {
+        skipSpace();
+        if (p>=pEnd) return;
+        if (keyword("facet", 5)) {
+            IATextStlFacet f;
+            if (!keyword("normal", 6)) { error = true; return; }
+            number(); number(); number();
+            if (!keyword("outer", 5) || !keyword("loop", 4)) { error = true; return; }
+            if (!vertex(f.v[0]) || !vertex(f.v[1]) || !vertex(f.v[2])) { error = true; return; }
+            // Some files have a fourth vertex here, which is against the
+            // standard. So far I have only seen quads, so we simply generate
+            // a second triangle later.
+            f.n = vertex(f.v[3]) ? 4 : 3;
+            if (!keyword("endloop", 7) || !keyword("endfacet", 8)) { error = true; return; }
+            facets.push_back(f);
+        } else if (keyword("endsolid", 8)) {
+            // we found STLs that contain mutiple solids!
+            skipLine();
+            inSolid = false;
+            skipSpace();
+            if (p>=pEnd) return;
+            if (!keyword("solid", 5)) { stopped = true; return; }
+            skipLine();
+            inSolid = true;
+        } else {
+            error = true;
+            return;
+        }
+    }
+}
+
+
+/**
+ * Find the start of the next line that begins with the keyword "facet".
+ *
+ * \return a pointer to the keyword, or end if there is none
+ */
+const char *IATextStlScanner::findFacet(const char *p, const char *end)
+{
+    for (;;) {
+        const char *nl = (const char*)memchr(p, '\n', end-p);
+        if (!nl) return end;
+        p = nl+1;
+        while (p<end && (*p==' ' || *p=='\t')) p++;
+        if (end-p>5 && memcmp(p, "facet", 5)==0 && isSpace(p[5]))
+            return p;
+    }
+}
+
+
+} // namespace
+
+
 /**
  * Interprete the geometry data and create a mesh list.
  *
+ * The file is split at facet boundaries into sections that are scanned in
+ * parallel. Vertices and triangles are then added to the mesh in file order.
+ *
  * \return nullptr, if the mesh could not be read or created.
  *
- * \todo gracefully handle outer loops with more than three vertices
+ * \todo gracefully handle outer loops with more than four vertices
  * \todo fix seams
  * \todo fix zero size holes
  * \todo fix degenrate triangles
@@ -143,107 +332,74 @@ IAMesh *IAGeometryReaderTextStl::load()
      endloop
      endfacet
      */
-    
+
     IAMesh *msh = new IAMesh();
-    
-    for (;;) {
-        // the first word must be "solid"
-        getWord();
-        // we found STLs that contain mutiple solids!
-        if (!wordIs("solid")) break;
-        // the rest of the line is not important
-        getLine();
-        
-        for (;;) {
-            double x, y, z;
-            IAVertex *p1, *p2, *p3;
-            
-            // check if this is the end of the facet list
-            getWord();
-            if ( wordIs("endsolid") ) {
-                getLine();
-                break;
-            }
-            
-            // if this is not the end, it must be another facet
-            if (!wordIs("facet")) goto fileFormatErr;
-            getWord();
-            
-            // read the facet normal and ignore it
-            if (!wordIs("normal")) goto fileFormatErr;
-            getDouble();
-            getDouble();
-            getDouble();
-            getWord();
-            
-            // is this the outer loop?
-            if (!wordIs("outer")) goto fileFormatErr;
-            getWord();
-            if (!wordIs("loop")) goto fileFormatErr;
-            getWord();
-            
-            // read the first vertex
-            if (!wordIs("vertex")) goto fileFormatErr;
-            x = getDouble();
-            y = getDouble();
-            z = getDouble();
-            p1 = msh->findOrAddNewVertex(IAVector3d(x, y, z));
-            p1->pTex.set(x*0.8+0.5, -z*0.8+0.5, 0.0);
-            
-            // read the second vertex
-            getWord();
-            if (!wordIs("vertex")) goto fileFormatErr;
-            x = getDouble();
-            y = getDouble();
-            z = getDouble();
-            p2 = msh->findOrAddNewVertex(IAVector3d(x, y, z));
-            p2->pTex.set(x*0.8+0.5, -z*0.8+0.5, 0.0);
-            
-            // read the third vertex
-            getWord();
-            if (!wordIs("vertex")) goto fileFormatErr;
-            x = getDouble();
-            y = getDouble();
-            z = getDouble();
-            p3 = msh->findOrAddNewVertex(IAVector3d(x, y, z));
-            p3->pTex.set(x*0.8+0.5, -z*0.8+0.5, 0.0);
-            
-            // this should be the end of the loop
-            // Some files have additional vertices here, but that is agains the
-            // standard. I found only very few files that do this, since this
-            // is incompatible with the binary version of this format. So far
-            // I have only seen quads, so we simply generate a second triangle
-            // here.
-            getWord();
-            if (wordIs("vertex")) {
-                msh->addNewTriangle(p1, p2, p3);
-                p2 = p3;
-                x = getDouble();
-                y = getDouble();
-                z = getDouble();
-                p3 = msh->findOrAddNewVertex(IAVector3d(x, y, z));
-                p3->pTex.set(x*0.8+0.5, -z*0.8+0.5, 0.0);
-                getWord();
+
+    const char *start = (const char*)currentData();
+    const char *end = start + remainingSize();
+
+    // the first word must be "solid", and the rest of the line is not important
+    while (start<end && IATextStlScanner::isSpace(*start)) start++;
+    if (end-start<5 || memcmp(start, "solid", 5)!=0 || (end-start>5 && !IATextStlScanner::isSpace(start[5]))) {
+        // not an error, just nothing to read
+        end = start;
+    } else {
+        while (start<end && *start!='\n') start++;
+    }
+
+    // split the file into sections that start at a facet
+    const size_t kMinSection = 1<<20;
+    size_t nSection = std::min((size_t)ia_num_threads(), (size_t)(end-start)/kMinSection + 1);
+    std::vector<const char*> bounds;
+    bounds.push_back(start);
+    for (size_t i=1; i<nSection; i++) {
+        const char *b = start + (end-start)*i/nSection;
+        if (b<=bounds.back()) continue;
+        b = IATextStlScanner::findFacet(b, end);
+        if (b>=end) break;
+        if (b>bounds.back()) bounds.push_back(b);
+    }
+    bounds.push_back(end);
+
+    std::vector<IATextStlScanner> sections;
+    sections.reserve(bounds.size()-1);
+    for (size_t i=0; i+1<bounds.size(); i++)
+        sections.emplace_back(bounds[i], bounds[i+1]);
+    ia_parallel_for(sections.size(), [&sections](size_t b, size_t e) {
+        for (size_t i=b; i<e; i++) sections[i].scan();
+    }, 1);
+
+    // add all facets in file order
+    bool inSolid = (start<end);
+    for (auto &sec: sections) {
+        for (auto &f: sec.facets) {
+            IAVertex *p[4];
+            for (int i=0; i<f.n; i++) {
+                double x = f.v[i][0], y = f.v[i][1], z = f.v[i][2];
+                if (i==3) msh->addNewTriangle(p[0], p[1], p[2]);
+                p[i] = msh->findOrAddNewVertex(IAVector3d(x, y, z));
+                p[i]->pTex.set(x*0.8+0.5, -z*0.8+0.5, 0.0);
             }
-            if (!wordIs("endloop")) goto fileFormatErr;
-            
-            // this should be the end of the facet
-            getWord();
-            if (!wordIs("endfacet")) goto fileFormatErr;
-            
-            // add the triangle that was generated by those vertice
-            msh->addNewTriangle(p1, p2, p3);
+            if (f.n==4)
+                msh->addNewTriangle(p[0], p[2], p[3]);
+            else
+                msh->addNewTriangle(p[0], p[1], p[2]);
         }
+        if (sec.error) goto fileFormatErr;
+        inSolid = sec.inSolid;
+        if (sec.stopped) break;
     }
+    if (inSolid) goto fileFormatErr;
+
     if (!msh->validate()) {
         msh->fixHoles();
         msh->validate();
         /** \todo warn the user that the mesh could not be fixed! */
     }
     msh->calculateNormals();
-    
+
     return msh;
-    
+
 fileFormatErr:
     Iota.Error.set("Read Text based STL File", IAError::FileContentCorrupt_STR, getName());
     delete msh;
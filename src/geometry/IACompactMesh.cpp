@@ -0,0 +1,254 @@
+//
+//  IACompactMesh.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IACompactMesh.h"
+
+#include "IAMesh.h"
+
+#include <unordered_map>
+#include <algorithm>
+
+
+const uint32_t IACompactMesh::kNoTwin;
+
+
+/**
+ * Create an empty mesh.
+ */
+IACompactMesh::IACompactMesh()
+{
+}
+
+
+/**
+ * Release all resources.
+ */
+IACompactMesh::~IACompactMesh()
+{
+}
+
+
+/**
+ * Remove all vertices and triangles and release their memory.
+ */
+void IACompactMesh::clear()
+{
+    std::vector<float>().swap(vertexX);
+    std::vector<float>().swap(vertexY);
+    std::vector<float>().swap(vertexZ);
+    std::vector<float>().swap(vertexU);
+    std::vector<float>().swap(vertexV);
+    std::vector<uint32_t>().swap(edgeVertex);
+    std::vector<uint32_t>().swap(edgeTwin);
+    std::vector<float>().swap(triangleZMin);
+    std::vector<float>().swap(triangleZMax);
+    pMeshPosition.setZero();
+    pZIndex.clear();
+}
+
+
+/**
+ * Copy the topology and geometry of a pointer based mesh.
+ *
+ * Coordinates are reduced to single precision, which is what STL files
+ * provide anyway. Normals are not copied. They can be recalculated from the
+ * vertex positions when needed.
+ *
+ * \param m the source mesh
+ */
+void IACompactMesh::fromMesh(IAMesh *m)
+{
+    clear();
+    if (!m) return;
+
+    size_t nv = m->vertexList.size(), nt = m->triangleList.size();
+    vertexX.reserve(nv); vertexY.reserve(nv); vertexZ.reserve(nv);
+    vertexU.reserve(nv); vertexV.reserve(nv);
+    edgeVertex.reserve(3*nt); edgeTwin.reserve(3*nt);
+    triangleZMin.reserve(nt); triangleZMax.reserve(nt);
+
+    std::unordered_map<IAVertex*, uint32_t> vertexIndex;
+    vertexIndex.reserve(nv);
+    for (auto &v: m->vertexList) {
+        vertexIndex[v] = (uint32_t)vertexZ.size();
+        vertexX.push_back((float)v->pLocalPosition.x());
+        vertexY.push_back((float)v->pLocalPosition.y());
+        vertexZ.push_back((float)v->pLocalPosition.z());
+        vertexU.push_back((float)v->pTex.x());
+        vertexV.push_back((float)v->pTex.y());
+    }
+
+    std::unordered_map<IAHalfEdge*, uint32_t> edgeIndex;
+    edgeIndex.reserve(3*nt);
+    for (auto &t: m->triangleList) {
+        float zMin = vertexZ[vertexIndex[t->vertex(0)]], zMax = zMin;
+        for (int i=0; i<3; i++) {
+            uint32_t vi = vertexIndex[t->vertex(i)];
+            edgeIndex[t->edge(i)] = (uint32_t)edgeVertex.size();
+            edgeVertex.push_back(vi);
+            zMin = std::min(zMin, vertexZ[vi]);
+            zMax = std::max(zMax, vertexZ[vi]);
+        }
+        triangleZMin.push_back(zMin);
+        triangleZMax.push_back(zMax);
+    }
+
+    for (auto &t: m->triangleList) {
+        for (int i=0; i<3; i++) {
+            IAHalfEdge *twin = t->edge(i)->twin();
+            edgeTwin.push_back(twin ? edgeIndex[twin] : kNoTwin);
+        }
+    }
+
+    pMeshPosition = m->position();
+    buildZIndex();
+}
+
+
+/**
+ * Recreate a pointer based mesh from this compact mesh.
+ *
+ * Half-edges are linked exactly as they are stored here, including
+ * twinless edges. Normals are recalculated.
+ *
+ * \param m the destination mesh; all previous content is cleared
+ */
+void IACompactMesh::toMesh(IAMesh *m) const
+{
+    if (!m) return;
+    m->clear();
+
+    uint32_t nv = numVertices(), nt = numTriangles();
+    m->vertexList.reserve(nv);
+    m->vertexMap.reserve(nv);
+    for (uint32_t i=0; i<nv; i++) {
+        IAVertex *v = m->newVertex();
+        v->pLocalPosition.set(vertexX[i], vertexY[i], vertexZ[i]);
+        v->pTex.set(vertexU[i], vertexV[i], 0.0);
+        m->updateBoundingBox(v->pLocalPosition);
+        m->vertexList.push_back(v);
+        m->vertexMap.insert(v);
+    }
+
+    m->triangleList.reserve(nt);
+    m->edgeList.reserve(3*nt);
+    m->edgeMap.reserve(3*nt);
+    for (uint32_t i=0; i<nt; i++) {
+        IATriangle *t = m->newTriangle();
+        IAHalfEdge *e0 = m->newHalfEdge(t, m->vertexList[edgeVertex[3*i]]);
+        IAHalfEdge *e1 = m->newHalfEdge(t, m->vertexList[edgeVertex[3*i+1]]);
+        IAHalfEdge *e2 = m->newHalfEdge(t, m->vertexList[edgeVertex[3*i+2]]);
+        t->setEdges(e0, e1, e2);
+        e0->setNext(e1); e0->setPrev(e2);
+        e1->setNext(e2); e1->setPrev(e0);
+        e2->setNext(e0); e2->setPrev(e1);
+        m->edgeList.push_back(e0);
+        m->edgeList.push_back(e1);
+        m->edgeList.push_back(e2);
+        m->edgeMap.insert(std::make_pair(IAHalfEdgeKey { e0->vertex(), e1->vertex() }, 3*i));
+        m->edgeMap.insert(std::make_pair(IAHalfEdgeKey { e1->vertex(), e2->vertex() }, 3*i+1));
+        m->edgeMap.insert(std::make_pair(IAHalfEdgeKey { e2->vertex(), e0->vertex() }, 3*i+2));
+        m->triangleList.push_back(t);
+    }
+
+    for (uint32_t i=0; i<3*nt; i++) {
+        if (edgeTwin[i]!=kNoTwin)
+            m->edgeList[i]->setTwin(m->edgeList[edgeTwin[i]]);
+    }
+
+    m->position(pMeshPosition);
+    m->calculateNormals();
+}
+
+
+/**
+ * Return the number of bytes used by the mesh data.
+ *
+ * \return memory usage in bytes, not counting unused vector capacity
+ */
+size_t IACompactMesh::memoryUsage() const
+{
+    return numVertices() * 5 * sizeof(float)
+         + edgeVertex.size() * 2 * sizeof(uint32_t)
+         + numTriangles() * 2 * sizeof(float);
+}
+
+
+/**
+ * Check if a triangle in global space intersects with the z plane.
+ *
+ * \param t index of the triangle
+ * \param z height in global space
+ *
+ * \return true, if at least one vertex is below z, and one is equal or above.
+ */
+bool IACompactMesh::crossesZGlobal(uint32_t t, double z) const
+{
+    double dz = pMeshPosition.z();
+    return ((double)triangleZMin[t]+dz < z) && ((double)triangleZMax[t]+dz >= z);
+}
+
+
+/**
+ * Calculate the vertex where a half-edge crosses the z plane.
+ *
+ * Position and texture coordinate are interpolated. The vertex normal is set
+ * to the face normal, because IACompactMesh does not store vertex normals.
+ *
+ * \param e index of the half-edge
+ * \param z height in global space
+ * \param cut receives the new vertex data
+ *
+ * \return false, if the edge does not cross z, cut is unchanged
+ */
+bool IACompactMesh::findZGlobal(uint32_t e, double z, IAVertex &cut) const
+{
+    uint32_t i0 = edgeVertex[e], i1 = edgeVertex[next(e)];
+    IAVector3d p0(vertexX[i0], vertexY[i0], vertexZ[i0]);
+    IAVector3d p1(vertexX[i1], vertexY[i1], vertexZ[i1]);
+    p0 += pMeshPosition;
+    p1 += pMeshPosition;
+    IAVector3d vd0(p0);
+    vd0 -= p1;
+    double m = (z-p1.z()) / vd0.z();
+    if (m<0.0 || m>1.0) return false;
+
+    vd0 *= m;
+    vd0 += p1;
+    cut.pGlobalPosition = vd0;
+    cut.pLocalPosition = vd0;
+    cut.pTex.set(vertexU[i1] + (vertexU[i0]-vertexU[i1])*m,
+                 vertexV[i1] + (vertexV[i0]-vertexV[i1])*m,
+                 0.0);
+
+    uint32_t i2 = edgeVertex[prev(e)];
+    IAVector3d p2(vertexX[i2], vertexY[i2], vertexZ[i2]);
+    p2 += pMeshPosition;
+    IAVector3d a = p1 - p0, b = p2 - p0;
+    cut.pNormal = (a ^ b).normalized();
+    return true;
+}
+
+
+/**
+ * Index all triangles by their z range in global space.
+ */
+void IACompactMesh::buildZIndex()
+{
+    uint32_t nt = numTriangles(), nv = numVertices();
+    double dz = pMeshPosition.z();
+    std::vector<double> zMin(nt), zMax(nt), vertexZ(nv);
+    for (uint32_t t=0; t<nt; t++) {
+        zMin[t] = (double)triangleZMin[t] + dz;
+        zMax[t] = (double)triangleZMax[t] + dz;
+    }
+    for (uint32_t v=0; v<nv; v++)
+        vertexZ[v] = globalZ(v);
+    pZIndex.build(zMin, zMax, vertexZ);
+}
+
+
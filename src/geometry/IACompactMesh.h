@@ -0,0 +1,118 @@
+//
+//  IACompactMesh.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_COMPACT_MESH_H
+#define IA_COMPACT_MESH_H
+
+
+#include "IAVector3d.h"
+#include "IAMeshZIndex.h"
+
+#include <vector>
+#include <stdint.h>
+
+
+class IAMesh;
+class IAVertex;
+
+
+/**
+ A memory efficient, index based version of IAMesh.
+
+ IAMesh stores every vertex, half-edge, and triangle as a separate object that
+ is linked by pointers. IACompactMesh stores the same topology as a structure
+ of arrays: single precision coordinates, and 32 bit indices for half-edges.
+
+ Triangle t owns the half-edges 3t, 3t+1, and 3t+2, in that order. The next
+ and previous half-edge are implicit and need no storage. Half-edge e starts at
+ vertex edgeVertex[e] and ends at the start of the next half-edge.
+
+ Every triangle caches its lowest and highest z coordinate, so that the slicer
+ can reject triangles without touching any vertex data.
+
+ \todo IACompactMesh does not support fixing holes; fix the IAMesh before
+      converting it.
+ */
+class IACompactMesh
+{
+public:
+    /** Marks a half-edge that has no twin. */
+    static const uint32_t kNoTwin = 0xFFFFFFFF;
+
+    IACompactMesh();
+    ~IACompactMesh();
+    void clear();
+
+    void fromMesh(IAMesh*);
+    void toMesh(IAMesh*) const;
+
+    size_t memoryUsage() const;
+
+    /** Number of vertices.
+     \return number of vertices in this mesh */
+    uint32_t numVertices() const { return (uint32_t)vertexZ.size(); }
+
+    /** Number of triangles.
+     \return number of triangles in this mesh */
+    uint32_t numTriangles() const { return (uint32_t)triangleZMin.size(); }
+
+    /** Next half-edge in the same triangle.
+     \param e index of a half-edge
+     \return index of the next half-edge */
+    static uint32_t next(uint32_t e) { return (e%3==2) ? e-2 : e+1; }
+
+    /** Previous half-edge in the same triangle.
+     \param e index of a half-edge
+     \return index of the previous half-edge */
+    static uint32_t prev(uint32_t e) { return (e%3==0) ? e+2 : e-1; }
+
+    /** Z coordinate of a vertex in global space.
+     \param v index of the vertex
+     \return the z coordinate including the mesh position */
+    double globalZ(uint32_t v) const { return (double)vertexZ[v] + pMeshPosition.z(); }
+
+    bool crossesZGlobal(uint32_t t, double z) const;
+    bool findZGlobal(uint32_t e, double z, IAVertex &cut) const;
+
+    /** Index of all triangles by their z range in global space.
+     \return the index that was built by fromMesh() */
+    IAMeshZIndex const& zIndex() const { return pZIndex; }
+
+    /** Position of the mesh in scene space. */
+    IAVector3d const& position() const { return pMeshPosition; }
+
+    /** Vertex coordinates in mesh space. */
+    std::vector<float> vertexX, vertexY, vertexZ;
+
+    /** Texture coordinates for every vertex. */
+    std::vector<float> vertexU, vertexV;
+
+    /** Index of the start vertex for every half-edge. */
+    std::vector<uint32_t> edgeVertex;
+
+    /** Index of the twin of every half-edge, or kNoTwin. */
+    std::vector<uint32_t> edgeTwin;
+
+    /** Lowest z coordinate in mesh space for every triangle. */
+    std::vector<float> triangleZMin;
+
+    /** Highest z coordinate in mesh space for every triangle. */
+    std::vector<float> triangleZMax;
+
+private:
+    void buildZIndex();
+
+    /// Position of this object in scene space, copied from IAMesh
+    IAVector3d pMeshPosition;
+
+    /// Triangles sorted by their z range in global space
+    IAMeshZIndex pZIndex;
+};
+
+
+#endif /* IA_COMPACT_MESH_H */
+
+
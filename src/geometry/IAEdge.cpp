@@ -37,40 +37,36 @@ IAHalfEdge::IAHalfEdge(IATriangle *t, IAVertex *v)
 
 /**
  Find the intersection of this edge with a give Z plane.
- \return a vector on this edge with interpolated texture coordinates, or null
- if this edge does not cross the Z plane.
+ \param zMin the z plane in global space
+ \param cut receives the position on this edge with interpolated texture
+        coordinates and normal
+ \return false if this edge does not cross the Z plane; cut is not modified
  */
-IAVertex *IAHalfEdge::findZGlobal(double zMin)
+bool IAHalfEdge::findZGlobal(double zMin, IAVertex &cut) const
 {
     IAVertex *v0 = vertex(), *v1 = next()->vertex();
     IAVector3d vd0(v0->pGlobalPosition);
-    bool retVec = false;
     vd0 -= v1->pGlobalPosition;
     double dzo = vd0.z(), dzn = zMin-v1->pGlobalPosition.z();
     /** \todo division by zero should not be possible...
      we did avoid it by the z-offset hack, but, ugh!
      */
     double m = dzn/dzo;
-    if (m>=0.0 && m<=1) retVec = true;
-    if (retVec) {
-        // calculate the coordinate at zMin
-        vd0 *= m;
-        vd0 += v1->pGlobalPosition;
-        // calculate the texture coordinate at zMin
-        IAVector3d vt0(v0->pTex);
-        vt0 -= v1->pTex;
-        vt0 *= m;
-        vt0 += v1->pTex;
-        IAVertex *v2 = new IAVertex();
-        v2->pGlobalPosition = vd0;
-        v2->pLocalPosition = vd0;
-        v2->pTex = vt0;
-        v2->pNormal = (v0->pNormal*m + v1->pNormal*(1.0-m));
-        v2->pNormal.normalize();
-        return v2;
-    } else {
-        return nullptr;
-    }
+    if (m<0.0 || m>1) return false;
+    // calculate the coordinate at zMin
+    vd0 *= m;
+    vd0 += v1->pGlobalPosition;
+    // calculate the texture coordinate at zMin
+    IAVector3d vt0(v0->pTex);
+    vt0 -= v1->pTex;
+    vt0 *= m;
+    vt0 += v1->pTex;
+    cut.pGlobalPosition = vd0;
+    cut.pLocalPosition = vd0;
+    cut.pTex = vt0;
+    cut.pNormal = (v0->pNormal*m + v1->pNormal*(1.0-m));
+    cut.pNormal.normalize();
+    return true;
 }
 
 
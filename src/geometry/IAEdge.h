@@ -17,6 +17,7 @@
 class IAVertex;
 class IATriangle;
 class IAMesh;
+class IACompactMesh;
 
 
 /**
@@ -44,37 +45,38 @@ typedef std::vector<IAEdge*> IAEdgeList;
 class IAHalfEdge
 {
     friend IAMesh;
+    friend IACompactMesh;
 
 public:
     IAHalfEdge(IATriangle *t, IAVertex *v);
 
     /** Two twins make up a full edge.
      \return the other half-edge that makes up this edge. */
-    IAHalfEdge *twin() { return pTwin; }
+    IAHalfEdge *twin() const { return pTwin; }
 
     /** A triangle is a doubly linked list of half-edges.
      \return the previous edge in this triangle.
      The end of the previous half-edge is the start of this half-edge. */
-    IAHalfEdge *prev() { return pPrev; }
+    IAHalfEdge *prev() const { return pPrev; }
 
     /** A triangle is a doubly linked list of half-edges.
      \return the next edge in this triangle.
      The end of this half-edge is the start of the next half-edge. */
-    IAHalfEdge *next() { return pNext; }
+    IAHalfEdge *next() const { return pNext; }
 
     /** Triangles own and manage edges.
      \return the triangle that owns this half-edge. */
-    IATriangle *triangle() { return pTriangle; }
+    IATriangle *triangle() const { return pTriangle; }
 
     /** The vertex is the start position in space.
      \return the vertex that is the start of this half-edge.
      \todo half-edges must manage texture coordinates.*/
-    IAVertex *vertex() { return pVertex; }
+    IAVertex *vertex() const { return pVertex; }
 
     IAHalfEdge *findNextSingleEdgeInFan();
     IAHalfEdge *findPrevSingleEdgeInFan();
 
-    IAVertex *findZGlobal(double);
+    bool findZGlobal(double, IAVertex &cut) const;
 
 protected:
     /** Set the other half-edge that makes up this edge.
@@ -10,11 +10,14 @@
 #include "Iota.h"
 #include "geometry/IAEdge.h"
 #include "printer/IAPrinter.h"
+#include "app/IAParallel.h"
 
 #include <FL/fl_draw.H>
 #include <FL/gl.h>
 #include <FL/glu.h>
 
+#include <algorithm>
+
 
 /**
  * Create an empty mesh.
@@ -26,25 +29,36 @@ IAMesh::IAMesh()
 
 /**
  * Clear all resources used by the mesh.
+ *
+ * Vertices, half-edges, and triangles are not deleted one by one. The
+ * arenas that hold them are released as a whole.
  */
 void IAMesh::clear()
 {
-    for (auto &e: edgeList) {
-        delete e;
-    }
     edgeList.clear();
     edgeMap.clear();
-
-    for (auto &f: triangleList) {
-        delete f;
-    }
     triangleList.clear();
-
-    for (auto &v: vertexList) {
-        delete v;
-    }
     vertexList.clear();
     vertexMap.clear();
+
+    pHalfEdgeArena.clear();
+    pTriangleArena.clear();
+    pVertexArena.clear();
+
+    pZIndex.clear();
+    pGlobalPositionNeedsUpdate = true;
+}
+
+
+/**
+ * Print the number of objects and bytes held by the allocation arenas.
+ */
+void IAMesh::printAllocationStats()
+{
+    printf("Mesh allocation: %ld vertices, %ld half-edges, %ld triangles in %ld blocks, %ld bytes.\n",
+           pVertexArena.size(), pHalfEdgeArena.size(), pTriangleArena.size(),
+           pVertexArena.blocks() + pHalfEdgeArena.blocks() + pTriangleArena.blocks(),
+           pVertexArena.bytes() + pHalfEdgeArena.bytes() + pTriangleArena.bytes());
 }
 
 
@@ -58,6 +72,7 @@ bool IAMesh::validate()
     bool isWatertight = true;
     printf("Validating mesh with %ld triangles, %ld vertices, and %ld edges...\n",
            triangleList.size(), vertexList.size(), edgeList.size());
+    printAllocationStats();
     if (triangleList.size()>0 && edgeList.size()==0) {
         puts("WARNING: empty edge list!");
     }
@@ -218,11 +233,11 @@ void IAMesh::fixHole(IAHalfEdge *e)
  */
 IATriangle *IAMesh::addNewTriangle(IAVertex *v0, IAVertex *v1, IAVertex *v2)
 {
-    IATriangle *t = new IATriangle( this );
+    IATriangle *t = newTriangle();
 
-    IAHalfEdge *e0 = new IAHalfEdge(t, v0);
-    IAHalfEdge *e1 = new IAHalfEdge(t, v1);
-    IAHalfEdge *e2 = new IAHalfEdge(t, v2);
+    IAHalfEdge *e0 = newHalfEdge(t, v0);
+    IAHalfEdge *e1 = newHalfEdge(t, v1);
+    IAHalfEdge *e2 = newHalfEdge(t, v2);
     t->setEdges(e0, e1, e2);
 
     e0->setNext(e1);
@@ -243,6 +258,163 @@ IATriangle *IAMesh::addNewTriangle(IAVertex *v0, IAVertex *v1, IAVertex *v2)
 }
 
 
+/**
+ * Allocate triangles and half-edges and link them within each triangle.
+ *
+ * The new triangles and half-edges are appended to triangleList and
+ * edgeList, but no twins are set, and the edges are not added to edgeMap.
+ *
+ * \param corners three indices into vertexList for every new triangle
+ * \param nt number of triangles
+ */
+void IAMesh::linkNewTriangles(const uint32_t *corners, size_t nt)
+{
+    size_t tBase = triangleList.size(), eBase = edgeList.size();
+
+    // allocating from the arenas is not thread safe, but it is cheap
+    triangleList.resize(tBase+nt);
+    edgeList.resize(eBase+3*nt);
+    for (size_t i=0; i<nt; i++) {
+        IATriangle *t = newTriangle();
+        triangleList[tBase+i] = t;
+        for (int j=0; j<3; j++)
+            edgeList[eBase+3*i+j] = newHalfEdge(t, vertexList[corners[3*i+j]]);
+    }
+
+    // link the edges within each triangle
+    ia_parallel_for(nt, [=](size_t b, size_t e) {
+        for (size_t i=b; i<e; i++) {
+            IAHalfEdge *e0 = edgeList[eBase+3*i], *e1 = edgeList[eBase+3*i+1], *e2 = edgeList[eBase+3*i+2];
+            triangleList[tBase+i]->setEdges(e0, e1, e2);
+            e0->setNext(e1); e0->setPrev(e2);
+            e1->setNext(e2); e1->setPrev(e0);
+            e2->setNext(e0); e2->setPrev(e1);
+        }
+    });
+}
+
+
+/**
+ * Add many triangles at once with a known twin table.
+ *
+ * This is used to restore a mesh that was fully linked before, so no twins
+ * need to be searched.
+ *
+ * \param corners three indices into vertexList for every new triangle
+ * \param nt number of triangles
+ * \param twins for every new half-edge, the index of its twin among the new
+ *      half-edges, or 0xFFFFFFFF if the half-edge has no twin
+ */
+void IAMesh::addNewTriangles(const uint32_t *corners, size_t nt, const uint32_t *twins)
+{
+    size_t eBase = edgeList.size();
+    linkNewTriangles(corners, nt);
+
+    ia_parallel_for(3*nt, [=](size_t b, size_t e) {
+        for (size_t i=b; i<e; i++) {
+            if (twins[i]!=0xFFFFFFFF)
+                edgeList[eBase+i]->setTwin(edgeList[eBase+twins[i]]);
+        }
+    });
+
+    edgeMap.reserve(edgeMap.size()+3*nt);
+    for (size_t i=eBase; i<edgeList.size(); i++) {
+        IAHalfEdge *e = edgeList[i];
+        edgeMap.insert(std::make_pair(IAHalfEdgeKey { e->vertex(), e->next()->vertex() }, i));
+    }
+}
+
+
+/**
+ * Add many triangles at once, using all available threads.
+ *
+ * The result is exactly the same as calling addNewTriangle() for every
+ * triangle in order, including the order of all lists and the way twins are
+ * found in meshes that are not manifold.
+ *
+ * Triangles and half-edges are allocated in order and then linked in
+ * parallel. To find twins, all half-edges are sorted by their undirected
+ * vertex pair. Pairs that are shared by exactly two half-edges in opposite
+ * directions are twinned in parallel. All other half-edges are replayed
+ * serially using the same rules as addHalfEdge().
+ *
+ * \param corners three indices into vertexList for every new triangle
+ */
+void IAMesh::addNewTriangles(std::vector<uint32_t> const& corners)
+{
+    size_t nt = corners.size()/3;
+
+    // replaying the serial rules is only possible if there are no other edges
+    if (!edgeList.empty()) {
+        for (size_t i=0; i<nt; i++) {
+            addNewTriangle(vertexList[corners[3*i]],
+                           vertexList[corners[3*i+1]],
+                           vertexList[corners[3*i+2]]);
+        }
+        return;
+    }
+
+    linkNewTriangles(corners.data(), nt);
+
+    // sort all half-edges by their undirected vertex pair
+    struct EdgeKey { uint64_t key; uint32_t index; };
+    std::vector<EdgeKey> keys(3*nt);
+    ia_parallel_for(3*nt, [&keys, &corners](size_t b, size_t e) {
+        for (size_t i=b; i<e; i++) {
+            uint64_t a = corners[i], c = corners[(i%3==2) ? i-2 : i+1];
+            keys[i].key = (a<c) ? ((a<<32)|c) : ((c<<32)|a);
+            keys[i].index = (uint32_t)i;
+        }
+    });
+    ia_parallel_sort(keys, [](EdgeKey const& a, EdgeKey const& b) {
+        return (a.key<b.key) || (a.key==b.key && a.index<b.index);
+    });
+
+    // twin all regular pairs, flag everything else for the serial replay
+    std::vector<uint8_t> irregular(3*nt, 0);
+    size_t nk = keys.size();
+    ia_parallel_for(nk, [&](size_t b, size_t e) {
+        // start and end at group boundaries
+        while (b>0 && b<nk && keys[b].key==keys[b-1].key) b++;
+        while (e<nk && keys[e].key==keys[e-1].key) e++;
+        for (size_t i=b; i<e; ) {
+            size_t j = i+1;
+            while (j<nk && keys[j].key==keys[i].key) j++;
+            IAHalfEdge *h0 = edgeList[keys[i].index];
+            if (j-i==2) {
+                IAHalfEdge *h1 = edgeList[keys[i+1].index];
+                if (h0->vertex()!=h1->vertex() && h0->vertex()==h1->next()->vertex()) {
+                    h0->setTwin(h1);
+                    h1->setTwin(h0);
+                    i = j;
+                    continue;
+                }
+            }
+            for (size_t k=i; k<j; k++)
+                irregular[keys[k].index] = 1;
+            i = j;
+        }
+    });
+    std::vector<EdgeKey>().swap(keys);
+
+    // fill the edge index in the original order, and replay irregular edges
+    edgeMap.reserve(3*nt);
+    for (size_t i=0; i<3*nt; i++) {
+        IAHalfEdge *e = edgeList[i];
+        IAVertex *v0 = e->vertex();
+        IAVertex *v1 = e->next()->vertex();
+        if (irregular[i]) {
+            IAHalfEdge *matchingHalfEdge = findSingleEdge(v1, v0);
+            if (matchingHalfEdge) {
+                e->setTwin(matchingHalfEdge);
+                matchingHalfEdge->setTwin(e);
+            }
+        }
+        edgeMap.insert(std::make_pair(IAHalfEdgeKey { v0, v1 }, i));
+    }
+}
+
+
 /**
  * Add a fully initialized half-edge to the mesh for management.
  *
@@ -267,8 +439,8 @@ IAHalfEdge *IAMesh::addHalfEdge(IAHalfEdge *e)
         e->setTwin(matchingHalfEdge);
         matchingHalfEdge->setTwin(e);
     }
+    edgeMap.insert(std::make_pair(IAHalfEdgeKey { v0, v1 }, edgeList.size()));
     edgeList.push_back(e);
-    edgeMap.insert(std::make_pair(v0->pLocalPosition.length()+v1->pLocalPosition.length(), e));
     return matchingHalfEdge;
 }
 
@@ -277,7 +449,7 @@ IAHalfEdge *IAMesh::addHalfEdge(IAHalfEdge *e)
  * Find an edge that connects two vertices.
  *
  * This finds the first edge that connects two vertices, whether it has a twin
- * or not.
+ * or not. If there are duplicates, the one that was added first is returned.
  *
  * \param v0, v1 vertices that make up the half-edge, in the desired order
  *
@@ -285,40 +457,39 @@ IAHalfEdge *IAMesh::addHalfEdge(IAHalfEdge *e)
  */
 IAHalfEdge *IAMesh::findEdge(IAVertex *v0, IAVertex *v1)
 {
-    double key = v0->pLocalPosition.length()+v1->pLocalPosition.length();
-    auto itlow = edgeMap.lower_bound(key-0.0001);
-    auto itup = edgeMap.upper_bound(key+0.0001);
-    for (auto &it=itlow; it!=itup; ++it) {
-        IAHalfEdge *e = (*it).second;
-        IAVertex *ev0 = e->vertex();
-        IAVertex *ev1 = e->next()->vertex();
-        if (ev0==v0 && ev1==v1)
-            return e;
-    }
-    return 0;
+    // the multimap does not keep the order of equal keys, so compare the
+    // indices in edgeList instead
+    auto range = edgeMap.equal_range(IAHalfEdgeKey { v0, v1 });
+    size_t first = SIZE_MAX;
+    for (auto it=range.first; it!=range.second; ++it)
+        first = std::min(first, it->second);
+    if (first==SIZE_MAX)
+        return nullptr;
+    return edgeList[first];
 }
 
 
 /**
  * Find an edge that connects two vertices, and that has no twin.
  *
+ * If there are several, the one that was added first is returned, so damaged
+ * meshes pair up their edges in the same order as before edgeMap was hashed.
+ *
  * \param v0, v1 vertices that make up the half-edge, in the desired order
  *
  * \return a pointer to the edge found, or nullptr if there was none.
  */
 IAHalfEdge *IAMesh::findSingleEdge(IAVertex *v0, IAVertex *v1)
 {
-    double key = v0->pLocalPosition.length()+v1->pLocalPosition.length();
-    auto itlow = edgeMap.lower_bound(key-0.0001);
-    auto itup = edgeMap.upper_bound(key+0.0001);
-    for (auto &it=itlow; it!=itup; ++it) {
-        IAHalfEdge *e = (*it).second;
-        IAVertex *ev0 = e->vertex();
-        IAVertex *ev1 = e->next()->vertex();
-        if (ev0==v0 && ev1==v1 && !e->twin())
-            return e;
+    auto range = edgeMap.equal_range(IAHalfEdgeKey { v0, v1 });
+    size_t first = SIZE_MAX;
+    for (auto it=range.first; it!=range.second; ++it) {
+        if (it->second<first && !edgeList[it->second]->twin())
+            first = it->second;
     }
-    return 0;
+    if (first==SIZE_MAX)
+        return nullptr;
+    return edgeList[first];
 }
 
 
@@ -505,35 +676,27 @@ void IAMesh::projectTexture(double wMult, double hMult, int type)
 /**
  * Add a vertex to a mesh, avoiding duplicates.
  *
- * Find an existing vertex with the given coordinates. If none is found,
- * create a new vertex and add it to list.
+ * Find an existing vertex with the given coordinates, within the tolerance
+ * of the vertex welder. If none is found, create a new vertex and add it to
+ * list.
  *
  * \param pos the position of this vertex in mesh space
  *
  * \return the existing or newly created vertex. There is no way of knowing if
  *      the vertex was found or created.
  *
- * \todo there should probably be a minimal tollerance when comparing positions!
  * \todo create a vertex list class and move this methode there
  */
 IAVertex *IAMesh::findOrAddNewVertex(IAVector3d const& pos)
 {
-    double length = pos.length();
-    auto itlow = vertexMap.lower_bound(length-0.0001);
-    auto itup = vertexMap.upper_bound(length+0.0001);
-
-    for (auto &it=itlow; it!=itup; ++it) {
-        IAVertex *v = (*it).second;
-        if (v->pLocalPosition==pos) {
-            return v;
-        }
-    }
+    IAVertex *v = vertexMap.find(pos);
+    if (v) return v;
 
-    IAVertex *v = new IAVertex();
+    v = newVertex();
     v->pLocalPosition = pos;
     updateBoundingBox(pos);
     vertexList.push_back(v);
-    vertexMap.insert(std::make_pair(v->pLocalPosition.length(), v));
+    vertexMap.insert(v);
     return v;
 }
 
@@ -678,15 +841,40 @@ void IAMesh::position(const IAVector3d &p)
 
 /**
  * Update all variables concerning global space needed for slicing.
+ *
+ * This must be called after the mesh was moved or changed, and before the
+ * mesh is sliced. Slicing itself does not change the mesh, so any number of
+ * slices can then be generated from the same mesh in parallel.
  */
 void IAMesh::updateGlobalSpace()
 {
-    if (pGlobalPositionNeedsUpdate) {
+    if (   pGlobalPositionNeedsUpdate
+        || pZIndex.numTriangles()!=triangleList.size()
+        || pZIndex.numVertices()!=vertexList.size())
+    {
         IAVector3d dp = position();
         for (auto &v: vertexList) {
             v->pGlobalPosition = v->pLocalPosition + dp;
             // \todo apply full mesh transformation
         }
+
+        // index all triangles by their z range
+        size_t nt = triangleList.size(), nv = vertexList.size();
+        std::vector<double> zMin(nt), zMax(nt), vertexZ(nv);
+        ia_parallel_for(nt, [&](size_t b, size_t e) {
+            for (size_t i=b; i<e; i++) {
+                IATriangle *t = triangleList[i];
+                double z0 = t->vertex(0)->pGlobalPosition.z();
+                double z1 = t->vertex(1)->pGlobalPosition.z();
+                double z2 = t->vertex(2)->pGlobalPosition.z();
+                zMin[i] = std::min(z0, std::min(z1, z2));
+                zMax[i] = std::max(z0, std::max(z1, z2));
+            }
+        });
+        for (size_t i=0; i<nv; i++)
+            vertexZ[i] = vertexList[i]->pGlobalPosition.z();
+        pZIndex.build(zMin, zMax, vertexZ);
+
         pGlobalPositionNeedsUpdate = false;
     }
 }
@@ -11,16 +11,44 @@
 #include "IAVertex.h"
 #include "IATriangle.h"
 #include "IAEdge.h"
+#include "IAVertexWelder.h"
+#include "IAMeshArena.h"
+#include "IAMeshZIndex.h"
 
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <stdint.h>
 #include <float.h>
 
 
 class IAPrinter;
 
-typedef std::multimap<double, IAVertex*> IAVertexMap;
-typedef std::multimap<double, IAHalfEdge*> IAHalfEdgeMap;
+/**
+ Key for finding a half-edge by the identity of its start and end vertex.
+ */
+struct IAHalfEdgeKey {
+    IAVertex *v0, *v1;
+    bool operator==(IAHalfEdgeKey const& k) const { return v0==k.v0 && v1==k.v1; }
+};
+
+/**
+ Hash both vertex addresses of a directed edge into a single value.
+ */
+struct IAHalfEdgeKeyHash {
+    size_t operator()(IAHalfEdgeKey const& k) const {
+        uint64_t h = (uint64_t)(uintptr_t)k.v0 * 0x9E3779B97F4A7C15ULL;
+        h ^= (uint64_t)(uintptr_t)k.v1 + 0x7F4A7C159E3779B9ULL + (h<<6) + (h>>2);
+        return (size_t)(h ^ (h>>31));
+    }
+};
+
+/**
+ Half-edges by their start and end vertex. The value is the index of the
+ half-edge in IAMesh::edgeList, so that duplicates can be told apart by the
+ order in which they were added.
+ */
+typedef std::unordered_multimap<IAHalfEdgeKey, size_t, IAHalfEdgeKeyHash> IAHalfEdgeMap;
 
 
 /**
@@ -58,6 +86,31 @@ public:
     void projectTexture(double w, double h, int type);
 
     IATriangle *addNewTriangle(IAVertex *v0, IAVertex *v1, IAVertex *v2);
+    void addNewTriangles(std::vector<uint32_t> const& corners);
+    void addNewTriangles(const uint32_t *corners, size_t nt, const uint32_t *twins);
+
+    /** Allocate a vertex that lives as long as the mesh. The caller must add
+     it to vertexList. \return an uninitialized vertex, owned by the mesh */
+    IAVertex *newVertex() { return pVertexArena.create(); }
+
+    /** Allocate a triangle that lives as long as the mesh.
+     \return a new triangle without edges, owned by the mesh */
+    IATriangle *newTriangle() {
+        IATriangle *t = pTriangleArena.create(this);
+        t->pIndex = (uint32_t)(pTriangleArena.size()-1);
+        return t;
+    }
+
+    /** Number of triangles ever allocated for this mesh.
+     \return a value larger than IATriangle::pIndex of every triangle */
+    size_t numTriangleIndices() const { return pTriangleArena.size(); }
+
+    /** Allocate a half-edge that lives as long as the mesh.
+     \param t, v owning triangle and start vertex
+     \return a new, unlinked half-edge, owned by the mesh */
+    IAHalfEdge *newHalfEdge(IATriangle *t, IAVertex *v) { return pHalfEdgeArena.create(t, v); }
+
+    void printAllocationStats();
 
     IAHalfEdge *findEdge(IAVertex*, IAVertex*);
     IAHalfEdge *findSingleEdge(IAVertex*, IAVertex*);
@@ -72,16 +125,21 @@ public:
 
     void updateGlobalSpace();
 
+    /** Index of all triangles by their z range in global space.
+     \return the index as of the last call to updateGlobalSpace() */
+    IAMeshZIndex const& zIndex() const { return pZIndex; }
+
     /** List of vertices for fast access through indexing. */
     IAVertexList vertexList;
 
-    /** Map of vertices for fast access through the vertex position. */
-    IAVertexMap vertexMap;
+    /** Spatial hash of vertices for fast access through the vertex position. */
+    IAVertexWelder vertexMap;
 
     /** List of all half-edges in the mesh. */
     IAHalfEdgeList edgeList;
 
-    /** Mpa of all half-edges for finding twins and duplicates quickly. */
+    /** Map of all half-edges by their start and end vertex, for finding
+        twins and duplicates in constant time. */
     IAHalfEdgeMap edgeMap;
 
     /** List of all triangles in this mesh */
@@ -94,6 +152,7 @@ public:
     IAVector3d pMax = { FLT_MIN, FLT_MIN, FLT_MIN };
 
 private:
+    void linkNewTriangles(const uint32_t *corners, size_t nt);
     void clearVertexNormals();
     void calculateTriangleNormals();
     void calculateVertexNormals();
@@ -101,10 +160,21 @@ private:
     /** This is true whenever pGlobalPosition and pGlobalNormal need to be recalculated */
     bool pGlobalPositionNeedsUpdate = true;
 
+    /// Triangles sorted by their z range in global space, for slicing
+    IAMeshZIndex pZIndex;
+
     /// Position of this object in scene space
     /// \todo we also need rotation and scale
     IAVector3d pMeshPosition;
 
+    /// All vertices of this mesh are allocated here
+    IAMeshArena<IAVertex> pVertexArena;
+
+    /// All half-edges of this mesh are allocated here
+    IAMeshArena<IAHalfEdge> pHalfEdgeArena;
+
+    /// All triangles of this mesh are allocated here
+    IAMeshArena<IATriangle> pTriangleArena;
 };
 
 
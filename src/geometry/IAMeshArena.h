@@ -0,0 +1,126 @@
+//
+//  IAMeshArena.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_MESH_ARENA_H
+#define IA_MESH_ARENA_H
+
+
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <stddef.h>
+
+
+/**
+ A block allocator for objects that live exactly as long as their mesh.
+
+ Objects are constructed in large blocks of raw memory by simply bumping a
+ pointer. They can not be freed individually. Instead, clear() destroys all
+ objects and releases all blocks at once.
+
+ Blocks start small, so that meshes with only a few objects, like slices,
+ stay small, and grow up to kMaxBlockSize objects for large models.
+ */
+template <class T>
+class IAMeshArena
+{
+public:
+    /** Number of objects in the first block. */
+    static const size_t kMinBlockSize = 256;
+    /** Maximum number of objects in a single block. */
+    static const size_t kMaxBlockSize = 65536;
+
+    /** Create an empty arena. No memory is allocated yet. */
+    IAMeshArena() { }
+
+    /** Destroy all objects and release all memory. */
+    ~IAMeshArena() { clear(); }
+
+    IAMeshArena(IAMeshArena const&) = delete;
+    IAMeshArena &operator=(IAMeshArena const&) = delete;
+
+    /**
+     Construct a new object in the arena.
+     \param args arguments for the constructor of T
+     \return a pointer to the new object, valid until clear() is called
+     */
+    template <typename... Args>
+    T *create(Args&&... args) {
+        if (pBlocks.empty() || pBlockUsed==pBlockSize.back())
+            newBlock();
+        T *obj = new (pBlocks.back() + pBlockUsed) T(std::forward<Args>(args)...);
+        pBlockUsed++;
+        pCount++;
+        pTotalCount++;
+        return obj;
+    }
+
+    /**
+     Destroy all objects and release all blocks.
+     */
+    void clear() {
+        if (!std::is_trivially_destructible<T>::value) {
+            for (size_t i=0; i<pBlocks.size(); i++) {
+                size_t n = (i+1==pBlocks.size()) ? pBlockUsed : pBlockSize[i];
+                for (size_t j=0; j<n; j++)
+                    pBlocks[i][j].~T();
+            }
+        }
+        for (auto &b: pBlocks)
+            ::operator delete(b);
+        pBlocks.clear();
+        pBlockSize.clear();
+        pBlockUsed = 0;
+        pCount = 0;
+        pBytes = 0;
+    }
+
+    /** Number of live objects.
+     \return number of objects created since the last clear() */
+    size_t size() const { return pCount; }
+
+    /** Number of objects created over the lifetime of the arena.
+     \return total number of calls to create() */
+    size_t totalCount() const { return pTotalCount; }
+
+    /** Number of blocks in use.
+     \return number of blocks allocated since the last clear() */
+    size_t blocks() const { return pBlocks.size(); }
+
+    /** Memory reserved by the arena.
+     \return number of bytes allocated since the last clear() */
+    size_t bytes() const { return pBytes; }
+
+private:
+    /** Allocate another block, twice the size of the previous one. */
+    void newBlock() {
+        size_t n = pBlockSize.empty() ? kMinBlockSize : pBlockSize.back()*2;
+        if (n>kMaxBlockSize) n = kMaxBlockSize;
+        pBlocks.push_back(static_cast<T*>(::operator new(n*sizeof(T))));
+        pBlockSize.push_back(n);
+        pBlockUsed = 0;
+        pBytes += n*sizeof(T);
+    }
+
+    /// raw memory for all objects
+    std::vector<T*> pBlocks;
+    /// number of objects that fit into each block
+    std::vector<size_t> pBlockSize;
+    /// number of objects used in the last block
+    size_t pBlockUsed = 0;
+    /// number of live objects
+    size_t pCount = 0;
+    /// number of objects ever created
+    size_t pTotalCount = 0;
+    /// number of bytes in all blocks
+    size_t pBytes = 0;
+};
+
+
+#endif /* IA_MESH_ARENA_H */
+
+
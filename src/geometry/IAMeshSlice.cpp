@@ -9,6 +9,7 @@
 
 #include "Iota.h"
 #include "IAMesh.h"
+#include "IACompactMesh.h"
 #include "view/IAGUIMain.h"
 #include "opengl/IAFramebuffer.h"
 
@@ -85,8 +86,11 @@ bool IAMeshSlice::setNewZ(double z)
 
 /**
  Create the outline of a lid by slicing all meshes at Z.
+
+ IAMesh::updateGlobalSpace() must be called before slicing a mesh. The mesh
+ is not changed, so multiple slices can be generated on different threads.
  */
-void IAMeshSlice::generateRim(IAMesh *mesh)
+void IAMeshSlice::generateRim(IAMesh const* mesh)
 {
     clear();
     addRim(mesh);
@@ -98,37 +102,52 @@ void IAMeshSlice::generateRim(IAMesh *mesh)
  The egde list runs clockwise for a connected outline, and counterclockwise for
  holes. Every outline loop can followed by a null ptr and more outlines.
  */
-void IAMeshSlice::addRim(IAMesh *m)
+void IAMeshSlice::addRim(IAMesh const* m)
 {
     if (!m) return;
     // setup
-    m->updateGlobalSpace();
+    IAMeshZIndex const& index = m->zIndex();
 
     // this is a pretty daft hack. To avoid boundary cases, we test if any of
     // the model's z coordinates are exactly equal to the slicing plane. If they
     // are, we move the z plane a tiny bit and try again.
+    double z = pCurrentZ;
+    while (index.hitsVertex(z))
+        z += 1e-7;
+
+    // only triangles near the slicing plane are visited
+    size_t n;
+    const uint32_t *candidates = index.candidates(z, n);
+    addRim(m, z, candidates, n);
+}
+
+
+/**
+ Create an edge list where a list of triangles intersects with a z plane.
+
+ \param m the mesh, global positions must be up to date
+ \param z cut the mesh here; no vertex may be exactly at z
+ \param triangles indices of all triangles that cross z, and maybe a few more
+ \param n number of triangle indices
+ */
+void IAMeshSlice::addRim(IAMesh const* m, double z, const uint32_t *triangles, size_t n)
+{
+    if (!m) return;
     double oldZ = pCurrentZ;
-    bool done = true;
-    do {
-        done = true;
-        for (auto &v: m->vertexList) {
-            if (v->pGlobalPosition.z()==pCurrentZ) {
-                pCurrentZ += 1e-7;
-                done = false;
-                break;
-            }
-        }
-    } while (!done);
+    pCurrentZ = z;
 
-    // run through all faces and mark them as unused
-    for (auto &t: m->triangleList) {
-        t->pUsed = false;
+    // mark the faces as unused; every face that the rim can reach is listed
+    if (pVisited.size()<m->numTriangleIndices())
+        pVisited.resize(m->numTriangleIndices());
+    for (size_t i=0; i<n; i++) {
+        pVisited[m->triangleList[triangles[i]]->pIndex] = false;
     }
 
-    // run through all faces again and add all faces to the first lid that intersect with zMin
-    for (auto &t: m->triangleList) {
-        if (t->pUsed) continue;
-        t->pUsed = true;
+    // run through the faces again and add all faces to the first lid that intersect with zMin
+    for (size_t i=0; i<n; i++) {
+        IATriangle *t = m->triangleList[triangles[i]];
+        if (pVisited[t->pIndex]) continue;
+        pVisited[t->pIndex] = true;
         if (t->crossesZGlobal(pCurrentZ))
             addFirstRimVertex(t);
     }
@@ -188,8 +207,8 @@ void IAMeshSlice::addFirstRimVertex(IATriangle *t)
         assert(0);
     }
 
-    IAVertex *vCutA = e->findZGlobal(z);
-    if (!vCutA) {
+    IAVertex *vCutA = newVertex();
+    if (!e->findZGlobal(z, *vCutA)) {
         puts("ERROR: addFirstRimVertex failed, no Z point found!");
         assert(0);
     }
@@ -200,9 +219,9 @@ void IAMeshSlice::addFirstRimVertex(IATriangle *t)
         if (!addNextRimVertex(e))
             break;
         t = e->triangle();
-        if (t->pUsed)
+        if (pVisited[t->pIndex])
             break;
-        t->pUsed = true;
+        pVisited[t->pIndex] = true;
     }
 
     if (firstTriangle==t) {
@@ -249,8 +268,8 @@ bool IAMeshSlice::addNextRimVertex(IAHalfEdgePtr &e)
     }
 
     // Cut the new edge at Z
-    IAVertex *vCutB = e->findZGlobal(pCurrentZ);
-    if (!vCutB) {
+    IAVertex *vCutB = newVertex();
+    if (!e->findZGlobal(pCurrentZ, *vCutB)) {
         puts("ERROR: addNextLidVertex failed, no Z point found!");
         assert(0);
     }
@@ -269,6 +288,138 @@ bool IAMeshSlice::addNextRimVertex(IAHalfEdgePtr &e)
 }
 
 
+/**
+ Create an edge list where the slice intersects with a compact mesh.
+
+ This works exactly like addRim(IAMesh*), but walks the index based
+ half-edges of an IACompactMesh. Triangles that do not cross the slice are
+ rejected using their cached z range without touching any vertex.
+ */
+void IAMeshSlice::addRim(IACompactMesh const* m)
+{
+    if (!m) return;
+    IAMeshZIndex const& index = m->zIndex();
+
+    // same daft hack as above: move the slicing plane if it hits a vertex
+    double oldZ = pCurrentZ;
+    while (index.hitsVertex(pCurrentZ))
+        pCurrentZ += 1e-7;
+
+    size_t n;
+    const uint32_t *candidates = index.candidates(pCurrentZ, n);
+    if (pVisited.size()<m->numTriangles())
+        pVisited.resize(m->numTriangles());
+    for (size_t i=0; i<n; i++) {
+        pVisited[candidates[i]] = false;
+    }
+    for (size_t i=0; i<n; i++) {
+        uint32_t t = candidates[i];
+        if (pVisited[t]) continue;
+        pVisited[t] = true;
+        if (m->crossesZGlobal(t, pCurrentZ))
+            addFirstRimVertex(m, t);
+    }
+
+    pCurrentZ = oldZ;
+}
+
+
+/**
+ * Create the edge that cuts a triangle of a compact mesh in half.
+ *
+ * \param m the compact mesh
+ * \param t index of the starting triangle
+ *
+ * \see addFirstRimVertex(IATriangle*)
+ */
+void IAMeshSlice::addFirstRimVertex(IACompactMesh const* m, uint32_t t)
+{
+    double z = pCurrentZ;
+    uint32_t firstTriangle = t;
+
+    double z0 = m->globalZ(m->edgeVertex[3*t]);
+    double z1 = m->globalZ(m->edgeVertex[3*t+1]);
+    double z2 = m->globalZ(m->edgeVertex[3*t+2]);
+
+    uint32_t e = 0;
+    if ( (z0<z) && (z1>z) ) {
+        e = 3*t;
+    } else if ( (z1<z) && (z2>z) ) {
+        e = 3*t+1;
+    } else if ( (z2<z) && (z0>z) ) {
+        e = 3*t+2;
+    } else {
+        puts("ERROR: addFirstRimVertex boundary condition not implemented!");
+        assert(0);
+        return;
+    }
+
+    IAVertex *vCutA = newVertex();
+    if (!m->findZGlobal(e, z, *vCutA)) {
+        puts("ERROR: addFirstRimVertex failed, no Z point found!");
+        assert(0);
+        return;
+    }
+    vertexList.push_back(vCutA);
+
+    for (;;) {
+        if (!addNextRimVertex(m, e))
+            break;
+        t = e/3;
+        if (pVisited[t])
+            break;
+        pVisited[t] = true;
+    }
+
+    if (firstTriangle!=t) {
+        puts("WARNING: the rim of the slice is not a loop. Model not watertight?");
+    }
+
+    pRim.push_back(0L);
+}
+
+
+/**
+ * Create the next rim edge in a compact mesh.
+ *
+ * \param m the compact mesh
+ * \param e index of the half-edge that was cut last; on return, the twin of
+ *      the next half-edge that crosses z
+ *
+ * \return false, if the next half-edge has no twin
+ *
+ * \see addNextRimVertex(IAHalfEdgePtr&)
+ */
+bool IAMeshSlice::addNextRimVertex(IACompactMesh const* m, uint32_t &e)
+{
+    if (m->globalZ(m->edgeVertex[IACompactMesh::prev(e)])<pCurrentZ) {
+        e = IACompactMesh::next(e);
+    } else {
+        e = IACompactMesh::prev(e);
+    }
+
+    IAVertex *vCutB = newVertex();
+    if (!m->findZGlobal(e, pCurrentZ, *vCutB)) {
+        puts("ERROR: addNextLidVertex failed, no Z point found!");
+        assert(0);
+        return false;
+    }
+
+    IAEdge *lidEdge = new IAEdge();
+    lidEdge->pVertex[0] = vertexList.back();
+    lidEdge->pVertex[1] = vCutB;
+    vertexList.push_back(vCutB);
+    pRim.push_back(lidEdge);
+
+    uint32_t twin = m->edgeTwin[e];
+    if (twin==IACompactMesh::kNoTwin)
+        return false;
+
+    e = twin;
+    return true;
+}
+
+
 /**
  Draw the edge where the slice intersects the model.
  */
@@ -353,7 +504,7 @@ void __stdcall tessCombineCallback(GLdouble coords[3],
                          IAVertex *vertex_data[4],
                          GLfloat weight[4], IAVertex **dataOut )
 {
-    IAVertex *v = new IAVertex();
+    IAVertex *v = currentSlice->newVertex();
     v->pLocalPosition.read(coords);
     // or used mesh.addVertex()? It would save space, but be a bit slower.
     currentSlice->vertexList.push_back(v);
@@ -435,7 +586,7 @@ void IAMeshSlice::tesselateLidFromRim()
 void IAMeshSlice::tesselateAndDrawLid(IAFramebuffer *fb)
 {
     fb->bindForRendering(); // make sure we have a square in the buffer
-    if (fb->buffers()==IAFramebuffer::BITMAP) {
+    if (fb->isBitmap()) {
         fb->drawLid(pRim);
     } else {
         tesselateLidFromRim();
@@ -13,6 +13,7 @@
 class IAPrinter;
 class IATriangle;
 class IAFramebuffer;
+class IACompactMesh;
 
 
 /**
@@ -23,6 +24,10 @@ class IAFramebuffer;
  *
  * IAMesh has its own edge list that does not interfere with pRim.
  *
+ * Slicing does not change the sliced mesh. All cut points and flags are kept
+ * in the slice, so any number of slices can be generated from the same mesh
+ * on separate threads.
+ *
  * \todo framebuffer member variables should not be public!
  */
 class IAMeshSlice : public IAMesh
@@ -33,21 +38,31 @@ public:
     virtual void clear() override;
     bool setNewZ(double z);
 
-    void generateRim(IAMesh*);
-    void addRim(IAMesh*);
+    void generateRim(IAMesh const*);
+    void addRim(IAMesh const*);
+    void addRim(IAMesh const* m, double z, const uint32_t *triangles, size_t n);
+    void addRim(IACompactMesh const*);
     void addFirstRimVertex(IATriangle *IATriangle);
     bool addNextRimVertex(IAHalfEdgePtr &edge);
+    void addFirstRimVertex(IACompactMesh const* m, uint32_t t);
+    bool addNextRimVertex(IACompactMesh const* m, uint32_t &edge);
     void drawRim();
     void tesselateAndDrawLid(IAFramebuffer *fb);
     void drawShell();
     void drawFramebuffer();
     void tesselateLidFromRim();
 
+    /** Outline of the slice; loops are separated by nullptr.
+     \return the list of rim edges */
+    IAEdgeList const& rim() const { return pRim; }
+
 private:
     /// edge list describing the outlines of a slice
     IAEdgeList pRim;
     /// current Z layer of the entire slice
     double pCurrentZ = -1e9;
+    /// one flag per triangle of the sliced mesh, set when the rim visited it
+    std::vector<bool> pVisited;
     /// link back to the printer that created the slice, so we can retreive the build volume
     //IAPrinter *pPrinter = nullptr;
 
@@ -0,0 +1,137 @@
+//
+//  IAMeshSweep.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IAMeshSweep.h"
+
+#include "IAMesh.h"
+#include "IAMeshSlice.h"
+#include "app/IAParallel.h"
+
+#include <algorithm>
+#include <functional>
+
+
+/**
+ * Prepare a mesh for slicing.
+ *
+ * This sorts all triangles and vertices by their z coordinate in global space.
+ *
+ * \param mesh the mesh that will be sliced
+ */
+IAMeshSweep::IAMeshSweep(IAMesh *mesh)
+:   pMesh( mesh )
+{
+    if (!mesh) return;
+    mesh->updateGlobalSpace();
+
+    size_t nt = pMesh->triangleList.size(), nv = pMesh->vertexList.size();
+    pTriangleZMin.resize(nt);
+    pTriangleZMax.resize(nt);
+    pEvents.resize(nt);
+    ia_parallel_for(nt, [&](size_t b, size_t e) {
+        for (size_t i=b; i<e; i++) {
+            IATriangle *t = pMesh->triangleList[i];
+            double z0 = t->vertex(0)->pGlobalPosition.z();
+            double z1 = t->vertex(1)->pGlobalPosition.z();
+            double z2 = t->vertex(2)->pGlobalPosition.z();
+            pTriangleZMin[i] = std::min(z0, std::min(z1, z2));
+            pTriangleZMax[i] = std::max(z0, std::max(z1, z2));
+            pEvents[i] = (uint32_t)i;
+        }
+    });
+    ia_parallel_sort(pEvents, [this](uint32_t a, uint32_t b) {
+        double za = pTriangleZMin[a], zb = pTriangleZMin[b];
+        return (za<zb) || (za==zb && a<b);
+    });
+
+    pVertexZ.resize(nv);
+    for (size_t i=0; i<nv; i++)
+        pVertexZ[i] = pMesh->vertexList[i]->pGlobalPosition.z();
+    ia_parallel_sort(pVertexZ, std::less<double>());
+}
+
+
+/**
+ * Release all resources.
+ */
+IAMeshSweep::~IAMeshSweep()
+{
+}
+
+
+/**
+ * Move the slicing plane back to the bottom of the mesh.
+ */
+void IAMeshSweep::restart()
+{
+    pNextEvent = 0;
+    pActive.clear();
+    pNextVertex = 0;
+    pLastZ = -1e9;
+}
+
+
+/**
+ * Create the rim of a single layer.
+ *
+ * The slice is cleared and receives the rim at z, just like
+ * IAMeshSlice::generateRim() would create it.
+ *
+ * \param z height of the layer in global space; should not be lower than
+ *      the previous layer
+ * \param slice receives the rim
+ */
+void IAMeshSweep::slice(double z, IAMeshSlice *slice)
+{
+    if (!slice) return;
+    slice->setNewZ(z);
+    slice->clear();
+    if (!pMesh) return;
+
+    if (z<pLastZ)
+        restart();
+    double zCut = nudge(z);
+    pLastZ = zCut;
+
+    // triangles enter when the plane passes their lowest point...
+    size_t nt = pEvents.size();
+    while (pNextEvent<nt && pTriangleZMin[pEvents[pNextEvent]]<zCut)
+        pActive.push_back(pEvents[pNextEvent++]);
+
+    // ...and leave when it passes their highest point
+    pActive.erase(std::remove_if(pActive.begin(), pActive.end(),
+                                 [this, zCut](uint32_t t) { return pTriangleZMax[t]<zCut; }),
+                  pActive.end());
+
+    slice->addRim(pMesh, zCut, pActive.data(), pActive.size());
+}
+
+
+/**
+ * Move the slicing plane up a tiny bit if it hits a vertex.
+ *
+ * This is the same workaround for boundary cases that
+ * IAMeshSlice::addRim(IAMesh*) uses.
+ *
+ * \param z the requested height
+ *
+ * \return the height where the mesh will actually be cut
+ */
+double IAMeshSweep::nudge(double z)
+{
+    size_t nv = pVertexZ.size();
+    for (;;) {
+        while (pNextVertex<nv && pVertexZ[pNextVertex]<z)
+            pNextVertex++;
+        if (pNextVertex<nv && pVertexZ[pNextVertex]==z)
+            z += 1e-7;
+        else
+            return z;
+    }
+}
+
+
@@ -0,0 +1,77 @@
+//
+//  IAMeshSweep.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_MESH_SWEEP_H
+#define IA_MESH_SWEEP_H
+
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+
+class IAMesh;
+class IAMeshSlice;
+
+
+/**
+ A sweep-plane slicer that creates the rims of many layers in one pass.
+
+ All triangles are sorted by their lowest z coordinate once. While the
+ slicing plane moves up, triangles enter an active set when the plane passes
+ their lowest vertex, and leave it when the plane passes their highest vertex.
+ Every layer then only traces the triangles in the active set, which are
+ exactly the triangles that cross it. Slicing all layers costs
+ O(n log n + output) instead of touching the entire mesh for every layer.
+
+ Layers must be requested with increasing z. Requesting a lower z than the
+ previous layer is allowed, but restarts the sweep from the bottom.
+
+ \code
+ IAMeshSweep sweep(mesh);
+ for (double z: layers) {
+     sweep.slice(z, slice);
+     slice->tesselateAndDrawLid(fb);
+ }
+ \endcode
+
+ The mesh must not be changed or moved while the sweep is in use.
+ */
+class IAMeshSweep
+{
+public:
+    IAMeshSweep(IAMesh *mesh);
+    ~IAMeshSweep();
+    void restart();
+    void slice(double z, IAMeshSlice *slice);
+
+private:
+    double nudge(double z);
+
+    /// the mesh that is sliced
+    IAMesh const* pMesh = nullptr;
+    /// lowest z of every triangle in global space
+    std::vector<double> pTriangleZMin;
+    /// highest z of every triangle in global space
+    std::vector<double> pTriangleZMax;
+    /// triangle indices sorted by their lowest z
+    std::vector<uint32_t> pEvents;
+    /// index of the next triangle in pEvents that enters the active set
+    size_t pNextEvent = 0;
+    /// triangles that may cross the current plane
+    std::vector<uint32_t> pActive;
+    /// z coordinates of all vertices in global space, sorted
+    std::vector<double> pVertexZ;
+    /// index of the first vertex in pVertexZ that is not below the plane
+    size_t pNextVertex = 0;
+    /// height of the previous layer, after nudging
+    double pLastZ = -1e9;
+};
+
+
+#endif /* IA_MESH_SWEEP_H */
+
+
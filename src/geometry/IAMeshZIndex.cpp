@@ -0,0 +1,159 @@
+//
+//  IAMeshZIndex.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IAMeshZIndex.h"
+
+#include "app/IAParallel.h"
+
+#include <algorithm>
+#include <functional>
+
+
+/**
+ * Create an empty index.
+ */
+IAMeshZIndex::IAMeshZIndex()
+{
+}
+
+
+/**
+ * Release all resources.
+ */
+IAMeshZIndex::~IAMeshZIndex()
+{
+}
+
+
+/**
+ * Remove all entries and release their memory.
+ */
+void IAMeshZIndex::clear()
+{
+    pZMin = pZMax = 0.0;
+    pBucketHeight = 1.0;
+    pNumTriangles = 0;
+    std::vector<uint32_t>().swap(pBucketStart);
+    std::vector<uint32_t>().swap(pEntries);
+    std::vector<double>().swap(pVertexZ);
+}
+
+
+/**
+ * Build the index for a mesh.
+ *
+ * \param triangleZMin lowest z coordinate of every triangle in global space
+ * \param triangleZMax highest z coordinate of every triangle in global space
+ * \param vertexZ z coordinate of every vertex in global space; the content
+ *      is taken over by the index and the vector is left empty
+ */
+void IAMeshZIndex::build(std::vector<double> const& triangleZMin,
+                         std::vector<double> const& triangleZMax,
+                         std::vector<double> &vertexZ)
+{
+    clear();
+
+    pVertexZ.swap(vertexZ);
+    ia_parallel_sort(pVertexZ, std::less<double>());
+
+    size_t nt = triangleZMin.size();
+    pNumTriangles = nt;
+    if (nt==0) return;
+
+    double sumHeight = 0.0;
+    pZMin = triangleZMin[0];
+    pZMax = triangleZMax[0];
+    for (size_t t=0; t<nt; t++) {
+        pZMin = std::min(pZMin, triangleZMin[t]);
+        pZMax = std::max(pZMax, triangleZMax[t]);
+        sumHeight += triangleZMax[t] - triangleZMin[t];
+    }
+
+    // Buckets of half the average triangle height put a triangle into four
+    // buckets or less on average. Flat meshes get a single bucket.
+    double height = pZMax - pZMin;
+    double avgHeight = sumHeight / nt;
+    size_t nBuckets = nt;
+    if (avgHeight>0.0)
+        nBuckets = std::min(nBuckets, (size_t)(2.0*height/avgHeight));
+    nBuckets = std::max(nBuckets, (size_t)1);
+    pBucketHeight = height / nBuckets;
+    if (pBucketHeight<=0.0) {
+        pBucketHeight = 1.0;
+        nBuckets = 1;
+    }
+
+    // count the entries per bucket, then fill the buckets in triangle order
+    pBucketStart.assign(nBuckets+1, 0);
+    for (size_t t=0; t<nt; t++) {
+        size_t b1 = bucket(triangleZMax[t]);
+        for (size_t b=bucket(triangleZMin[t]); b<=b1; b++)
+            pBucketStart[b+1]++;
+    }
+    for (size_t b=0; b<nBuckets; b++)
+        pBucketStart[b+1] += pBucketStart[b];
+    pEntries.resize(pBucketStart[nBuckets]);
+    std::vector<uint32_t> fill(pBucketStart.begin(), pBucketStart.end()-1);
+    for (size_t t=0; t<nt; t++) {
+        size_t b1 = bucket(triangleZMax[t]);
+        for (size_t b=bucket(triangleZMin[t]); b<=b1; b++)
+            pEntries[fill[b]++] = (uint32_t)t;
+    }
+}
+
+
+/**
+ * Find all triangles that may cross a z plane.
+ *
+ * The list contains every triangle that has one vertex below z and one equal
+ * or above z, plus a few triangles that are near z. Triangles are listed in
+ * ascending order.
+ *
+ * \param z height in global space
+ * \param[out] n number of triangles in the list
+ *
+ * \return a list of triangle indices, valid until the index is changed
+ */
+const uint32_t *IAMeshZIndex::candidates(double z, size_t &n) const
+{
+    if (pBucketStart.empty() || !(z>pZMin && z<=pZMax)) {
+        n = 0;
+        return nullptr;
+    }
+    size_t b = bucket(z);
+    n = pBucketStart[b+1] - pBucketStart[b];
+    return pEntries.data() + pBucketStart[b];
+}
+
+
+/**
+ * Check if any vertex is exactly at the given height.
+ *
+ * \param z height in global space
+ *
+ * \return true, if at least one vertex has this z coordinate
+ */
+bool IAMeshZIndex::hitsVertex(double z) const
+{
+    return std::binary_search(pVertexZ.begin(), pVertexZ.end(), z);
+}
+
+
+/**
+ * Find the bucket for a z coordinate.
+ *
+ * This function never decreases for increasing z, which guarantees that a
+ * triangle is found in the bucket of every z within its range.
+ */
+size_t IAMeshZIndex::bucket(double z) const
+{
+    if (!(z>pZMin)) return 0;
+    size_t b = (size_t)((z-pZMin)/pBucketHeight);
+    return std::min(b, pBucketStart.size()-2);
+}
+
+
@@ -0,0 +1,76 @@
+//
+//  IAMeshZIndex.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_MESH_Z_INDEX_H
+#define IA_MESH_Z_INDEX_H
+
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ An index that finds all triangles crossing a given z plane.
+
+ The z range of the mesh is split into buckets of equal height. Every triangle
+ is listed in all buckets that its z range touches, in ascending triangle
+ order. A query only visits the triangles in a single bucket. The bucket
+ height is chosen from the average height of the triangles, so that a bucket
+ holds not much more than the triangles that actually cross it, and the index
+ holds no more than four entries per triangle on average.
+
+ The index also keeps a sorted list of all vertex z coordinates, so that the
+ slicer can find out quickly if a slicing plane hits a vertex exactly.
+
+ The index is built in global space and must be rebuilt whenever the mesh
+ changes or moves.
+ */
+class IAMeshZIndex
+{
+public:
+    IAMeshZIndex();
+    ~IAMeshZIndex();
+    void clear();
+
+    void build(std::vector<double> const& triangleZMin,
+               std::vector<double> const& triangleZMax,
+               std::vector<double> &vertexZ);
+
+    const uint32_t *candidates(double z, size_t &n) const;
+    bool hitsVertex(double z) const;
+
+    /** Number of triangles in the index.
+     \return the number of triangles when the index was built */
+    size_t numTriangles() const { return pNumTriangles; }
+
+    /** Number of vertices in the index.
+     \return the number of vertices when the index was built */
+    size_t numVertices() const { return pVertexZ.size(); }
+
+private:
+    size_t bucket(double z) const;
+
+    /// lowest z coordinate of all triangles
+    double pZMin = 0.0;
+    /// highest z coordinate of all triangles
+    double pZMax = 0.0;
+    /// height of a single bucket
+    double pBucketHeight = 1.0;
+    /// number of triangles when the index was built
+    size_t pNumTriangles = 0;
+    /// offset of the first entry of every bucket in pEntries, plus the end
+    std::vector<uint32_t> pBucketStart;
+    /// triangle indices for all buckets, one after the other
+    std::vector<uint32_t> pEntries;
+    /// z coordinates of all vertices, sorted
+    std::vector<double> pVertexZ;
+};
+
+
+#endif /* IA_MESH_Z_INDEX_H */
+
+
@@ -0,0 +1,366 @@
+//
+//  IASupportMap.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IASupportMap.h"
+
+#include "IAMesh.h"
+#include "IATriangleScan.h"
+#include "printer/IAPrinter.h"
+#include "opengl/IARunLengthBitmap.h"
+#include "app/IAParallel.h"
+
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+#include <unordered_map>
+
+
+/// surfaces closer than this to each other are at the same height, in mm
+static const float kSameSurface = 0.01f;
+
+
+/**
+ * Create an empty support map.
+ *
+ * \param printer the raster and print volume are taken from this printer
+ * \param res raster of the framebuffers that will receive the layer masks
+ */
+IASupportMap::IASupportMap(IAPrinter *printer, IAFramebuffer::Resolution res)
+:   pPrinter( printer ),
+    pResolution( res )
+{
+}
+
+
+/**
+ * Analyze a mesh and find all areas that need support.
+ *
+ * \param mesh the mesh at its current position
+ * \param angle faces that are tilted more than this from the vertical need
+ *      support, in degrees
+ * \param icicleRadius the support under an icicle vertex is a disk of this
+ *      radius in mm
+ */
+void IASupportMap::build(IAMesh *mesh, double angle, double icicleRadius)
+{
+    clear();
+    pMesh = mesh;
+    pAngle = angle;
+    pIcicleRadius = icicleRadius;
+    pPrinter->rasterSize(pWidth, pHeight, pResolution==IAFramebuffer::COARSE);
+    if (!mesh || mesh->vertexList.empty()) return;
+
+    mesh->updateGlobalSpace();
+    pMeshPosition = mesh->position();
+    pScaleX = pWidth/pPrinter->pPrintVolume.x();
+    pScaleY = pHeight/pPrinter->pPrintVolume.y();
+
+    // the map covers the footprint of the mesh, plus room for icicles
+    double xMin = DBL_MAX, yMin = DBL_MAX, xMax = -DBL_MAX, yMax = -DBL_MAX;
+    for (auto v: mesh->vertexList) {
+        xMin = std::min(xMin, v->pGlobalPosition.x());
+        xMax = std::max(xMax, v->pGlobalPosition.x());
+        yMin = std::min(yMin, v->pGlobalPosition.y());
+        yMax = std::max(yMax, v->pGlobalPosition.y());
+    }
+    xMin -= icicleRadius; yMin -= icicleRadius;
+    xMax += icicleRadius; yMax += icicleRadius;
+    pX0 = std::max(0, (int)floor(xMin*pScaleX));
+    pY0 = std::max(0, (int)floor(yMin*pScaleY));
+    pW = std::min(pWidth, (int)ceil(xMax*pScaleX)+1) - pX0;
+    pH = std::min(pHeight, (int)ceil(yMax*pScaleY)+1) - pY0;
+    if (pW<=0 || pH<=0) { clear(); return; }
+
+    // same test as IAMesh::drawAngledFaces(); only faces that point up are
+    // the top of some part of the model
+    double ref = cos((90.0+angle)/180.0*M_PI);
+    std::vector<size_t> overhangs, tops;
+    for (size_t i=0; i<mesh->triangleList.size(); i++) {
+        double nz = mesh->triangleList[i]->pNormal.z();
+        if (nz<ref)
+            overhangs.push_back(i);
+        else if (nz>0.0)
+            tops.push_back(i);
+    }
+    std::vector<Icicle> icicles = findIcicles();
+
+    // every thread finds the intervals of its own rows
+    std::vector<std::vector<Interval>> rowIntervals(pH);
+    pFirst.assign((size_t)pW*pH+1, 0);
+    pRowX0.assign(pH, 0);
+    pRowX1.assign(pH, 0);
+    ia_parallel_for((size_t)pH, [&](size_t b, size_t e) {
+        addRows(pY0+(int)b, pY0+(int)e, overhangs, tops, icicles, rowIntervals);
+    }, 64);
+
+    // pFirst holds the number of intervals of every pixel so far
+    size_t n = 0;
+    for (size_t i=1; i<pFirst.size(); i++) {
+        n += pFirst[i];
+        pFirst[i] = (uint32_t)n;
+    }
+    if (n==0) { clear(); return; }
+    pInterval.reserve(n);
+    for (auto &r: rowIntervals) {
+        pInterval.insert(pInterval.end(), r.begin(), r.end());
+        std::vector<Interval>().swap(r);
+    }
+}
+
+
+/**
+ * Check if the map is up to date.
+ *
+ * \param mesh, angle, icicleRadius the parameters for build()
+ *
+ * \return true if build() was called with these parameters, and neither the
+ *      mesh position nor the printer raster changed since
+ */
+bool IASupportMap::isBuiltFor(IAMesh *mesh, double angle, double icicleRadius)
+{
+    if (mesh!=pMesh || angle!=pAngle || icicleRadius!=pIcicleRadius)
+        return false;
+    int w, h;
+    pPrinter->rasterSize(w, h, pResolution==IAFramebuffer::COARSE);
+    if (w!=pWidth || h!=pHeight)
+        return false;
+    return !mesh || mesh->position()==pMeshPosition;
+}
+
+
+/**
+ * Create the support mask of a single layer.
+ *
+ * A pixel needs support if one of its overhangs is above zHigh, and the
+ * model under that overhang is not above zLow.
+ *
+ * \param zLow the model must be at or below this height, usually the layer
+ *      height minus the gap at the bottom of the support
+ * \param zHigh the overhang must be above this height, usually the layer
+ *      height plus the gap at the top of the support
+ *
+ * \return a new bitmap in the raster of the printer, or nullptr if the layer
+ *      needs no support
+ */
+IARunLengthBitmap *IASupportMap::createLayerMask(double zLow, double zHigh) const
+{
+    if (empty()) return nullptr;
+    IARunLengthBitmap *mask = new IARunLengthBitmap(pWidth, pHeight);
+    auto needsSupport = [&](size_t i)->bool {
+        for (uint32_t k=pFirst[i]; k<pFirst[i+1]; k++) {
+            Interval const& s = pInterval[k];
+            if (s.overhangZ>zHigh && s.modelZ<=zLow) return true;
+        }
+        return false;
+    };
+    for (int y=0; y<pH; y++) {
+        size_t row = (size_t)y*pW;
+        int x = pRowX0[y], x1 = pRowX1[y];
+        while (x<x1) {
+            while (x<x1 && !needsSupport(row+x)) x++;
+            int start = x;
+            while (x<x1 && needsSupport(row+x)) x++;
+            if (start<x) mask->addRun(pY0+y, pX0+start, pX0+x);
+        }
+    }
+    if (mask->empty()) {
+        delete mask;
+        return nullptr;
+    }
+    return mask;
+}
+
+
+/**
+ * Estimate the memory that the maps use.
+ *
+ * \return size in bytes
+ */
+size_t IASupportMap::memoryUsed() const
+{
+    return sizeof(*this)
+        + pFirst.capacity()*sizeof(uint32_t)
+        + pInterval.capacity()*sizeof(Interval)
+        + (pRowX0.capacity()+pRowX1.capacity())*sizeof(int);
+}
+
+
+/**
+ * Release the map; the mesh needs no support until build() is called.
+ */
+void IASupportMap::clear()
+{
+    pX0 = pY0 = pW = pH = 0;
+    pFirst.clear(); pFirst.shrink_to_fit();
+    pInterval.clear(); pInterval.shrink_to_fit();
+    pRowX0.clear();
+    pRowX1.clear();
+}
+
+
+/**
+ * Find all vertices that are lower than their neighbours.
+ *
+ * Vertices on the bottom of the mesh stand on the print bed and are not
+ * icicles.
+ *
+ * \return position of every icicle in pixels, and its height
+ */
+std::vector<IASupportMap::Icicle> IASupportMap::findIcicles()
+{
+    double zBed = DBL_MAX;
+    for (auto v: pMesh->vertexList)
+        zBed = std::min(zBed, v->pGlobalPosition.z());
+
+    std::unordered_map<IAVertex*, bool> lowest;
+    lowest.reserve(pMesh->vertexList.size());
+    for (auto t: pMesh->triangleList) {
+        for (int i=0; i<3; i++) {
+            IAVertex *v = t->vertex(i);
+            double z = v->pGlobalPosition.z();
+            bool low = z<t->vertex((i+1)%3)->pGlobalPosition.z()
+                    && z<t->vertex((i+2)%3)->pGlobalPosition.z();
+            auto r = lowest.emplace(v, low);
+            if (!r.second && !low) r.first->second = false;
+        }
+    }
+
+    std::vector<Icicle> icicles;
+    for (auto &l: lowest) {
+        IAVector3d const& v = l.first->pGlobalPosition;
+        if (!l.second || v.z()<=zBed+kSameSurface) continue;
+        icicles.push_back({ v.x()*pScaleX, v.y()*pScaleY, v.z() });
+    }
+    return icicles;
+}
+
+
+/**
+ * Find the intervals that need support in a range of rows.
+ *
+ * Every thread handles its own rows of the map, so no pixel is written by two
+ * threads. Overhang triangles and the disks under icicles are the bottom of an
+ * interval, faces that point up are the top of the model below it.
+ *
+ * \param y0, y1 the rows in pixels, y1 is exclusive
+ * \param overhangs, tops indices of the overhang and upward triangles
+ * \param icicles the icicle vertices, see findIcicles()
+ * \param rowIntervals receives the intervals of every row
+ */
+void IASupportMap::addRows(int y0, int y1, std::vector<size_t> const& overhangs,
+                           std::vector<size_t> const& tops, std::vector<Icicle> const& icicles,
+                           std::vector<std::vector<Interval>> &rowIntervals)
+{
+    std::vector<std::vector<Crossing>> crossings(y1-y0);
+    // upward faces are only needed in the columns of a row that have overhangs
+    std::vector<int> xMin(y1-y0, pX0+pW), xMax(y1-y0, pX0);
+    auto addTriangles = [&](std::vector<size_t> const& triangles, bool isTop) {
+        double p[3][3];
+        for (size_t i: triangles) {
+            IATriangle *t = pMesh->triangleList[i];
+            for (int j=0; j<3; j++) {
+                IAVector3d const& v = t->vertex(j)->pGlobalPosition;
+                p[j][0] = v.x()*pScaleX; p[j][1] = v.y()*pScaleY; p[j][2] = v.z();
+            }
+            ia_scan_triangle(p, pX0, y0, pX0+pW, y1, [&](int y, int xa, int xb, double z, double dz) {
+                int r = y-y0;
+                if (isTop) {
+                    int x = std::max(xa, xMin[r]);
+                    z += (x-xa)*dz;
+                    xa = x;
+                    xb = std::min(xb, xMax[r]);
+                } else {
+                    xMin[r] = std::min(xMin[r], xa);
+                    xMax[r] = std::max(xMax[r], xb);
+                }
+                for (int x=xa; x<xb; x++, z+=dz)
+                    crossings[r].push_back({ x, (float)z, isTop });
+            });
+        }
+    };
+    addTriangles(overhangs, false);
+
+    double rx = pIcicleRadius*pScaleX, ry = pIcicleRadius*pScaleY;
+    for (auto const& ic: icicles) {
+        int ya = std::max(y0, (int)ceil(ic.y-ry-0.5));
+        int yb = std::min(y1, (int)ceil(ic.y+ry-0.5));
+        for (int y=ya; y<yb; y++) {
+            double dy = (y+0.5-ic.y)/ry;
+            double hw = rx*sqrt(std::max(0.0, 1.0-dy*dy));
+            int xa = std::max(pX0, (int)ceil(ic.x-hw-0.5));
+            int xb = std::min(pX0+pW, (int)ceil(ic.x+hw-0.5));
+            int r = y-y0;
+            if (xa<xb) {
+                xMin[r] = std::min(xMin[r], xa);
+                xMax[r] = std::max(xMax[r], xb);
+            }
+            for (int x=xa; x<xb; x++)
+                crossings[r].push_back({ x, (float)ic.z, false });
+        }
+    }
+
+    addTriangles(tops, true);
+
+    for (int y=y0; y<y1; y++) {
+        addRow(y, crossings[y-y0], rowIntervals[y-pY0]);
+        std::vector<Crossing>().swap(crossings[y-y0]);
+    }
+}
+
+
+/**
+ * Turn the faces that cross the pixels of a row into intervals.
+ *
+ * Every pixel column is walked from the top down. An overhang starts an
+ * interval, and the next face below it that points up ends it. Lower
+ * overhangs before that face are inside the same interval. An upward face at
+ * the height of the overhang belongs to an overlapping shell, so the
+ * overhang is inside the model and needs no support.
+ *
+ * \param y the row in pixels
+ * \param crossings all faces that cross the row, will be sorted
+ * \param intervals receives the intervals of the row, pixel by pixel
+ */
+void IASupportMap::addRow(int y, std::vector<Crossing> &crossings, std::vector<Interval> &intervals)
+{
+    std::sort(crossings.begin(), crossings.end(), [](Crossing const& a, Crossing const& b) {
+        return a.x<b.x || (a.x==b.x && a.z>b.z);
+    });
+    int r = y-pY0, x0 = pW, x1 = 0;
+    uint32_t *count = pFirst.data() + (size_t)r*pW + 1 - pX0;
+    for (size_t i=0; i<crossings.size(); ) {
+        int x = crossings[i].x;
+        size_t n = intervals.size();
+        float top = FLT_MAX, overhang = 0.0f;
+        bool open = false;
+        for ( ; i<crossings.size() && crossings[i].x==x; i++) {
+            Crossing const& c = crossings[i];
+            if (c.isTop) {
+                if (open && c.z<overhang-kSameSurface)
+                    intervals.push_back({ c.z, overhang });
+                open = false;
+                top = c.z;
+            } else if (!open && top>=c.z+kSameSurface) {
+                open = true;
+                overhang = c.z;
+            }
+        }
+        if (open)
+            intervals.push_back({ -FLT_MAX, overhang });
+        if (intervals.size()>n) {
+            count[x] = (uint32_t)(intervals.size()-n);
+            x0 = std::min(x0, x-pX0);
+            x1 = std::max(x1, x-pX0+1);
+        }
+    }
+    if (x0<x1) {
+        pRowX0[r] = x0;
+        pRowX1[r] = x1;
+    }
+}
+
+
@@ -0,0 +1,112 @@
+//
+//  IASupportMap.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_SUPPORT_MAP_H
+#define IA_SUPPORT_MAP_H
+
+
+#include "geometry/IAVector3d.h"
+#include "opengl/IAFramebuffer.h"
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+
+class IAMesh;
+class IAPrinter;
+class IARunLengthBitmap;
+
+
+/**
+ A top-down map of all overhangs of a mesh, so that the support of every
+ layer can be found without drawing the mesh again.
+
+ The map is created once per mesh placement. Every triangle that faces down
+ steeper than the support angle is an overhang. So is every "icicle", a
+ vertex that is lower than all its neighbours, which would otherwise start
+ printing in mid-air. For every pixel of the raster, the map stores a short
+ list of intervals, one for every overhang above the pixel: the height of the
+ overhang, and the height of the highest part of the model below it, or
+ nothing if the overhang can be supported from the print bed.
+
+ A layer needs support wherever it is inside one of these intervals, so
+ creating the support mask of a layer is a simple threshold. Overhangs that
+ are stacked above each other all get their own support.
+
+ \code
+ IASupportMap map(printer, IAFramebuffer::COARSE);
+ map.build(mesh, 50.0, 0.6);
+ IARunLengthBitmap *mask = map.createLayerMask(z-0.2, z+0.2);
+ support.logicOr(*mask);
+ \endcode
+ */
+class IASupportMap
+{
+public:
+    IASupportMap(IAPrinter *printer, IAFramebuffer::Resolution res);
+    void build(IAMesh *mesh, double angle, double icicleRadius);
+    bool isBuiltFor(IAMesh *mesh, double angle, double icicleRadius);
+    IARunLengthBitmap *createLayerMask(double zLow, double zHigh) const;
+
+    /** Check for overhangs. \return true if the mesh needs no support at all */
+    bool empty() const { return pRowX0.empty(); }
+    size_t memoryUsed() const;
+
+private:
+    /** The part of a pixel column that needs support */
+    struct Interval {
+        /// height of the highest part of the model below the overhang, or
+        /// -FLT_MAX if the overhang can be supported from the print bed
+        float modelZ;
+        /// height of the overhang
+        float overhangZ;
+    };
+    /** A face that crosses a pixel column, used while building the map */
+    struct Crossing {
+        int x;
+        float z;
+        bool isTop;
+    };
+    /** An icicle vertex in pixels, and its height */
+    struct Icicle {
+        double x, y, z;
+    };
+
+    void clear();
+    std::vector<Icicle> findIcicles();
+    void addRows(int y0, int y1, std::vector<size_t> const& overhangs,
+                 std::vector<size_t> const& tops, std::vector<Icicle> const& icicles,
+                 std::vector<std::vector<Interval>> &rowIntervals);
+    void addRow(int y, std::vector<Crossing> &crossings, std::vector<Interval> &intervals);
+
+    /// needed to find the raster size and the print volume
+    IAPrinter *pPrinter = nullptr;
+    /// raster of the framebuffers that the masks are drawn into
+    IAFramebuffer::Resolution pResolution;
+    /// the mesh that was analyzed, and the parameters of the analysis
+    IAMesh *pMesh = nullptr;
+    IAVector3d pMeshPosition;
+    double pAngle = 0.0, pIcicleRadius = 0.0;
+    /// size of the raster in pixels
+    int pWidth = 0, pHeight = 0;
+    /// pixels per mm
+    double pScaleX = 1.0, pScaleY = 1.0;
+    /// area of the raster that is covered by the map, in pixels
+    int pX0 = 0, pY0 = 0, pW = 0, pH = 0;
+    /// index of the first interval of every pixel in pInterval, plus the end
+    /// of the last pixel
+    std::vector<uint32_t> pFirst;
+    /// intervals of all pixels, row by row, highest first within a pixel
+    std::vector<Interval> pInterval;
+    /// first and last+1 column of overhangs in every row of the map
+    std::vector<int> pRowX0, pRowX1;
+};
+
+
+#endif /* IA_SUPPORT_MAP_H */
+
+
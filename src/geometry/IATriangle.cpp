@@ -29,7 +29,7 @@ IATriangle::IATriangle(IAMesh *m)
  * \return false, if all vertices of the triangle is entirely below z,
  *      or if all vertices are equal of above z.
  */
-bool IATriangle::crossesZGlobal(double zMin)
+bool IATriangle::crossesZGlobal(double zMin) const
 {
     double z0 = vertex(0)->pGlobalPosition.z();
     double z1 = vertex(1)->pGlobalPosition.z();
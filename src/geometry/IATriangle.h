@@ -12,6 +12,7 @@
 #include "IAEdge.h"
 
 #include <vector>
+#include <stdint.h>
 
 
 class IAMesh;
@@ -31,7 +32,7 @@ class IATriangle
 {
 public:
     IATriangle(IAMesh *m);
-    bool crossesZGlobal(double z);
+    bool crossesZGlobal(double z) const;
 
     /** Return one of tree vertices.
      \param i index of vertex
@@ -51,8 +52,9 @@ public:
     /** Triangle face normal, length is 1. */
     IAVector3d pNormal;
 
-    /** Universal user flag, used to help find the slice circumference. */
-    bool pUsed = false;
+    /** Index of this triangle in the order of creation within its mesh, so
+     that slices can keep their own flags per triangle. */
+    uint32_t pIndex = 0;
 
     /** Universal user flag, used to fix holes. */
     bool pPatched = false;
@@ -0,0 +1,62 @@
+//
+//  IATriangleScan.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_TRIANGLE_SCAN_H
+#define IA_TRIANGLE_SCAN_H
+
+
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+
+/**
+ * Find all pixels whose center is inside a triangle, as seen from above.
+ *
+ * The pixels of every row are reported as one span. Pixel centers on an edge
+ * belong to only one of the two triangles that share the edge. Triangles that
+ * are seen edge-on cover no pixels.
+ *
+ * \param p x and y in pixels, and z in any unit, of the three corners
+ * \param x0, y0, x1, y1 only report pixels in this area, x1 and y1 are exclusive
+ * \param fn called as fn(y, xa, xb, z, dz) for every row that contains pixels;
+ *      xb is exclusive, z is the height of the triangle at the center of
+ *      pixel xa, and dz is the change in height from one pixel to the next
+ */
+template <class F>
+void ia_scan_triangle(double const p[3][3], int x0, int y0, int x1, int y1, F fn)
+{
+    double dx1 = p[1][0]-p[0][0], dy1 = p[1][1]-p[0][1], dz1 = p[1][2]-p[0][2];
+    double dx2 = p[2][0]-p[0][0], dy2 = p[2][1]-p[0][1], dz2 = p[2][2]-p[0][2];
+    double d = dx1*dy2 - dx2*dy1;
+    if (fabs(d)<1e-9) return;
+    // the triangle is the plane z = p[0].z + a*(x-p[0].x) + b*(y-p[0].y)
+    double a = (dz1*dy2 - dz2*dy1)/d, b = (dx1*dz2 - dx2*dz1)/d;
+
+    double yMin = std::min(p[0][1], std::min(p[1][1], p[2][1]));
+    double yMax = std::max(p[0][1], std::max(p[1][1], p[2][1]));
+    int r0 = std::max(y0, (int)ceil(yMin-0.5)), r1 = std::min(y1, (int)ceil(yMax-0.5));
+    for (int y=r0; y<r1; y++) {
+        double yc = y+0.5, lo = DBL_MAX, hi = -DBL_MAX;
+        for (int i=0; i<3; i++) {
+            double const* s = p[i];
+            double const* e = p[i==2 ? 0 : i+1];
+            if ((s[1]<=yc) == (e[1]<=yc)) continue;
+            double x = s[0] + (yc-s[1])*(e[0]-s[0])/(e[1]-s[1]);
+            lo = std::min(lo, x);
+            hi = std::max(hi, x);
+        }
+        if (lo>=hi) continue;
+        int xa = std::max(x0, (int)ceil(lo-0.5)), xb = std::min(x1, (int)ceil(hi-0.5));
+        if (xa>=xb) continue;
+        fn(y, xa, xb, p[0][2] + a*(xa+0.5-p[0][0]) + b*(yc-p[0][1]), a);
+    }
+}
+
+
+#endif /* IA_TRIANGLE_SCAN_H */
+
+
@@ -0,0 +1,137 @@
+//
+//  IAVertexWelder.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IAVertexWelder.h"
+
+#include <math.h>
+#include <assert.h>
+
+
+/**
+ * Create an empty welder using the same tolerance as IAVector3d::operator==.
+ */
+IAVertexWelder::IAVertexWelder()
+{
+}
+
+
+/**
+ * Forget all vertices. The vertices themselves are not deleted.
+ */
+void IAVertexWelder::clear()
+{
+    pCellMap.clear();
+}
+
+
+/**
+ * Prepare the welder for a given number of vertices to avoid rehashing.
+ *
+ * \param n expected number of unique vertices
+ */
+void IAVertexWelder::reserve(size_t n)
+{
+    pCellMap.reserve(n);
+}
+
+
+/**
+ * Change the welding tolerance.
+ *
+ * This must be called before any vertex is added, or the grid will no longer
+ * match the vertices that are already stored.
+ *
+ * \param eps vertices are welded if no coordinate differs by more than eps
+ */
+void IAVertexWelder::setEpsilon(double eps)
+{
+    assert(pCellMap.empty());
+    if (eps<=0.0) eps = 1e-7;
+    pEpsilon = eps;
+    // large enough that most lookups only touch a single cell, small enough
+    // that a cell very rarely holds more than one vertex
+    pCellSize = 64.0 * eps;
+}
+
+
+/**
+ * Calculate the grid cell that contains a position.
+ */
+IAVertexWelder::Cell IAVertexWelder::cellFor(IAVector3d const& pos) const
+{
+    return Cell {
+        (int64_t)floor(pos.x()/pCellSize),
+        (int64_t)floor(pos.y()/pCellSize),
+        (int64_t)floor(pos.z()/pCellSize)
+    };
+}
+
+
+/**
+ * Find a vertex in a single cell that is within tolerance of a position.
+ */
+IAVertex *IAVertexWelder::findInCell(Cell const& cell, IAVector3d const& pos) const
+{
+    auto range = pCellMap.equal_range(cell);
+    for (auto it=range.first; it!=range.second; ++it) {
+        IAVertex *v = it->second;
+        IAVector3d const& p = v->pLocalPosition;
+        if (   fabs(p.x()-pos.x())<=pEpsilon
+            && fabs(p.y()-pos.y())<=pEpsilon
+            && fabs(p.z()-pos.z())<=pEpsilon)
+            return v;
+    }
+    return nullptr;
+}
+
+
+/**
+ * Find a vertex that is within tolerance of the given position.
+ *
+ * \param pos position in mesh space
+ *
+ * \return the vertex, or nullptr if there is none
+ */
+IAVertex *IAVertexWelder::find(IAVector3d const& pos) const
+{
+    Cell c = cellFor(pos);
+    IAVertex *v = findInCell(c, pos);
+    if (v) return v;
+
+    // check the neighbouring cells only if we are close to a border
+    int lo[3], hi[3];
+    const double p[3] = { pos.x(), pos.y(), pos.z() };
+    const int64_t ci[3] = { c.x, c.y, c.z };
+    for (int i=0; i<3; i++) {
+        double f = p[i] - ci[i]*pCellSize;
+        lo[i] = (f<=pEpsilon) ? -1 : 0;
+        hi[i] = (f>=pCellSize-pEpsilon) ? 1 : 0;
+    }
+    for (int dx=lo[0]; dx<=hi[0]; dx++) {
+        for (int dy=lo[1]; dy<=hi[1]; dy++) {
+            for (int dz=lo[2]; dz<=hi[2]; dz++) {
+                if (dx==0 && dy==0 && dz==0) continue;
+                v = findInCell(Cell { c.x+dx, c.y+dy, c.z+dz }, pos);
+                if (v) return v;
+            }
+        }
+    }
+    return nullptr;
+}
+
+
+/**
+ * Add a vertex to the grid, using its local position.
+ *
+ * \param v the vertex; no check for duplicates is done
+ */
+void IAVertexWelder::insert(IAVertex *v)
+{
+    pCellMap.insert(std::make_pair(cellFor(v->pLocalPosition), v));
+}
+
+
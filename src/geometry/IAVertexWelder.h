@@ -0,0 +1,78 @@
+//
+//  IAVertexWelder.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_VERTEX_WELDER_H
+#define IA_VERTEX_WELDER_H
+
+
+#include "IAVertex.h"
+
+#include <unordered_map>
+#include <stdint.h>
+
+
+/**
+ Find vertices that share the same position within a given tolerance.
+
+ Positions are quantized into a uniform grid of cubic cells. Every cell is
+ hashed by its integer coordinates, so finding a vertex near a given position
+ takes constant time on average, no matter how many vertices are in the mesh
+ or how they are distributed in space.
+
+ The cell size is a multiple of the welding tolerance. Neighbouring cells
+ are only visited if the position is within tolerance of a cell border.
+ */
+class IAVertexWelder
+{
+public:
+    IAVertexWelder();
+    void clear();
+    void reserve(size_t n);
+    void setEpsilon(double eps);
+
+    /** Return the current welding tolerance.
+     \return the maximum distance per axis for two vertices to be welded */
+    double epsilon() const { return pEpsilon; }
+
+    IAVertex *find(IAVector3d const&) const;
+    void insert(IAVertex*);
+
+private:
+    /** Integer coordinates of a cell in the quantized grid. */
+    struct Cell {
+        int64_t x, y, z;
+        bool operator==(Cell const& c) const { return x==c.x && y==c.y && z==c.z; }
+    };
+
+    /** Spread the bits of all three cell coordinates over the hash value. */
+    struct CellHash {
+        size_t operator()(Cell const& c) const {
+            uint64_t h = (uint64_t)c.x * 0x9E3779B97F4A7C15ULL;
+            h ^= (uint64_t)c.y * 0xC2B2AE3D27D4EB4FULL;
+            h ^= (uint64_t)c.z * 0x165667B19E3779F9ULL;
+            return (size_t)(h ^ (h>>29));
+        }
+    };
+
+    typedef std::unordered_multimap<Cell, IAVertex*, CellHash> IACellMap;
+
+    Cell cellFor(IAVector3d const&) const;
+    IAVertex *findInCell(Cell const&, IAVector3d const&) const;
+
+    /// Vertices are welded if all three coordinates differ by this or less
+    double pEpsilon = 1e-7;
+
+    /// Edge length of a single grid cell
+    double pCellSize = 64e-7;
+
+    /// All vertices, sorted into grid cells
+    IACellMap pCellMap;
+};
+
+
+#endif /* IA_VERTEX_WELDER_H */
+
+
@@ -0,0 +1,293 @@
+//
+//  IABitmapKernels.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IABitmapKernels.h"
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+# define IA_BITMAP_X86 1
+# include <immintrin.h>
+# ifdef _MSC_VER
+#  include <intrin.h>
+# endif
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+# define IA_BITMAP_NEON 1
+# include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+# define IA_TARGET(x) __attribute__((target(x)))
+#else
+# define IA_TARGET(x)
+#endif
+
+
+// ---- plain C++ --------------------------------------------------------------
+
+static void scalarAnd(potrace_word *dst, const potrace_word *src, size_t n)
+{
+    for (size_t i=0; i<n; i++) dst[i] &= src[i];
+}
+
+static void scalarAndNot(potrace_word *dst, const potrace_word *src, size_t n)
+{
+    for (size_t i=0; i<n; i++) dst[i] &= ~src[i];
+}
+
+static void scalarOr(potrace_word *dst, const potrace_word *src, size_t n)
+{
+    for (size_t i=0; i<n; i++) dst[i] |= src[i];
+}
+
+static void scalarXor(potrace_word *dst, const potrace_word *src, size_t n)
+{
+    for (size_t i=0; i<n; i++) dst[i] ^= src[i];
+}
+
+/**
+ * Count the bits in a word without relying on a popcnt instruction.
+ */
+static inline size_t popCountWord(potrace_word w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (size_t)__builtin_popcountl(w);
+#else
+    size_t c = 0;
+    for (unsigned i=0; i<sizeof(w); i+=4) {
+        uint32_t v = (uint32_t)(w >> (8*i));
+        v = v - ((v >> 1) & 0x55555555);
+        v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+        c += (((v + (v >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+    }
+    return c;
+#endif
+}
+
+static size_t scalarPopCount(const potrace_word *src, size_t n)
+{
+    size_t c = 0;
+    for (size_t i=0; i<n; i++) c += popCountWord(src[i]);
+    return c;
+}
+
+static const IABitmapKernels kScalarKernels = {
+    scalarAnd, scalarAndNot, scalarOr, scalarXor, scalarPopCount, "scalar"
+};
+
+
+// ---- x86 --------------------------------------------------------------------
+
+#ifdef IA_BITMAP_X86
+
+/*
+ Vector loops work on bytes. The words that don't fill an entire vector at
+ the end of the buffer are handed to the scalar version.
+ */
+#define IA_BITMAP_BINARY(TARGET, NAME, TYPE, LOAD, STORE, EXPR, TAIL) \
+IA_TARGET(TARGET) static void NAME(potrace_word *dst, const potrace_word *src, size_t n) \
+{ \
+    unsigned char *d = (unsigned char*)dst; \
+    const unsigned char *s = (const unsigned char*)src; \
+    size_t nb = n*sizeof(potrace_word), i = 0; \
+    for ( ; i+sizeof(TYPE)<=nb; i+=sizeof(TYPE)) { \
+        TYPE a = LOAD((const TYPE*)(d+i)); \
+        TYPE b = LOAD((const TYPE*)(s+i)); \
+        STORE((TYPE*)(d+i), EXPR); \
+    } \
+    i /= sizeof(potrace_word); \
+    TAIL(dst+i, src+i, n-i); \
+}
+
+IA_BITMAP_BINARY("sse2", sse2And, __m128i, _mm_loadu_si128, _mm_storeu_si128, _mm_and_si128(a, b), scalarAnd)
+IA_BITMAP_BINARY("sse2", sse2AndNot, __m128i, _mm_loadu_si128, _mm_storeu_si128, _mm_andnot_si128(b, a), scalarAndNot)
+IA_BITMAP_BINARY("sse2", sse2Or, __m128i, _mm_loadu_si128, _mm_storeu_si128, _mm_or_si128(a, b), scalarOr)
+IA_BITMAP_BINARY("sse2", sse2Xor, __m128i, _mm_loadu_si128, _mm_storeu_si128, _mm_xor_si128(a, b), scalarXor)
+
+IA_BITMAP_BINARY("avx2", avx2And, __m256i, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_and_si256(a, b), scalarAnd)
+IA_BITMAP_BINARY("avx2", avx2AndNot, __m256i, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_andnot_si256(b, a), scalarAndNot)
+IA_BITMAP_BINARY("avx2", avx2Or, __m256i, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_or_si256(a, b), scalarOr)
+IA_BITMAP_BINARY("avx2", avx2Xor, __m256i, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_xor_si256(a, b), scalarXor)
+
+/**
+ * Count bits 16 bytes at a time, adding bit pairs, nibbles, and bytes.
+ */
+IA_TARGET("sse2") static size_t sse2PopCount(const potrace_word *src, size_t n)
+{
+    const unsigned char *s = (const unsigned char*)src;
+    size_t nb = n*sizeof(potrace_word), i = 0;
+    const __m128i m1 = _mm_set1_epi8(0x55), m2 = _mm_set1_epi8(0x33), m4 = _mm_set1_epi8(0x0F);
+    __m128i acc = _mm_setzero_si128();
+    for ( ; i+16<=nb; i+=16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s+i));
+        v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi16(v, 1), m1));
+        v = _mm_add_epi8(_mm_and_si128(v, m2), _mm_and_si128(_mm_srli_epi16(v, 2), m2));
+        v = _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi16(v, 4)), m4);
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(v, _mm_setzero_si128()));
+    }
+    uint64_t sum[2];
+    _mm_storeu_si128((__m128i*)sum, acc);
+    i /= sizeof(potrace_word);
+    return (size_t)(sum[0] + sum[1]) + scalarPopCount(src+i, n-i);
+}
+
+/**
+ * Count bits 32 bytes at a time by looking up every nibble in a table.
+ */
+IA_TARGET("avx2") static size_t avx2PopCount(const potrace_word *src, size_t n)
+{
+    const unsigned char *s = (const unsigned char*)src;
+    size_t nb = n*sizeof(potrace_word), i = 0;
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i m4 = _mm256_set1_epi8(0x0F);
+    __m256i acc = _mm256_setzero_si256();
+    for ( ; i+32<=nb; i+=32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s+i));
+        __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, m4));
+        __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), m4));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+    }
+    uint64_t sum[4];
+    _mm256_storeu_si256((__m256i*)sum, acc);
+    i /= sizeof(potrace_word);
+    return (size_t)(sum[0] + sum[1] + sum[2] + sum[3]) + scalarPopCount(src+i, n-i);
+}
+
+static const IABitmapKernels kSSE2Kernels = {
+    sse2And, sse2AndNot, sse2Or, sse2Xor, sse2PopCount, "SSE2"
+};
+
+static const IABitmapKernels kAVX2Kernels = {
+    avx2And, avx2AndNot, avx2Or, avx2Xor, avx2PopCount, "AVX2"
+};
+
+/**
+ * Check if the CPU and the operating system support AVX2.
+ */
+static bool cpuHasAVX2()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0]<7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1<<27)) != 0, avx = (info[2] & (1<<28)) != 0;
+    if (!osxsave || !avx) return false;
+    if ((_xgetbv(0) & 6) != 6) return false; // OS saves the YMM registers
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1<<5)) != 0;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Check if the CPU supports SSE2; all 64-bit CPUs do.
+ */
+static bool cpuHasSSE2()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return true;
+#elif defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1<<26)) != 0;
+#else
+    return false;
+#endif
+}
+
+#endif /* IA_BITMAP_X86 */
+
+
+// ---- ARM --------------------------------------------------------------------
+
+#ifdef IA_BITMAP_NEON
+
+#define IA_BITMAP_NEON_BINARY(NAME, OP, TAIL) \
+static void NAME(potrace_word *dst, const potrace_word *src, size_t n) \
+{ \
+    uint8_t *d = (uint8_t*)dst; \
+    const uint8_t *s = (const uint8_t*)src; \
+    size_t nb = n*sizeof(potrace_word), i = 0; \
+    for ( ; i+16<=nb; i+=16) \
+        vst1q_u8(d+i, OP(vld1q_u8(d+i), vld1q_u8(s+i))); \
+    i /= sizeof(potrace_word); \
+    TAIL(dst+i, src+i, n-i); \
+}
+
+IA_BITMAP_NEON_BINARY(neonAnd, vandq_u8, scalarAnd)
+IA_BITMAP_NEON_BINARY(neonAndNot, vbicq_u8, scalarAndNot)
+IA_BITMAP_NEON_BINARY(neonOr, vorrq_u8, scalarOr)
+IA_BITMAP_NEON_BINARY(neonXor, veorq_u8, scalarXor)
+
+/**
+ * Count bits 16 bytes at a time with the vector bit count instruction.
+ */
+static size_t neonPopCount(const potrace_word *src, size_t n)
+{
+    const uint8_t *s = (const uint8_t*)src;
+    size_t nb = n*sizeof(potrace_word), i = 0;
+    uint64x2_t acc = vdupq_n_u64(0);
+    for ( ; i+16<=nb; i+=16) {
+        uint8x16_t c = vcntq_u8(vld1q_u8(s+i));
+        acc = vpadalq_u32(acc, vpaddlq_u16(vpaddlq_u8(c)));
+    }
+    i /= sizeof(potrace_word);
+    return (size_t)(vgetq_lane_u64(acc, 0) + vgetq_lane_u64(acc, 1))
+        + scalarPopCount(src+i, n-i);
+}
+
+static const IABitmapKernels kNEONKernels = {
+    neonAnd, neonAndNot, neonOr, neonXor, neonPopCount, "NEON"
+};
+
+#endif /* IA_BITMAP_NEON */
+
+
+// ---- dispatch ---------------------------------------------------------------
+
+/**
+ * Find the fastest kernels for this CPU.
+ *
+ * The CPU is checked only on the first call.
+ *
+ * \return a set of kernels that the CPU supports
+ */
+IABitmapKernels const& IABitmapKernels::best()
+{
+    static IABitmapKernels const& k = []() -> IABitmapKernels const& {
+#if defined(IA_BITMAP_X86)
+        if (cpuHasAVX2()) return kAVX2Kernels;
+        if (cpuHasSSE2()) return kSSE2Kernels;
+#elif defined(IA_BITMAP_NEON)
+        return kNEONKernels;
+#endif
+        return kScalarKernels;
+    }();
+    return k;
+}
+
+
+/**
+ * Kernels in plain C++ that run on every CPU.
+ *
+ * \return a set of kernels that do not use vector instructions
+ */
+IABitmapKernels const& IABitmapKernels::scalar()
+{
+    return kScalarKernels;
+}
+
+
@@ -0,0 +1,61 @@
+//
+//  IABitmapKernels.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_BITMAP_KERNELS_H
+#define IA_BITMAP_KERNELS_H
+
+
+#include "potrace/potracelib.h"
+
+#include <stddef.h>
+
+
+/**
+ A set of functions that combine or count the words of bitmaps.
+
+ There is one set for every instruction set that we know about: plain C++,
+ SSE2, AVX2 on x86 CPUs, and NEON on ARM CPUs. best() checks the CPU once at
+ runtime and returns the fastest set that it supports. All sets give the same
+ results.
+
+ The functions don't know about scanlines, so the caller can hand over any
+ number of rows at once, as long as they are contiguous in memory.
+
+ \code
+ IABitmapKernels const& k = IABitmapKernels::best();
+ k.bitAnd(dst->map, src->map, dst->dy*dst->h);
+ \endcode
+ */
+class IABitmapKernels
+{
+public:
+    /** A function that combines n words from src into dst. */
+    typedef void (*BinaryOp)(potrace_word *dst, const potrace_word *src, size_t n);
+
+    /** A function that counts the bits that are set in n words. */
+    typedef size_t (*CountOp)(const potrace_word *src, size_t n);
+
+    static IABitmapKernels const& best();
+    static IABitmapKernels const& scalar();
+
+    /// dst = dst & src
+    BinaryOp bitAnd;
+    /// dst = dst & ~src
+    BinaryOp bitAndNot;
+    /// dst = dst | src
+    BinaryOp bitOr;
+    /// dst = dst ^ src
+    BinaryOp bitXor;
+    /// number of set bits
+    CountOp popCount;
+    /// name of the instruction set, for diagnostics
+    const char *name;
+};
+
+
+#endif /* IA_BITMAP_KERNELS_H */
+
+
@@ -0,0 +1,58 @@
+//
+//  IAEdgeCoverage.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IAEdgeCoverage.h"
+
+
+const int IAEdgeCoverage::kSamples;
+const int IAEdgeCoverage::kSubdivision;
+
+
+/**
+ * Set the coverage of a pixel.
+ *
+ * \param x, y pixel position
+ * \param n number of samples inside the shape; pixels with none or all
+ *      samples inside are removed
+ */
+void IAEdgeCoverage::set(int x, int y, int n)
+{
+    if (n<=0 || n>=kSamples)
+        pSamples.erase(key(x, y));
+    else
+        pSamples[key(x, y)] = (uint8_t)n;
+}
+
+
+/**
+ * Get the coverage of a pixel.
+ *
+ * \param x, y pixel position
+ * \param n returned if the pixel is not an edge pixel, usually 0 or kSamples
+ *      depending on the pixel in the bitmap
+ *
+ * \return number of samples inside the shape
+ */
+int IAEdgeCoverage::get(int x, int y, int n) const
+{
+    auto it = pSamples.find(key(x, y));
+    return (it==pSamples.end()) ? n : it->second;
+}
+
+
+/**
+ * Call a function for every edge pixel, in no particular order.
+ *
+ * \param fn receives the pixel position and the number of samples inside
+ */
+void IAEdgeCoverage::forEach(std::function<void(int x, int y, int n)> const& fn) const
+{
+    for (auto &s: pSamples)
+        fn((int)(uint32_t)s.first, (int)(s.first>>32), s.second);
+}
+
+
@@ -0,0 +1,58 @@
+//
+//  IAEdgeCoverage.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_EDGE_COVERAGE_H
+#define IA_EDGE_COVERAGE_H
+
+
+#include <unordered_map>
+#include <functional>
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ The fraction of every edge pixel of a bitmap that is covered by the shape
+ that was drawn into it.
+
+ Pixels are sampled on a 4x4 grid. A pixel is set in the bitmap if at least
+ half of its samples are inside the shape. Only pixels with some, but not all
+ samples inside are stored here; all other pixels are fully covered if they
+ are set, and not covered at all if they are clear.
+
+ Tracers use the coverage to place contours between pixel corners, so that
+ a bitmap of a quarter of the pixels gives the same accuracy.
+ */
+class IAEdgeCoverage
+{
+public:
+    /// number of samples per pixel
+    static const int kSamples = 16;
+    /// number of sample rows and columns per pixel
+    static const int kSubdivision = 4;
+
+    void clear() { pSamples.clear(); }
+    void set(int x, int y, int n);
+    int get(int x, int y, int n) const;
+    void forEach(std::function<void(int x, int y, int n)> const& fn) const;
+
+    /** Check for edge pixels. \return true if no pixel is stored */
+    bool empty() const { return pSamples.empty(); }
+    /** Number of edge pixels. \return pixel count */
+    size_t size() const { return pSamples.size(); }
+
+private:
+    /** Pack a pixel position into a key. \return the key */
+    static uint64_t key(int x, int y) { return ((uint64_t)(uint32_t)y<<32) | (uint32_t)x; }
+
+    /// number of samples inside the shape for every edge pixel
+    std::unordered_map<uint64_t, uint8_t> pSamples;
+};
+
+
+#endif /* IA_EDGE_COVERAGE_H */
+
+
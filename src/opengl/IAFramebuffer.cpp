@@ -11,10 +11,27 @@
 #include "toolpath/IAToolpath.h"
 #include "potrace/IAPotrace.h"
 #include "potrace/bitmap.h"
+#include "opengl/IATiledBitmap.h"
+#include "opengl/IARunLengthBitmap.h"
+#include "opengl/IAStripePattern.h"
+#include "opengl/IAEdgeCoverage.h"
+#include "opengl/IAIsoContours.h"
+#include "opengl/IAFramebufferPool.h"
+#include "geometry/IAMesh.h"
+#include "geometry/IATriangleScan.h"
 #include "printer/IAPrinter.h"
+#include "app/IAParallel.h"
 
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
 #include <math.h>
+#include <float.h>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <atomic>
+#include <functional>
 //#include <FL/images/jpeglib.h>
 #include <jpeg/jpeglib.h>
 #include <png/png.h>
@@ -130,16 +147,18 @@ if (!a##EXT) { Iota.Error.set("Initializing OpenGL", IAError::OpenGLFeatureNotSu
 /**
  * Create a framebuffer object.
  *
- * For now, we do not allow any parameters. We create a 256x256 big buffer
- * with a color buffer with RGBA8 and a depth buffer of 24 bits.
+ * The size of the buffer is taken from the printer when the buffer is created,
+ * so that it always follows the current printer settings.
  *
  * Creating the buffers is deferred until they are actually needed.
  *
  * \param printer used for scaling GL to build volume
  * \param buffers request a certain type of buffers
+ * \param res use the fine or the coarse raster of the printer
  */
-IAFramebuffer::IAFramebuffer(IAPrinter *printer, Buffers buffers)
+IAFramebuffer::IAFramebuffer(IAPrinter *printer, Buffers buffers, Resolution res)
 :   pBuffers( buffers ),
+    pResolution( res ),
     pPrinter( printer )
 {
     // variables are initialized inline
@@ -152,20 +171,71 @@ IAFramebuffer::IAFramebuffer(IAPrinter *printer, Buffers buffers)
  * \param src copy the parameters and content from this buffer
  */
 IAFramebuffer::IAFramebuffer(IAFramebuffer *src)
-:   pBuffers( src->pBuffers ),
+:   IAFramebuffer(src, src->pBuffers, src->pResolution)
+{
+}
+
+
+/**
+ * Create a framebuffer of a given type by copying another framebuffer.
+ *
+ * \param src copy the parameters and content from this buffer
+ * \param buffers type of the new buffer
+ */
+IAFramebuffer::IAFramebuffer(IAFramebuffer *src, Buffers buffers)
+:   IAFramebuffer(src, buffers, src->pResolution)
+{
+}
+
+
+/**
+ * Create a framebuffer of a given type and raster by copying another framebuffer.
+ *
+ * Dense and tiled bitmaps can be converted into each other, and OpenGL
+ * buffers can be copied into other OpenGL buffers. If the rasters differ in
+ * size, the contents are resampled.
+ *
+ * \param src copy the parameters and content from this buffer
+ * \param buffers type of the new buffer
+ * \param res raster of the new buffer
+ */
+IAFramebuffer::IAFramebuffer(IAFramebuffer *src, Buffers buffers, Resolution res)
+:   pBuffers( buffers ),
+    pResolution( res ),
     pPrinter( src->pPrinter )
 {
+    if (res==src->pResolution) {
+        pWidth = src->pWidth;
+        pHeight = src->pHeight;
+    }
     if (src->hasFBO()) {
         bindForRendering();
-        if (pBuffers==BITMAP) {
-            /** \bug assuming that all framebuffers have the same resolution */
-            pBitmap = bm_dup(src->pBitmap);
+        bool sameSize = (pWidth==src->pWidth && pHeight==src->pHeight);
+        if (isBitmap() && src->isBitmap() && !sameSize) {
+            resampleBitmap(src);
+        } else if (isBitmap() && src->isBitmap()) {
+            // the new bitmap is clear, so only the dirty area must be copied
+            int x0, y0, x1, y1;
+            src->dirtyBox(x0, y0, x1, y1);
+            if (x0<x1) {
+                if (pBuffers==BITMAP && src->pBuffers==BITMAP) {
+                    int w0 = x0/BM_WORDBITS, w1 = (x1+BM_WORDBITS-1)/BM_WORDBITS;
+                    for (int y=y0; y<y1; y++)
+                        memcpy(bm_scanline(pBitmap, y)+w0, bm_scanline(src->pBitmap, y)+w0,
+                               (size_t)(w1-w0)*BM_WORDSIZE);
+                } else {
+                    combineBitmap(src, kOr, x0, y0, x1, y1);
+                }
+                markDirty(x0, y0, x1, y1);
+            }
+        } else if (isBitmap() || src->isBitmap()) {
+            puts("IAFramebuffer: can't copy between bitmap and OpenGL buffers");
         } else {
             glBindFramebufferEXT(GL_READ_FRAMEBUFFER, src->pFramebuffer);
             IA_HANDLE_GL_ERRORS();
             glBindFramebufferEXT(GL_DRAW_FRAMEBUFFER, pFramebuffer);
             IA_HANDLE_GL_ERRORS();
-            glBlitFramebufferEXT(0, 0, pWidth, pHeight,
+            glBlitFramebufferEXT(0, 0, src->pWidth, src->pHeight,
                                  0, 0, pWidth, pHeight,
                                  GL_COLOR_BUFFER_BIT, GL_NEAREST);
             IA_HANDLE_GL_ERRORS();
@@ -175,6 +245,455 @@ IAFramebuffer::IAFramebuffer(IAFramebuffer *src)
 }
 
 
+/**
+ * Copy a bitmap buffer of a different size into this empty bitmap buffer.
+ *
+ * Every pixel takes the value of the source pixel under its center, which is
+ * good enough for masks of infill and support. Only the area that covers the
+ * dirty box of src is visited.
+ *
+ * \param src a bitmap buffer covering the same print volume
+ */
+void IAFramebuffer::resampleBitmap(IAFramebuffer *src)
+{
+    int sx0, sy0, sx1, sy1;
+    src->dirtyBox(sx0, sy0, sx1, sy1);
+    if (sx0>=sx1 || sy0>=sy1) return;
+    double fx = (double)src->pWidth/pWidth, fy = (double)src->pHeight/pHeight;
+    int x0 = std::max(0, (int)floor(sx0/fx)), x1 = std::min(pWidth, (int)ceil(sx1/fx)+1);
+    int y0 = std::max(0, (int)floor(sy0/fy)), y1 = std::min(pHeight, (int)ceil(sy1/fy)+1);
+    if (x0>=x1 || y0>=y1) return;
+    // source column for every destination column
+    std::vector<int> srcX(x1-x0);
+    for (int x=x0; x<x1; x++)
+        srcX[x-x0] = std::min(src->pWidth-1, (int)((x+0.5)*fx));
+    int w0 = x0/BM_WORDBITS, w1 = (x1+BM_WORDBITS-1)/BM_WORDBITS;
+    // threads must not allocate tiles in the same row of tiles
+    size_t chunk = (pBuffers==TILED) ? (size_t)(y1-y0) : 64;
+    ia_parallel_for((size_t)(y1-y0), [&](size_t b, size_t e) {
+        for (int y=y0+(int)b; y<y0+(int)e; y++) {
+            int ys = std::min(src->pHeight-1, (int)((y+0.5)*fy));
+            if (ys<sy0 || ys>=sy1) continue;
+            for (int w=w0; w<w1; w++) {
+                potrace_word m = 0;
+                int xa = std::max(x0, w*BM_WORDBITS), xb = std::min(x1, (w+1)*BM_WORDBITS);
+                for (int x=xa; x<xb; x++) {
+                    int xs = srcX[x-x0];
+                    if (xs>=sx0 && xs<sx1 && src->getPixel(xs, ys))
+                        m |= bm_mask(x);
+                }
+                if (m) *wordAt(w, y, true) |= m;
+            }
+        }
+    }, chunk);
+    markDirty(x0, y0, x1, y1);
+}
+
+
+/**
+ * Find a bitmap of the size of this buffer with the contents of src.
+ *
+ * Buffers that were created before the printer raster or the print volume
+ * changed have a different size. They are resampled into a temporary buffer,
+ * so that logic operations never read or write past the end of a row.
+ *
+ * \param src a bitmap buffer
+ * \param tmp receives the resampled buffer, if one is needed
+ *
+ * \return src, or the resampled buffer in tmp
+ */
+IAFramebuffer *IAFramebuffer::sameSizeBitmap(IAFramebuffer *src, std::unique_ptr<IAFramebuffer> &tmp)
+{
+    if (pWidth==src->pWidth && pHeight==src->pHeight)
+        return src;
+    tmp.reset(new IAFramebuffer(pPrinter, BITMAP, pResolution));
+    tmp->pWidth = pWidth;
+    tmp->pHeight = pHeight;
+    tmp->bindForRendering();
+    tmp->resampleBitmap(src);
+    tmp->unbindFromRendering();
+    return tmp.get();
+}
+
+
+/**
+ * Combine the words of a bitmap within a box with the bitmap in src.
+ *
+ * Both bitmaps can be dense or tiled. Dense bitmaps are combined in blocks of
+ * rows. Otherwise, the box is split along the tile grid, and tiles that don't
+ * exist are skipped or resolved without looking at their words. Rows of tiles
+ * are combined on multiple threads. The box is rounded out to entire words.
+ *
+ * \param src the other bitmap, must have the same size, see sameSizeBitmap()
+ * \param op the logic operation
+ * \param x0, y0, x1, y1 the area in pixels, x1 and y1 are exclusive
+ */
+void IAFramebuffer::combineBitmap(IAFramebuffer *src, BitOp op,
+                                  int x0, int y0, int x1, int y1)
+{
+    dropEdgeCoverage();
+    if (pWidth!=src->pWidth || pHeight!=src->pHeight) {
+        puts("IAFramebuffer: can't combine bitmaps of different sizes");
+        return;
+    }
+    if (x0>=x1 || y0>=y1) return;
+    IABitmapKernels const& k = IABitmapKernels::best();
+    IABitmapKernels::BinaryOp fn = k.bitXor;
+    switch (op) {
+        case kAnd: fn = k.bitAnd; break;
+        case kAndNot: fn = k.bitAndNot; break;
+        case kOr: fn = k.bitOr; break;
+        case kXor: fn = k.bitXor; break;
+    }
+    int w0 = x0/BM_WORDBITS, w1 = (x1+BM_WORDBITS-1)/BM_WORDBITS;
+
+    if (pBuffers==BITMAP && src->pBuffers==BITMAP) {
+        potrace_bitmap_t *d = pBitmap, *s = src->pBitmap;
+        if (d->dy==s->dy && d->dy==w1 && w0==0) {
+            // all rows are contiguous in memory
+            size_t dy = (size_t)d->dy;
+            ia_parallel_for((size_t)(y1-y0), [&](size_t b, size_t e) {
+                fn(bm_scanline(d, y0+b), bm_scanline(s, y0+b), (e-b)*dy);
+            }, 256);
+        } else {
+            ia_parallel_for((size_t)(y1-y0), [&](size_t b, size_t e) {
+                for (size_t y=y0+b; y<y0+e; y++)
+                    fn(bm_scanline(d, y)+w0, bm_scanline(s, y)+w0, (size_t)(w1-w0));
+            }, 256);
+        }
+        return;
+    }
+
+    const int tw = IATiledBitmap::kTileWords, tr = IATiledBitmap::kTileRows;
+    int wordsPerRow = (pWidth+BM_WORDBITS-1)/BM_WORDBITS;
+    int ty0 = y0/tr, ty1 = (y1-1)/tr+1;
+    ia_parallel_for((size_t)(ty1-ty0), [&](size_t b, size_t e) {
+        for (int ty=ty0+(int)b; ty<ty0+(int)e; ty++) {
+            int ya = std::max(y0, ty*tr), yb = std::min(y1, (ty+1)*tr);
+            for (int tx=w0/tw; tx*tw<w1; tx++) {
+                int wa = std::max(w0, tx*tw), wb = std::min(w1, (tx+1)*tw);
+                bool srcEmpty = (src->pBuffers==TILED && !src->pTiles->tile(tx, ty));
+                bool dstEmpty = (pBuffers==TILED && !pTiles->tile(tx, ty));
+                if (srcEmpty) {
+                    if (op==kAnd && !dstEmpty) {
+                        bool wholeTile = (wa==tx*tw && (wb==(tx+1)*tw || wb==wordsPerRow)
+                                          && ya==ty*tr && (yb==(ty+1)*tr || yb==pHeight));
+                        if (pBuffers==TILED && wholeTile) {
+                            pTiles->releaseTile(tx, ty);
+                        } else {
+                            for (int y=ya; y<yb; y++)
+                                memset(wordAt(wa, y), 0, (size_t)(wb-wa)*BM_WORDSIZE);
+                        }
+                    }
+                    continue;
+                }
+                if (dstEmpty) {
+                    if (op==kAnd || op==kAndNot) continue;
+                    // don't allocate a tile for an empty block in a dense source
+                    bool used = false;
+                    for (int y=ya; y<yb && !used; y++) {
+                        const potrace_word *p = src->wordAt(wa, y);
+                        for (int w=0; w<wb-wa; w++)
+                            if (p[w]) { used = true; break; }
+                    }
+                    if (!used) continue;
+                    pTiles->acquireTile(tx, ty);
+                }
+                for (int y=ya; y<yb; y++)
+                    fn(wordAt(wa, y), src->wordAt(wa, y), (size_t)(wb-wa));
+            }
+        }
+    }, 1);
+}
+
+
+/**
+ * Find a word in a bitmap buffer.
+ *
+ * In a dense bitmap, all following words of the row come right after this
+ * word. In a tiled bitmap, only the words up to the end of the tile do.
+ *
+ * \param w word index within the row
+ * \param y row
+ * \param create allocate the tile if needed
+ *
+ * \return pointer to the word, or nullptr if it is in a tile that doesn't exist
+ */
+potrace_word *IAFramebuffer::wordAt(int w, int y, bool create)
+{
+    if (pBuffers==TILED)
+        return pTiles->word(w, y, create);
+    return bm_scanline(pBitmap, y)+w;
+}
+
+
+/**
+ * Get a pixel in a bitmap buffer.
+ *
+ * \param x, y pixel position, must be inside the buffer
+ *
+ * \return true if the pixel is set
+ */
+bool IAFramebuffer::getPixel(int x, int y)
+{
+    if (pBuffers==TILED)
+        return pTiles->get(x, y);
+    return BM_UGET(pBitmap, x, y);
+}
+
+
+/**
+ * Set or clear a pixel in a bitmap buffer.
+ *
+ * \param x, y pixel position, must be inside the buffer
+ * \param color 0 or 1
+ */
+void IAFramebuffer::putPixel(int x, int y, int color)
+{
+    if (pBuffers==TILED)
+        pTiles->put(x, y, color);
+    else
+        BM_UPUT(pBitmap, x, y, color);
+}
+
+
+/**
+ * Set or clear a horizontal line of pixels in a bitmap buffer.
+ *
+ * \param x1 first pixel, clipped to the buffer
+ * \param x2 pixel after the last pixel, clipped to the buffer
+ * \param y row, must be inside the buffer
+ * \param color 0 or 1
+ */
+void IAFramebuffer::hline(int x1, int x2, int y, int color)
+{
+    if (pBuffers==TILED)
+        pTiles->hline(x1, x2, y, color);
+    else
+        bm_hline(pBitmap, x1, x2, y, color);
+}
+
+
+/**
+ * Create a dense copy of the area of a bitmap buffer that may contain pixels.
+ *
+ * This is the input for tracing. Tiles that don't exist are not copied.
+ *
+ * \param[out] ox, oy position of the bottom left corner of the copy in this
+ *      buffer, in pixels
+ *
+ * \return a new bitmap that must be released with bm_free(), or nullptr if
+ *      the buffer is empty
+ */
+potrace_bitmap_t *IAFramebuffer::createTraceBitmap(int &ox, int &oy)
+{
+    int x0, y0, x1, y1;
+    dirtyBox(x0, y0, x1, y1);
+    if (!isBitmap() || !hasFBO() || x0>=x1 || y0>=y1)
+        return nullptr;
+    int w0 = x0/BM_WORDBITS, w1 = (x1+BM_WORDBITS-1)/BM_WORDBITS;
+    ox = w0*BM_WORDBITS;
+    oy = y0;
+    potrace_bitmap_t *bm = bm_new(std::min(w1*BM_WORDBITS, pWidth)-ox, y1-y0);
+    if (!bm) {
+        fprintf(stderr, "Error allocating bitmap: %s\n", strerror(errno));
+        return nullptr;
+    }
+    const int tw = IATiledBitmap::kTileWords;
+    for (int y=y0; y<y1; y++) {
+        potrace_word *dst = bm_scanline(bm, y-oy);
+        for (int w=w0; w<w1; ) {
+            int wEnd = (pBuffers==TILED) ? std::min(w1, (w/tw+1)*tw) : w1;
+            potrace_word *p = wordAt(w, y);
+            if (p)
+                memcpy(dst+w-w0, p, (size_t)(wEnd-w)*BM_WORDSIZE);
+            w = wEnd;
+        }
+    }
+    return bm;
+}
+
+
+/**
+ * Get the area that may contain set pixels.
+ *
+ * Only bitmap buffers keep track of this area. No pixel outside of the box is
+ * set, but not every pixel inside the box is. The box is empty if x0>=x1.
+ *
+ * \param[out] x0, y0 bottom left corner in pixels
+ * \param[out] x1, y1 top right corner in pixels, exclusive
+ */
+void IAFramebuffer::dirtyBox(int &x0, int &y0, int &x1, int &y1)
+{
+    if (isBitmap()) {
+        x0 = pDirtyX0; y0 = pDirtyY0; x1 = pDirtyX1; y1 = pDirtyY1;
+    } else {
+        x0 = 0; y0 = 0; x1 = pWidth; y1 = pHeight;
+    }
+}
+
+
+/**
+ * Grow the dirty area to include a box.
+ *
+ * \param x0, y0, x1, y1 the box in pixels, x1 and y1 are exclusive; it is
+ *      clipped to the size of the buffer
+ */
+void IAFramebuffer::markDirty(int x0, int y0, int x1, int y1)
+{
+    x0 = std::max(x0, 0); y0 = std::max(y0, 0);
+    x1 = std::min(x1, pWidth); y1 = std::min(y1, pHeight);
+    if (x0>=x1 || y0>=y1) return;
+    if (pDirtyX0>=pDirtyX1 || pDirtyY0>=pDirtyY1) {
+        pDirtyX0 = x0; pDirtyY0 = y0; pDirtyX1 = x1; pDirtyY1 = y1;
+    } else {
+        pDirtyX0 = std::min(pDirtyX0, x0); pDirtyY0 = std::min(pDirtyY0, y0);
+        pDirtyX1 = std::max(pDirtyX1, x1); pDirtyY1 = std::max(pDirtyY1, y1);
+    }
+}
+
+
+/**
+ * Draw the framebuffer src on top of this framebuffer using a logic OR.
+ *
+ * \param src the other framebuffer
+ */
+void IAFramebuffer::logicOr(IAFramebuffer *src)
+{
+    if (src && src->hasFBO()) {
+        bindForRendering();
+        if (isBitmap()) {
+            std::unique_ptr<IAFramebuffer> resampled;
+            src = sameSizeBitmap(src, resampled);
+            combineBitmap(src, kOr,
+                          src->pDirtyX0, src->pDirtyY0, src->pDirtyX1, src->pDirtyY1);
+            markDirty(src->pDirtyX0, src->pDirtyY0, src->pDirtyX1, src->pDirtyY1);
+        } else {
+            glBindFramebufferEXT(GL_READ_FRAMEBUFFER, src->pFramebuffer);
+            IA_HANDLE_GL_ERRORS();
+            glBindFramebufferEXT(GL_DRAW_FRAMEBUFFER, pFramebuffer);
+            IA_HANDLE_GL_ERRORS();
+            glDisable(GL_DEPTH_TEST);
+            // R, G, and B are only 0.0 or 1.0, so adding and clamping is a logic OR
+            glBlendFunc(GL_ONE, GL_ONE); // dst = src + dst
+            glBlendEquationEXT(GL_FUNC_ADD);
+            glEnable(GL_BLEND);
+            IA_HANDLE_GL_ERRORS();
+            glRasterPos2d(0.0, 0.0);
+            glCopyPixels(0, 0, pWidth, pHeight, GL_COLOR);
+            IA_HANDLE_GL_ERRORS();
+            glDisable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            IA_HANDLE_GL_ERRORS();
+        }
+        unbindFromRendering();
+    } else {
+        // if src has no FBO, it is all 0, so OR will not change this buffer
+    }
+}
+
+
+/**
+ * Draw the framebuffer src on top of this framebuffer using a logic XOR.
+ *
+ * \param src the other framebuffer
+ */
+void IAFramebuffer::logicXor(IAFramebuffer *src)
+{
+    if (src && src->hasFBO()) {
+        bindForRendering();
+        if (isBitmap()) {
+            std::unique_ptr<IAFramebuffer> resampled;
+            src = sameSizeBitmap(src, resampled);
+            combineBitmap(src, kXor,
+                          src->pDirtyX0, src->pDirtyY0, src->pDirtyX1, src->pDirtyY1);
+            markDirty(src->pDirtyX0, src->pDirtyY0, src->pDirtyX1, src->pDirtyY1);
+        } else {
+            glBindFramebufferEXT(GL_READ_FRAMEBUFFER, src->pFramebuffer);
+            IA_HANDLE_GL_ERRORS();
+            glBindFramebufferEXT(GL_DRAW_FRAMEBUFFER, pFramebuffer);
+            IA_HANDLE_GL_ERRORS();
+            glDisable(GL_DEPTH_TEST);
+            glEnable(GL_COLOR_LOGIC_OP);
+            glLogicOp(GL_XOR);
+            IA_HANDLE_GL_ERRORS();
+            glRasterPos2d(0.0, 0.0);
+            glCopyPixels(0, 0, pWidth, pHeight, GL_COLOR);
+            IA_HANDLE_GL_ERRORS();
+            glLogicOp(GL_COPY);
+            glDisable(GL_COLOR_LOGIC_OP);
+            IA_HANDLE_GL_ERRORS();
+        }
+        unbindFromRendering();
+    } else {
+        // if src has no FBO, it is all 0, so XOR will not change this buffer
+    }
+}
+
+
+/**
+ * Count the pixels that are set.
+ *
+ * \return number of set pixels, or 0 if nothing was drawn yet
+ */
+size_t IAFramebuffer::countPixels()
+{
+    if (!hasFBO()) return 0;
+    size_t n = 0;
+    if (pBuffers==BITMAP) {
+        IABitmapKernels::CountOp op = IABitmapKernels::best().popCount;
+        potrace_bitmap_t *bm = pBitmap;
+        if (pDirtyX0>=pDirtyX1) return 0;
+        int y0 = pDirtyY0;
+        int w0 = pDirtyX0/BM_WORDBITS, w1 = (pDirtyX1+BM_WORDBITS-1)/BM_WORDBITS;
+        std::atomic<size_t> total(0);
+        ia_parallel_for((size_t)(pDirtyY1-y0), [&](size_t b, size_t e) {
+            size_t c = 0;
+            if (bm->dy==w1 && w0==0) {
+                c = op(bm_scanline(bm, y0+b), (e-b)*w1);
+            } else {
+                for (size_t y=y0+b; y<y0+e; y++)
+                    c += op(bm_scanline(bm, y)+w0, (size_t)(w1-w0));
+            }
+            total += c;
+        }, 256);
+        n = total;
+    } else if (pBuffers==TILED) {
+        // bits outside of the bitmap are never set, so tiles are counted whole
+        IABitmapKernels::CountOp op = IABitmapKernels::best().popCount;
+        for (int ty=0; ty<pTiles->rows(); ty++) {
+            for (int tx=0; tx<pTiles->columns(); tx++) {
+                potrace_word *t = pTiles->tile(tx, ty);
+                if (t) n += op(t, IATiledBitmap::kTileSize);
+            }
+        }
+    } else {
+        uint8_t *rgb = getRawImageRGB();
+        size_t size = (size_t)pWidth*pHeight;
+        for (size_t i=0; i<size; i++)
+            if (rgb[3*i]>127) n++;
+        free(rgb);
+    }
+    return n;
+}
+
+
+/**
+ * Measure the area that is covered by set pixels.
+ *
+ * This is a quick way to find out how much solid material is in a layer
+ * without tracing its outline.
+ *
+ * \return area in mm^2
+ */
+double IAFramebuffer::area()
+{
+    double px = pPrinter->pPrintVolume.x() / pWidth;
+    double py = pPrinter->pPrintVolume.y() / pHeight;
+    return countPixels() * px * py;
+}
+
+
 /**
  * Compose the src buffer onto this buffer in RGBA, assuming only 0 and 1
  * values for components.
@@ -185,21 +704,13 @@ void IAFramebuffer::logicAndNot(IAFramebuffer *src)
 {
     if (src && src->hasFBO()) {
         bindForRendering();
-        if (pBuffers==BITMAP) {
-            int dy = pBitmap->dy;
-            int y;
-            int i;
-            potrace_word *pSrc, *pDst;
-            if (dy < 0) {
-                dy = -dy;
-            }
-            for (y=0; y < pBitmap->h; y++) {
-                pSrc = bm_scanline(src->pBitmap, y);
-                pDst = bm_scanline(pBitmap, y);
-                for (i=0; i < dy; i++) {
-                    pDst[i] = pDst[i] & ~pSrc[i];
-                }
-            }
+        if (isBitmap()) {
+            std::unique_ptr<IAFramebuffer> resampled;
+            src = sameSizeBitmap(src, resampled);
+            // only pixels that are set in both buffers can change
+            combineBitmap(src, kAndNot,
+                          std::max(pDirtyX0, src->pDirtyX0), std::max(pDirtyY0, src->pDirtyY0),
+                          std::min(pDirtyX1, src->pDirtyX1), std::min(pDirtyY1, src->pDirtyY1));
         } else {
             glBindFramebufferEXT(GL_READ_FRAMEBUFFER, src->pFramebuffer);
             IA_HANDLE_GL_ERRORS();
@@ -255,20 +766,19 @@ void IAFramebuffer::logicAnd(IAFramebuffer *src)
 {
     if (src && src->hasFBO()) {
         bindForRendering();
-        if (pBuffers==BITMAP) {
-            int dy = pBitmap->dy;
-            int y;
-            int i;
-            potrace_word *pSrc, *pDst;
-            if (dy < 0) {
-                dy = -dy;
-            }
-            for (y=0; y < pBitmap->h; y++) {
-                pSrc = bm_scanline(src->pBitmap, y);
-                pDst = bm_scanline(pBitmap, y);
-                for (i=0; i < dy; i++) {
-                    pDst[i] = pDst[i] & pSrc[i];
-                }
+        if (isBitmap()) {
+            std::unique_ptr<IAFramebuffer> resampled;
+            src = sameSizeBitmap(src, resampled);
+            // src is clear outside of its dirty box, so this clears all
+            // of our pixels that are outside of it
+            combineBitmap(src, kAnd,
+                          pDirtyX0, pDirtyY0, pDirtyX1, pDirtyY1);
+            pDirtyX0 = std::max(pDirtyX0, src->pDirtyX0);
+            pDirtyY0 = std::max(pDirtyY0, src->pDirtyY0);
+            pDirtyX1 = std::min(pDirtyX1, src->pDirtyX1);
+            pDirtyY1 = std::min(pDirtyY1, src->pDirtyY1);
+            if (pDirtyX0>=pDirtyX1 || pDirtyY0>=pDirtyY1) {
+                pDirtyX0 = 0; pDirtyY0 = 0; pDirtyX1 = 0; pDirtyY1 = 0;
             }
         } else {
             glBindFramebufferEXT(GL_READ_FRAMEBUFFER, src->pFramebuffer);
@@ -316,19 +826,113 @@ void IAFramebuffer::logicAnd(IAFramebuffer *src)
 }
 
 
+/**
+ * Set all pixels that are covered by a run-length encoded bitmap.
+ *
+ * \param src runs of pixels, must have the same size as this buffer
+ */
+void IAFramebuffer::logicOr(IARunLengthBitmap const& src)
+{
+    if (!isBitmap() || src.empty()) return;
+    bindForRendering();
+    if (src.width()!=pWidth || src.height()!=pHeight) {
+        puts("IAFramebuffer: can't combine bitmaps of different sizes");
+        unbindFromRendering();
+        return;
+    }
+    dropEdgeCoverage();
+    for (int y=src.firstRow(); y<src.lastRow(); y++) {
+        int n;
+        const int32_t *run = src.row(y, n);
+        for (int i=0; i<n; i++, run+=2)
+            hline(run[0], run[1], y, 1);
+    }
+    int x0, y0, x1, y1;
+    src.box(x0, y0, x1, y1);
+    markDirty(x0, y0, x1, y1);
+    unbindFromRendering();
+}
+
+
+/**
+ * Create a run-length encoded copy of a bitmap buffer.
+ *
+ * Only the area that may contain pixels is scanned. Words that are all set
+ * or all clear are handled as a whole.
+ *
+ * \return a new bitmap, or nullptr if this is not a bitmap buffer
+ */
+IARunLengthBitmap *IAFramebuffer::createRunLengthBitmap()
+{
+    if (!isBitmap()) return nullptr;
+    IARunLengthBitmap *rle = new IARunLengthBitmap(pWidth, pHeight);
+    int x0, y0, x1, y1;
+    dirtyBox(x0, y0, x1, y1);
+    if (!hasFBO() || x0>=x1) return rle;
+    int w0 = x0/BM_WORDBITS, w1 = (x1+BM_WORDBITS-1)/BM_WORDBITS;
+    for (int y=y0; y<y1; y++) {
+        int start = -1;
+        for (int w=w0; w<w1; w++) {
+            potrace_word *p = wordAt(w, y);
+            potrace_word v = p ? *p : 0;
+            int x = w*BM_WORDBITS;
+            if (v==0) {
+                if (start>=0) { rle->addRun(y, start, std::min(x, pWidth)); start = -1; }
+            } else if (v==BM_ALLBITS) {
+                if (start<0) start = x;
+            } else {
+                for (int b=0; b<BM_WORDBITS; b++, x++) {
+                    bool set = (v & bm_mask(x))!=0;
+                    if (set && start<0) {
+                        start = x;
+                    } else if (!set && start>=0) {
+                        rle->addRun(y, start, std::min(x, pWidth));
+                        start = -1;
+                    }
+                }
+            }
+        }
+        if (start>=0)
+            rle->addRun(y, start, std::min(w1*BM_WORDBITS, pWidth));
+    }
+    rle->shrink();
+    return rle;
+}
+
+
+/**
+ * Estimate the memory that holds the pixels of this buffer.
+ *
+ * \return size in bytes, including buffers in OpenGL
+ */
+size_t IAFramebuffer::memoryUsed()
+{
+    size_t n = sizeof(*this) + (size_t)pNVertex*sizeof(Vertex);
+    if (!hasFBO())
+        return n;
+    switch (pBuffers) {
+        case BITMAP: return n + (size_t)pBitmap->dy*pBitmap->h*BM_WORDSIZE;
+        case TILED: return n + pTiles->memoryUsed();
+        case RGBA: return n + (size_t)pWidth*pHeight*4;
+        case RGBAZ: return n + (size_t)pWidth*pHeight*8;
+        default: return n;
+    }
+}
+
+
 /**
  * Delete the framebuffer, if we ever created one.
  */
 IAFramebuffer::~IAFramebuffer()
 {
-    if (pBitmap) {
-        bm_free(pBitmap);
-        pBitmap = nullptr;
-    }
     if (hasFBO()) {
         deleteFBO();
         pFramebufferCreated = false;
     }
+    delete pTiles;
+    pTiles = nullptr;
+    delete pCoverage;
+    pCoverage = nullptr;
 }
 
 
@@ -339,6 +943,7 @@ IAFramebuffer::~IAFramebuffer()
  */
 void IAFramebuffer::fill(int color)
 {
+    dropEdgeCoverage();
     if (hasFBO()) {
         bindForRendering();
         if (pBuffers==RGBA) {
@@ -349,7 +954,27 @@ void IAFramebuffer::fill(int color)
             glClearDepth(1.0f);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         } else if (pBuffers==BITMAP) {
-            bm_clear(pBitmap, color);
+            if (color) {
+                bm_clear(pBitmap, color);
+                // keep the bits after the end of each row clear
+                int pad = pBitmap->dy*BM_WORDBITS - pWidth;
+                if (pad>0) {
+                    potrace_word mask = BM_ALLBITS << pad;
+                    for (int y=0; y<pHeight; y++)
+                        bm_scanline(pBitmap, y)[pBitmap->dy-1] &= mask;
+                }
+                pDirtyX0 = 0; pDirtyY0 = 0; pDirtyX1 = pWidth; pDirtyY1 = pHeight;
+            } else {
+                // everything outside of the dirty box is clear already
+                int w0 = pDirtyX0/BM_WORDBITS, w1 = (pDirtyX1+BM_WORDBITS-1)/BM_WORDBITS;
+                for (int y=pDirtyY0; y<pDirtyY1 && w0<w1; y++)
+                    memset(bm_scanline(pBitmap, y)+w0, 0, (size_t)(w1-w0)*BM_WORDSIZE);
+                pDirtyX0 = 0; pDirtyY0 = 0; pDirtyX1 = 0; pDirtyY1 = 0;
+            }
+        } else if (pBuffers==TILED) {
+            pTiles->fill(color);
+            pDirtyX0 = 0; pDirtyY0 = 0;
+            pDirtyX1 = color ? pWidth : 0; pDirtyY1 = color ? pHeight : 0;
         }
         unbindFromRendering();
     }
@@ -363,7 +988,7 @@ void IAFramebuffer::bindForRendering()
 {
     activateFBO();
 
-    if (pBuffers==BITMAP) {
+    if (isBitmap()) {
         // nothing to do
     } else {
         // set matrices, lighting, etc. for this FBO
@@ -396,7 +1021,7 @@ void IAFramebuffer::bindForRendering()
  */
 void IAFramebuffer::unbindFromRendering()
 {
-    if (pBuffers==BITMAP) {
+    if (isBitmap()) {
         // nothing to do
     } else {
         // deactivate the FBO and set render target to FL_BACKBUFFER
@@ -418,11 +1043,11 @@ uint8_t *IAFramebuffer::getRawImageRGB()
 {
     size_t size = pWidth*pHeight*3;
     uint8_t *data = (uint8_t*)calloc(size, 1);
-    if (pBuffers==BITMAP) {
+    if (isBitmap()) {
         uint8_t *dst = data;
         for (int y=0; y<pHeight; y++) {
             for (int x=0; x<pWidth; x++) {
-                uint8_t lum = BM_UGET(pBitmap, x, y) ? 255 : 0;
+                uint8_t lum = getPixel(x, y) ? 255 : 0;
                 *dst++ = lum;
                 *dst++ = lum;
                 *dst++ = lum;
@@ -450,11 +1075,11 @@ uint8_t *IAFramebuffer::getRawImageRGBA()
 {
     size_t size = pWidth*pHeight*4;
     uint8_t *data = (uint8_t*)calloc(size, 1);
-    if (pBuffers==BITMAP) {
+    if (isBitmap()) {
         uint8_t *dst = data;
         for (int y=0; y<pHeight; y++) {
             for (int x=0; x<pWidth; x++) {
-                uint8_t lum = BM_UGET(pBitmap, x, y) ? 255 : 0;
+                uint8_t lum = getPixel(x, y) ? 255 : 0;
                 *dst++ = lum;
                 *dst++ = lum;
                 *dst++ = lum;
@@ -656,7 +1281,7 @@ void IAFramebuffer::draw(double z)
 {
     if (!hasFBO()) return;
 
-    if (pBuffers==BITMAP) {
+    if (isBitmap()) {
         /** \bug write this */
     } else {
         // set as texture and render out
@@ -700,7 +1325,7 @@ void IAFramebuffer::activateFBO()
     if (!pFramebufferCreated) {
         createFBO();
     }
-    if (pBuffers==BITMAP) {
+    if (isBitmap()) {
         // nothing to do
     } else {
         /** \todo what if there was an error and FBO is still not created */
@@ -722,8 +1347,19 @@ void IAFramebuffer::createFBO()
 {
     // Create this thing
 
+    if (pWidth<=0 || pHeight<=0)
+        pPrinter->rasterSize(pWidth, pHeight, pResolution==COARSE);
+
     if (pBuffers==BITMAP) {
-        pBitmap = bm_new(pWidth, pHeight);
+        pBitmap = IAFramebufferPool::shared().acquireBitmap(pResolution, pWidth, pHeight);
+    } else if (pBuffers==TILED) {
+        pTiles = new IATiledBitmap(pWidth, pHeight);
+    } else if (IAFramebufferPool::shared().acquireGL(pBuffers, pResolution, pWidth, pHeight,
+                                                     pFramebuffer, pColorbuffer, pDepthbuffer)) {
+        // a recycled buffer is complete, and fill() below clears it
+        IA_HANDLE_GL_ERRORS();
+        glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, pFramebuffer);
+        IA_HANDLE_GL_ERRORS();
     } else {
         //RGBA8 2D texture, 24 bit depth texture
         IA_HANDLE_GL_ERRORS();
@@ -783,26 +1419,28 @@ void IAFramebuffer::createFBO()
 
 /**
  * Delete the framebuffer object.
+ *
+ * Bitmaps and OpenGL buffers are given back to the framebuffer pool, so that
+ * the next framebuffer of the same type and raster can reuse them.
  */
 void IAFramebuffer::deleteFBO()
 {
     if (pBuffers==BITMAP) {
-        bm_free(pBitmap);
+        // the pool hands out clear bitmaps, and only the dirty box may be set
+        fill(0);
+        IAFramebufferPool::shared().releaseBitmap(pResolution, pBitmap);
+        pBitmap = nullptr;
+    } else if (pBuffers==TILED) {
+        delete pTiles;
+        pTiles = nullptr;
     } else {
         //Bind 0, which means render to back buffer, as a result, fb is unbound
         IA_HANDLE_GL_ERRORS();
         glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
         IA_HANDLE_GL_ERRORS();
-        //Delete resources
-        if (pColorbuffer)
-            glDeleteTextures(1, &pColorbuffer);
-        IA_HANDLE_GL_ERRORS();
-        if (pDepthbuffer)
-            glDeleteRenderbuffersEXT(1, &pDepthbuffer);
-        IA_HANDLE_GL_ERRORS();
-        if (pFramebuffer)
-            glDeleteFramebuffersEXT(1, &pFramebuffer);
-        IA_HANDLE_GL_ERRORS();
+        IAFramebufferPool::shared().releaseGL(pBuffers, pResolution, pWidth, pHeight,
+                                              pFramebuffer, pColorbuffer, pDepthbuffer);
+        pFramebuffer = pColorbuffer = pDepthbuffer = 0;
     }
     pFramebufferCreated = false;
 }
@@ -845,7 +1483,11 @@ IAToolpathListSP IAFramebuffer::toolpathFromLassoAndContract(double z, double r)
 {
     // use a shared pointer, so we don;t have to worry about deallocating
     auto tp0 = toolpathFromLasso(z);
-    subtract(tp0, r);
+    if (isBitmap()) {
+        if (tp0) contract(r);
+    } else {
+        subtract(tp0, r);
+    }
     return tp0;
 }
 
@@ -864,14 +1506,153 @@ IAToolpathListSP IAFramebuffer::toolpathFromLassoAndExpand(double z, double r)
 {
     // use a shared pointer, so we don;t have to worry about deallocating
     auto tp0 = toolpathFromLasso(z);
-    add(tp0, r);
+    if (isBitmap()) {
+        if (tp0) expand(r);
+    } else {
+        add(tp0, r);
+    }
     return tp0;
 }
 
 
+/**
+ * Create diagonal zigzag lines that fill the set pixels.
+ *
+ * The lines are as far apart as the edges of the stripes of
+ * overlayInfillPattern(), but they are taken straight from the bitmap instead
+ * of tracing thousands of thin stripes. Every diagonal of the raster that
+ * carries a line is scanned for runs of set pixels, and every run becomes a
+ * line segment. Segments on neighbouring diagonals are linked into a zigzag
+ * if every pixel that the link between their ends touches is set.
+ *
+ * OpenGL buffers are overlaid with the stripes and traced instead.
+ *
+ * \param z create a toolpath at this layer
+ * \param i layer index; odd layers use lines rising to the right, even
+ *      layers lines falling to the right
+ * \param w distance between lines in mm
+ *
+ * \return nullptr, if the buffer has no lines
+ * \return a new smart_pointer to a list of IAToolpathLine
+ */
+IAToolpathListSP IAFramebuffer::toolpathFromStripes(double z, int i, double w)
+{
+    if (!isBitmap()) {
+        overlayInfillPattern(i, w);
+        return toolpathFromLasso(z);
+    }
+    bindForRendering();
+    unbindFromRendering();
+    if (pDirtyX0>=pDirtyX1 || pDirtyY0>=pDirtyY1)
+        return nullptr;
+
+    // pixel (x, y) is on line k if x-s*y is k*dx
+    int dx = w*sqrt(2.0)/pPrinter->pPrintVolume.x()*pWidth;
+    if (dx<1) dx = 1;
+    int s = (i&1) ? 1 : -1;
+    int u0 = (s==1) ? pDirtyX0-(pDirtyY1-1) : pDirtyX0+pDirtyY0;
+    int u1 = (s==1) ? (pDirtyX1-1)-pDirtyY0 : (pDirtyX1-1)+(pDirtyY1-1);
+    int k0 = (int)ceil((double)u0/dx), k1 = (int)floor((double)u1/dx);
+    if (k0>k1)
+        return nullptr;
+
+    // find the runs of set pixels on every line, as first and last row
+    typedef std::pair<int, int> Run;
+    std::vector<std::vector<Run>> runs((size_t)(k1-k0+1));
+    ia_parallel_for(runs.size(), [&](size_t b, size_t e) {
+        for (size_t j=b; j<e; j++) {
+            int u = (k0+(int)j)*dx;
+            int y0 = pDirtyY0, y1 = pDirtyY1;
+            if (s==1) {
+                y0 = std::max(y0, pDirtyX0-u); y1 = std::min(y1, pDirtyX1-u);
+            } else {
+                y0 = std::max(y0, u-pDirtyX1+1); y1 = std::min(y1, u-pDirtyX0+1);
+            }
+            for (int y=y0; y<y1; ) {
+                while (y<y1 && !getPixel(u+s*y, y)) y++;
+                int start = y;
+                while (y<y1 && getPixel(u+s*y, y)) y++;
+                // a single pixel has no direction and is left out
+                if (y-start>1) runs[j].push_back( { start, y-1 } );
+            }
+        }
+    }, 16);
+
+    // two ends can be linked if they are close, and every pixel that the
+    // link touches is set; a link through the corner of two pixels only
+    // touches the pixels before and after the corner
+    auto canLink = [&](int xa, int ya, int xb, int yb)->bool {
+        int nx = abs(xb-xa), ny = abs(yb-ya);
+        if (std::max(nx, ny)>3*dx) return false;
+        int sx = (xb>xa) ? 1 : -1, sy = (yb>ya) ? 1 : -1;
+        int x = xa, y = ya;
+        for (int ix=0, iy=0; ix<nx || iy<ny; ) {
+            // compare where the link crosses the next column and the next row
+            long d = (long)(2*ix+1)*ny - (long)(2*iy+1)*nx;
+            if (d<=0) { x += sx; ix++; }
+            if (d>=0) { y += sy; iy++; }
+            if (!getPixel(x, y)) return false;
+        }
+        return true;
+    };
+
+    struct Zigzag {
+        IAToolpathLine *line;
+        int x, y, k;
+        bool up;
+    };
+    auto tp0 = std::make_shared<IAToolpathList>(z);
+    IAVector3d &printbed = pPrinter->pPrintVolume;
+    double xScl = printbed.x()/pWidth, yScl = printbed.y()/pHeight;
+    std::vector<Zigzag> open, next;
+    for (int k=k0; k<=k1; k++) {
+        int u = k*dx;
+        for (auto &r: runs[k-k0]) {
+            // a zigzag that ended going up continues at the top of this run
+            Zigzag *zz = nullptr;
+            for (auto &o: open) {
+                if (o.k!=k-1) continue;
+                int y = o.up ? r.second : r.first;
+                if (canLink(o.x, o.y, u+s*y, y)) { zz = &o; break; }
+            }
+            int ya = r.first, yb = r.second;
+            if (zz) {
+                if (zz->up) std::swap(ya, yb);
+                zz->line->continuePath((u+s*ya+0.5)*xScl, (ya+0.5)*yScl);
+            } else {
+                next.push_back( { new IAToolpathLine(z), 0, 0, k, false } );
+                zz = &next.back();
+                zz->line->startPath((u+s*ya+0.5)*xScl, (ya+0.5)*yScl);
+            }
+            zz->line->continuePath((u+s*yb+0.5)*xScl, (yb+0.5)*yScl);
+            zz->x = u+s*yb; zz->y = yb; zz->k = k;
+            zz->up = (yb>ya);
+        }
+        // zigzags that were not continued on this line are done
+        for (auto &o: open) {
+            if (o.k==k) next.push_back(o);
+            else tp0->add(o.line, 0, 0, 0);
+        }
+        open.swap(next);
+        next.clear();
+    }
+    for (auto &o: open)
+        tp0->add(o.line, 0, 0, 0);
+
+    if (tp0->isEmpty())
+        return nullptr;
+    else
+        return tp0;
+}
+
+
 /**
  * Subtract a toolpath from this pattern.
  *
+ * Bitmaps are stamped segment by segment. contract() gives the same result
+ * for the traced outline of the bitmap in a fraction of the time; this
+ * version is kept as a reference.
+ *
  * \param tp subtract this toolpath form the pattern
  * \param r the pattern will be reduced by the amount in r
  */
@@ -880,7 +1661,7 @@ void IAFramebuffer::subtract(IAToolpathListSP tp, double r)
     if (tp) {
         // draw the outline to contract the image
         bindForRendering();
-        if (pBuffers==BITMAP) {
+        if (isBitmap()) {
             tp->drawFlatToBitmap(this, r*2.0);
         } else {
             glDisable(GL_DEPTH_TEST);
@@ -895,6 +1676,9 @@ void IAFramebuffer::subtract(IAToolpathListSP tp, double r)
 /**
  * Add a toolpath to this pattern.
  *
+ * Bitmaps are stamped segment by segment; see expand() for a faster way to
+ * grow a bitmap by its own outline.
+ *
  * \param tp add this toolpath to the pattern
  * \param r the pattern will be expanded by the amount in r
  */
@@ -903,7 +1687,7 @@ void IAFramebuffer::add(IAToolpathListSP tp, double r)
     if (tp) {
         // draw the outline to contract the image
         bindForRendering();
-        if (pBuffers==BITMAP) {
+        if (isBitmap()) {
             tp->drawFlatToBitmap(this, r*2.0, 1);
         } else {
             glDisable(GL_DEPTH_TEST);
@@ -915,6 +1699,437 @@ void IAFramebuffer::add(IAToolpathListSP tp, double r)
 }
 
 
+/** Squared distance of pixels that have no seed in reach; finite, so that
+ the parabola intersections stay well defined. */
+static const double kDistanceInfinity = 1e20;
+
+
+/**
+ * Calculate the squared distance transform of one row or column.
+ *
+ * This is the one dimensional pass of the distance transform by Felzenszwalb
+ * and Huttenlocher. It runs in linear time.
+ *
+ * \param f squared distances of n samples, or kDistanceInfinity
+ * \param d receives the lower envelope of the parabolas rooted at every sample
+ * \param n number of samples
+ * \param h2 squared spacing between samples
+ * \param v, zz scratch space for n and n+1 values
+ * \param nearest if set, receives the index of the sample whose parabola is
+ *      the lowest at every position
+ */
+static void distanceTransform1D(const double *f, double *d, int n, double h2,
+                                int *v, double *zz, int *nearest=nullptr)
+{
+    const double kInfinity = std::numeric_limits<double>::infinity();
+    int k = 0;
+    v[0] = 0;
+    zz[0] = -kInfinity;
+    zz[1] = kInfinity;
+    for (int q=1; q<n; q++) {
+        double fq = f[q] + h2*q*q;
+        double s;
+        for (;;) {
+            int p = v[k];
+            s = (fq - (f[p] + h2*p*p)) / (2.0*h2*(q-p));
+            if (s>zz[k]) break;
+            k--;
+        }
+        k++;
+        v[k] = q;
+        zz[k] = s;
+        zz[k+1] = kInfinity;
+    }
+    k = 0;
+    for (int q=0; q<n; q++) {
+        while (zz[k+1]<q) k++;
+        int p = v[k];
+        d[q] = h2*(q-p)*(q-p) + f[p];
+        if (nearest) nearest[q] = p;
+    }
+}
+
+
+/**
+ * Calculate the squared distance transform of a field of samples.
+ *
+ * Rows are transformed first, then columns, each on multiple threads.
+ *
+ * \param dist w*h squared distances, 0 for seeds and kDistanceInfinity for
+ *      all other samples; receives the squared distance to the nearest seed
+ * \param w, h number of samples in a row and a column
+ * \param hx, hy spacing between samples in a row and in a column
+ * \param nearest if set, receives the index of the nearest seed of every
+ *      sample
+ */
+static void distanceTransform2D(std::vector<double> &dist, int w, int h,
+                                double hx, double hy, std::vector<int> *nearest)
+{
+    ia_parallel_for(h, [&](size_t b, size_t e) {
+        std::vector<double> f(w);
+        std::vector<int> v(w);
+        std::vector<double> zz(w+1);
+        for (size_t j=b; j<e; j++) {
+            std::copy(dist.begin()+j*w, dist.begin()+(j+1)*w, f.begin());
+            distanceTransform1D(f.data(), dist.data()+j*w, w, hx*hx, v.data(), zz.data(),
+                                nearest ? nearest->data()+j*w : nullptr);
+        }
+    }, 16);
+
+    ia_parallel_for(w, [&](size_t b, size_t e) {
+        std::vector<double> f(h), d(h);
+        std::vector<int> v(h), nearRow(h), nearCol(h);
+        std::vector<double> zz(h+1);
+        for (size_t i=b; i<e; i++) {
+            for (int j=0; j<h; j++)
+                f[j] = dist[(size_t)j*w+i];
+            distanceTransform1D(f.data(), d.data(), h, hy*hy, v.data(), zz.data(),
+                                nearest ? nearRow.data() : nullptr);
+            for (int j=0; j<h; j++)
+                dist[(size_t)j*w+i] = d[j];
+            if (nearest) {
+                // combine the nearest row with the nearest column in that row
+                for (int j=0; j<h; j++)
+                    nearCol[j] = (*nearest)[(size_t)j*w+i];
+                for (int j=0; j<h; j++)
+                    (*nearest)[(size_t)j*w+i] = nearRow[j]*w + nearCol[nearRow[j]];
+            }
+        }
+    }, 16);
+}
+
+
+/**
+ * Grow or shrink the bitmap by a distance.
+ *
+ * An exact Euclidean distance transform finds for every pixel the distance to
+ * the nearest pixel of the opposite color. Pixels that are closer than r (plus
+ * half a pixel for the outline between the two) are flipped.
+ *
+ * The transform is limited to the bounding box of the set pixels, grown by
+ * the offset. Pixels outside of the bitmap count as cleared.
+ *
+ * If the coverage of the edge pixels is known, edge pixels of both colors are
+ * seeds, and the transform also finds the nearest seed of every pixel. The
+ * coverage of that seed tells how far the real edge is from its center, which
+ * corrects the distance by up to half a pixel. The pixels along the new edge
+ * get a coverage from the corrected distance, so that the result can be
+ * traced and offset again without losing accuracy.
+ *
+ * \param r distance in mm
+ * \param color 1 to expand the set pixels, 0 to contract them
+ */
+void IAFramebuffer::offsetBitmap(double r, int color)
+{
+    if (!isBitmap() || r<=0.0) return;
+    bindForRendering();
+
+    // find the exact bounding box of all set pixels inside the dirty box
+    int x0 = pWidth, x1 = -1, y0 = pHeight, y1 = -1;
+    int w0 = pDirtyX0/BM_WORDBITS, w1 = (pDirtyX1+BM_WORDBITS-1)/BM_WORDBITS;
+    for (int y=pDirtyY0; y<pDirtyY1; y++) {
+        for (int i=w0; i<w1; i++) {
+            potrace_word *p = wordAt(i, y);
+            if (p && *p) {
+                int xa = i*BM_WORDBITS, xb = std::min(pWidth, xa+BM_WORDBITS)-1;
+                while (xa<=xb && !getPixel(xa, y)) xa++;
+                while (xb>=xa && !getPixel(xb, y)) xb--;
+                if (xa<=xb) {
+                    x0 = std::min(x0, xa); x1 = std::max(x1, xb);
+                    y0 = std::min(y0, y);  y1 = std::max(y1, y);
+                }
+            }
+        }
+    }
+    if (x1<0) {
+        pDirtyX0 = 0; pDirtyY0 = 0; pDirtyX1 = 0; pDirtyY1 = 0;
+        dropEdgeCoverage();
+        unbindFromRendering();
+        return;
+    }
+    pDirtyX0 = x0; pDirtyY0 = y0; pDirtyX1 = x1+1; pDirtyY1 = y1+1;
+
+    double hx = pPrinter->pPrintVolume.x() / pWidth;
+    double hy = pPrinter->pPrintVolume.y() / pHeight;
+    double t = r + 0.25*(hx+hy);
+    double t2 = t*t;
+
+    // the region that can change, plus a ring of cleared pixels around it
+    int m = 1;
+    if (color==1)
+        m = (int)ceil(t/std::min(hx, hy)) + 1;
+    int rx0 = x0-m, ry0 = y0-m, rx1 = x1+m, ry1 = y1+m;
+    if (color==1) {
+        rx0 = std::max(rx0, 0); ry0 = std::max(ry0, 0);
+        rx1 = std::min(rx1, pWidth-1); ry1 = std::min(ry1, pHeight-1);
+    }
+    int w = rx1-rx0+1, h = ry1-ry0+1;
+
+    // samples per pixel plus one for all edge pixels in the region, 0 elsewhere
+    bool useCoverage = hasEdgeCoverage();
+    std::vector<uint8_t> edge;
+    if (useCoverage) {
+        edge.resize((size_t)w*h, 0);
+        pCoverage->forEach([&](int x, int y, int n) {
+            if (x>=rx0 && x<=rx1 && y>=ry0 && y<=ry1)
+                edge[(size_t)(y-ry0)*w+(x-rx0)] = (uint8_t)(n+1);
+        });
+    }
+
+    // pixels that already have the new color are the seeds of the distance
+    // field, and so are all edge pixels if the coverage is known
+    std::vector<double> dist((size_t)w*h);
+    std::vector<int> nearest(useCoverage ? (size_t)w*h : 0);
+    ia_parallel_for(h, [&](size_t b, size_t e) {
+        for (size_t j=b; j<e; j++) {
+            int y = ry0+(int)j;
+            for (int i=0; i<w; i++) {
+                int x = rx0+i;
+                int c = (bm_range(x, pWidth) && bm_range(y, pHeight)) ? getPixel(x, y) : 0;
+                bool seed = (c==color) || (useCoverage && edge[j*w+i]);
+                dist[j*w+i] = seed ? 0.0 : kDistanceInfinity;
+            }
+        }
+    }, 16);
+    distanceTransform2D(dist, w, h, hx, hy, useCoverage ? &nearest : nullptr);
+
+    if (useCoverage) {
+        offsetEdgeCoverage(r, color, rx0, ry0, w, h, dist, nearest, edge);
+        if (color==1)
+            markDirty(rx0, ry0, rx1+1, ry1+1);
+        unbindFromRendering();
+        return;
+    }
+
+    // flip all pixels within reach of the other color; rows don't share
+    // words, but tiles are allocated on first write, so tiled buffers are
+    // written by a single thread
+    ia_parallel_for(h, [&](size_t b, size_t e) {
+        for (size_t j=b; j<e; j++) {
+            int y = ry0+(int)j;
+            if (!bm_range(y, pHeight)) continue;
+            const double *dRow = dist.data()+j*w;
+            for (int i=0; i<w; i++) {
+                int x = rx0+i;
+                if (bm_range(x, pWidth) && dRow[i]<=t2)
+                    putPixel(x, y, color);
+            }
+        }
+    }, (pBuffers==TILED) ? (size_t)h : 16);
+    if (color==1)
+        markDirty(rx0, ry0, rx1+1, ry1+1);
+
+    unbindFromRendering();
+}
+
+
+/**
+ * Flip the pixels within reach of the other color, using the coverage of the
+ * edge pixels.
+ *
+ * This is the second half of offsetBitmap(). The distance of every pixel to
+ * the edge is the distance to its nearest seed, corrected by where the edge
+ * crosses the seed pixel. Pixels that are clearly on one side of the new edge
+ * are flipped or kept, and pixels within a pixel width of the new edge get a
+ * coverage from their distance, as if the edge was straight.
+ *
+ * \param r distance in mm
+ * \param color 1 to expand the set pixels, 0 to contract them
+ * \param rx0, ry0 bottom left corner of the region in pixels
+ * \param w, h size of the region in pixels
+ * \param dist squared distance of every pixel in the region to its nearest seed
+ * \param nearest index of the nearest seed of every pixel in the region
+ * \param edge samples plus one for every edge pixel in the region, 0 elsewhere
+ */
+void IAFramebuffer::offsetEdgeCoverage(double r, int color, int rx0, int ry0, int w, int h,
+                                       std::vector<double> const& dist,
+                                       std::vector<int> const& nearest,
+                                       std::vector<uint8_t> const& edge)
+{
+    const int ns = IAEdgeCoverage::kSamples;
+    double hx = pPrinter->pPrintVolume.x() / pWidth;
+    double hy = pPrinter->pPrintVolume.y() / pHeight;
+    double hs = 0.5*(hx+hy);
+    // the edge is up to half a pixel away from the center of a seed, and the
+    // new coverage fades over one pixel
+    double lo = std::max(0.0, r-hs), hi = r+hs;
+    double lo2 = lo*lo, hi2 = hi*hi;
+
+    std::vector<std::vector<std::pair<int,int>>> newEdge(h);
+    ia_parallel_for(h, [&](size_t b, size_t e) {
+        for (size_t j=b; j<e; j++) {
+            int y = ry0+(int)j;
+            if (!bm_range(y, pHeight)) continue;
+            for (int i=0; i<w; i++) {
+                int x = rx0+i;
+                if (!bm_range(x, pWidth)) continue;
+                size_t k = j*w+i;
+                bool set = getPixel(x, y);
+                int n = edge[k] ? edge[k]-1 : (set ? ns : 0);
+                double d2 = dist[k];
+                if (d2<lo2) {
+                    n = color ? ns : 0;
+                } else if (d2<hi2) {
+                    // seeds without coverage are entirely of the new color
+                    int q = nearest[k];
+                    int qn = edge[q] ? edge[q]-1 : (color ? ns : 0);
+                    double cq = (double)qn/ns;
+                    // coverage changes faster with distance for diagonal
+                    // edges; the direction to the seed approximates the normal
+                    double ex = (i-q%w)*hx, ey = ((int)j-q/w)*hy, len = sqrt(d2);
+                    double hn = (len>0.0) ? hs*std::max(fabs(ex), fabs(ey))/len : hs;
+                    double d = len + (color ? 0.5-cq : cq-0.5)*hn;
+                    double f = std::min(1.0, std::max(0.0, 0.5 + (d-r)/hn));
+                    int m = (int)lround(f*ns);
+                    n = color ? std::max(n, ns-m) : std::min(n, m);
+                }
+                bool now = (n*2>=ns);
+                if (now!=set)
+                    putPixel(x, y, now);
+                if (n>0 && n<ns)
+                    newEdge[j].push_back( { x, n } );
+            }
+        }
+    }, (pBuffers==TILED) ? (size_t)h : 16);
+
+    pCoverage->clear();
+    for (int j=0; j<h; j++)
+        for (auto &c: newEdge[j])
+            pCoverage->set(c.first, ry0+j, c.second);
+}
+
+
+/**
+ * Shrink the pattern in the bitmap by r.
+ *
+ * This has the same effect as subtracting the traced outline of the bitmap,
+ * but runs in linear time, independent of the length of the outline.
+ *
+ * \param r the pattern will be reduced by the amount in r
+ */
+void IAFramebuffer::contract(double r)
+{
+    offsetBitmap(r, 0);
+}
+
+
+/**
+ * Grow the pattern in the bitmap by r.
+ *
+ * This has the same effect as adding the traced outline of the bitmap,
+ * but runs in linear time, independent of the length of the outline.
+ *
+ * \param r the pattern will be expanded by the amount in r
+ */
+void IAFramebuffer::expand(double r)
+{
+    offsetBitmap(r, 1);
+}
+
+
+/**
+ * Create concentric loops that fill the set pixels, from the outline inward.
+ *
+ * This gives the same loops as calling toolpathFromLassoAndContract() until
+ * the buffer is empty, but a bitmap is neither traced nor contracted. The
+ * distance of every set pixel to the outline is calculated once, and all
+ * loops are the contour lines of that distance at multiples of w, found in a
+ * single pass. Loops are linked for every ring in parallel.
+ *
+ * OpenGL buffers are traced and contracted ring by ring instead.
+ *
+ * \param z create the toolpaths at this layer
+ * \param w distance between rings in mm
+ *
+ * \return a list of loops for every ring, starting with the outline; empty
+ *      if the buffer is empty
+ */
+std::vector<IAToolpathListSP> IAFramebuffer::toolpathFromConcentricRings(double z, double w)
+{
+    std::vector<IAToolpathListSP> rings;
+    if (!isBitmap()) {
+        /** \bug limit this to the width and hight of the build platform divided by the extrusion width */
+        for (int k=0; k<300; k++) {
+            auto tp = toolpathFromLassoAndContract(z, w);
+            if (!tp) break;
+            rings.push_back(tp);
+        }
+        return rings;
+    }
+    bindForRendering();
+    unbindFromRendering();
+    if (pDirtyX0>=pDirtyX1 || pDirtyY0>=pDirtyY1 || w<=0.0)
+        return rings;
+
+    // the field covers the dirty box and a ring of cleared pixels around it
+    int rx0 = pDirtyX0-1, ry0 = pDirtyY0-1;
+    int fw = pDirtyX1-pDirtyX0+2, fh = pDirtyY1-pDirtyY0+2;
+    double hx = pPrinter->pPrintVolume.x() / pWidth;
+    double hy = pPrinter->pPrintVolume.y() / pHeight;
+    // distance of every pixel to the nearest pixel of the other color
+    std::vector<double> field((size_t)fw*fh), outside((size_t)fw*fh);
+    ia_parallel_for(fh, [&](size_t b, size_t e) {
+        for (size_t j=b; j<e; j++) {
+            int y = ry0+(int)j;
+            for (int i=0; i<fw; i++) {
+                int x = rx0+i;
+                bool c = bm_range(x, pWidth) && bm_range(y, pHeight) && getPixel(x, y);
+                field[j*fw+i] = c ? kDistanceInfinity : 0.0;
+                outside[j*fw+i] = c ? 0.0 : kDistanceInfinity;
+            }
+        }
+    }, 16);
+    distanceTransform2D(field, fw, fh, hx, hy, nullptr);
+    distanceTransform2D(outside, fw, fh, hx, hy, nullptr);
+
+    // the outline is half way between the centers of set and cleared pixels;
+    // the signed distance to it is smoothed, so that the outer ring follows
+    // the shape instead of the pixel steps; away from the outline, the
+    // distance is almost linear and does not change
+    double halfPixel = 0.25*(hx+hy);
+    for (size_t i=0; i<field.size(); i++)
+        field[i] = (field[i]>0.0) ? sqrt(field[i])-halfPixel : halfPixel-sqrt(outside[i]);
+    for (int pass=0; pass<2; pass++) {
+        ia_parallel_for(fh, [&](size_t b, size_t e) {
+            for (size_t j=b; j<e; j++) {
+                const double *f = field.data()+j*fw;
+                double *o = outside.data()+j*fw;
+                o[0] = f[0]; o[fw-1] = f[fw-1];
+                for (int i=1; i<fw-1; i++)
+                    o[i] = 0.25*(f[i-1]+2.0*f[i]+f[i+1]);
+            }
+        }, 16);
+        ia_parallel_for(fw, [&](size_t b, size_t e) {
+            for (size_t i=b; i<e; i++) {
+                for (int j=1; j<fh-1; j++)
+                    field[(size_t)j*fw+i] = 0.25*(outside[(size_t)(j-1)*fw+i]
+                                                  + 2.0*outside[(size_t)j*fw+i]
+                                                  + outside[(size_t)(j+1)*fw+i]);
+            }
+        }, 16);
+    }
+
+    IAIsoContours contours(field.data(), fw, fh);
+    contours.extract(w, 0.5);
+    for (int k=0; k<contours.levels(); k++) {
+        auto tp = std::make_shared<IAToolpathList>(z);
+        for (auto &loop: contours.loops(k)) {
+            IAToolpathLoop *tl = new IAToolpathLoop(z);
+            for (size_t i=0; i<loop.size(); i++) {
+                double x = (rx0+loop[i].first+0.5)*hx;
+                double y = (ry0+loop[i].second+0.5)*hy;
+                if (i==0) tl->startPath(x, y); else tl->continuePath(x, y);
+            }
+            tl->closePath();
+            tp->add(tl, 0, 0, 0);
+        }
+        if (tp->isEmpty()) break;
+        rings.push_back(tp);
+    }
+    return rings;
+}
+
+
 /**
  * Overlay the image with stripes across or lengthwise.
  *
@@ -929,23 +2144,15 @@ void IAFramebuffer::overlayLidPattern(int i, double infillWdt)
     /** \todo What if the printer has negative coordintes as well? */
     double wdt = pPrinter->printVolumeMax().x();
     double hgt = pPrinter->printVolumeMax().y();
-    if (pBuffers==BITMAP) {
+    if (isBitmap()) {
         if (i&1) {
             int dx = infillWdt/pPrinter->pPrintVolume.x()*pWidth;
             if (dx<1) dx = 1;
-            for (int x=0; x<pWidth; x+=2*dx) {
-                for (int y=0; y<pHeight; y++) {
-                    bm_hline(pBitmap, x, x+dx, y, 0);
-                }
-            }
+            overlayStripes(IAStripePattern(IAStripePattern::kAngle90, dx, 2*dx), nullptr);
         } else {
             int dy = infillWdt/pPrinter->pPrintVolume.y()*pHeight;
             if (dy<1) dy = 1;
-            for (int y1=0; y1<pHeight; y1+=2*dy) {
-                for (int y2=0; y2<dy; y2++) {
-                    bm_hline(pBitmap, 0, pWidth, y1+y2, 0);
-                }
-            }
+            overlayStripes(IAStripePattern(IAStripePattern::kAngle0, dy, 2*dy), nullptr);
         }
     } else {
         glDisable(GL_DEPTH_TEST);
@@ -979,40 +2186,20 @@ void IAFramebuffer::overlayLidPattern(int i, double infillWdt)
 void IAFramebuffer::overlayInfillPattern(int i, double infillWdt)
 {
     bindForRendering();
-    if (pBuffers==BITMAP) {
+    if (isBitmap()) {
         infillWdt *= sqrt(2.0); // compensate that we draw at a 45 deg angle
         int dx = infillWdt/pPrinter->pPrintVolume.x()*pWidth;
         if (dx<1) dx = 1;
-        if (dx==10) {
-            /// \todo some ultra fast fill function using word sized lookup tables
-            // This is a special case for dx=10, just to try the effect
-            bm_word m = 0b1111111111000000000011111111110000000000111111111100000000001111;
-            bm_word lut[20];
-            for (int i=0; i<20; i++) lut[i] = (m>>i) | (m<<(20-i));
-            for (int y=0; y<pHeight; y++) {
-                bm_word *dst = bm_scanline(pBitmap, y);
-                int src = (i&1) ? y%20 : 19-(y%20);
-                for (int x=0; x<pBitmap->dy; x++) {
-                    *dst++ &= lut[src];
-                    src = (src+16)%20;
-                }
-            }
+        // Stripes are laid out from the first multiple of the period that can
+        // reach into the dirty box. The first stripe in a row starts a little
+        // to the right of it, so the pixels before that stay set.
+        int xStart = std::max(0, (pDirtyX0/(2*dx)-2)*2*dx);
+        if (i&1) {
+            overlayStripes(IAStripePattern(IAStripePattern::kAngle45, dx, 2*dx),
+                           [=](int y) { return xStart + y%(2*dx); });
         } else {
-            if (i&1) {
-                for (int y=0; y<pHeight; y++) {
-                    for (int x=0; x<pWidth; x+=2*dx) {
-                        int xx = x + y%(2*dx);
-                        bm_hline(pBitmap, xx, xx+dx, y, 0);
-                    }
-                }
-            } else {
-                for (int y=0; y<pHeight; y++) {
-                    for (int x=0; x<pWidth; x+=2*dx) {
-                        int xx = x+2*dx - y%(2*dx);
-                        bm_hline(pBitmap, xx, xx+dx, y, 0);
-                    }
-                }
-            }
+            overlayStripes(IAStripePattern(IAStripePattern::kAngle135, dx, 2*dx),
+                           [=](int y) { return xStart + 2*dx - y%(2*dx); });
         }
     } else {
         glDisable(GL_DEPTH_TEST);
@@ -1041,6 +2228,51 @@ void IAFramebuffer::overlayInfillPattern(int i, double infillWdt)
 }
 
 
+/**
+ * Clear all pixels in a bitmap buffer that are under a stripe pattern.
+ *
+ * The pattern only clears pixels, so there is nothing to do outside of the
+ * dirty box. Rows are combined with the pattern one word at a time, on
+ * multiple threads.
+ *
+ * \param pattern the stripes
+ * \param xFirst if set, returns for every row the column where the first
+ *      stripe starts; pixels left of it are not cleared
+ */
+void IAFramebuffer::overlayStripes(IAStripePattern const& pattern,
+                                   std::function<int(int)> const& xFirst)
+{
+    dropEdgeCoverage();
+    if (pDirtyX0>=pDirtyX1) return;
+    int w0 = pDirtyX0/BM_WORDBITS, w1 = (pDirtyX1+BM_WORDBITS-1)/BM_WORDBITS;
+    const int tw = IATiledBitmap::kTileWords;
+    ia_parallel_for((size_t)(pDirtyY1-pDirtyY0), [&](size_t b, size_t e) {
+        for (int y=pDirtyY0+(int)b; y<pDirtyY0+(int)e; y++) {
+            int x0 = xFirst ? xFirst(y) : 0;
+            if (pBuffers==TILED) {
+                // words are consecutive up to the end of each tile
+                for (int w=w0; w<w1; ) {
+                    int wEnd = std::min(w1, (w/tw+1)*tw);
+                    potrace_word *p = wordAt(w, y);
+                    if (p) pattern.apply(p, w, wEnd-w, y, x0);
+                    w = wEnd;
+                }
+            } else {
+                pattern.apply(wordAt(w0, y), w0, w1-w0, y, x0);
+            }
+        }
+    }, 64);
+}
+
+
+/**
+ * Fill the outline of a slice.
+ *
+ * Bitmaps are filled with 4x4 samples per pixel, and the coverage of the edge
+ * pixels is kept for tracing.
+ *
+ * \param rim the outline, loops are separated by nullptr
+ */
 void IAFramebuffer::drawLid(IAEdgeList &rim)
 {
     beginComplexPolygon();
@@ -1051,7 +2283,79 @@ void IAFramebuffer::drawLid(IAEdgeList &rim)
             addGap();
         }
     }
-    endComplexPolygon(1);
+    endComplexPolygon(1, isBitmap());
+}
+
+
+/**
+ * Draw the area that a mesh covers, as seen from above.
+ *
+ * Every triangle is projected straight down onto the print bed, so the
+ * result contains all pixels under any part of the mesh. This is much
+ * cheaper than rendering the mesh, and is the base for skirts and brims.
+ * Only bitmap buffers are supported.
+ *
+ * \param mesh the mesh at its current position
+ */
+void IAFramebuffer::drawFootprint(IAMesh *mesh)
+{
+    if (!isBitmap() || !mesh || mesh->vertexList.empty()) return;
+    dropEdgeCoverage();
+    bindForRendering();
+    mesh->updateGlobalSpace();
+
+    double sx = pWidth/pPrinter->pPrintVolume.x(), sy = pHeight/pPrinter->pPrintVolume.y();
+    double xMin = DBL_MAX, yMin = DBL_MAX, xMax = -DBL_MAX, yMax = -DBL_MAX;
+    for (auto v: mesh->vertexList) {
+        xMin = std::min(xMin, v->pGlobalPosition.x());
+        xMax = std::max(xMax, v->pGlobalPosition.x());
+        yMin = std::min(yMin, v->pGlobalPosition.y());
+        yMax = std::max(yMax, v->pGlobalPosition.y());
+    }
+    int x0 = std::max(0, (int)floor(xMin*sx)), x1 = std::min(pWidth, (int)ceil(xMax*sx)+1);
+    int y0 = std::max(0, (int)floor(yMin*sy)), y1 = std::min(pHeight, (int)ceil(yMax*sy)+1);
+    if (x0>=x1 || y0>=y1) return;
+
+    // sort the triangles into bands of rows once, so that every band only
+    // scans the triangles that reach into it
+    const int kBand = 64;
+    size_t nBands = (size_t)((y1-y0+kBand-1)/kBand);
+    std::vector<std::vector<IATriangle*>> band(nBands);
+    for (auto t: mesh->triangleList) {
+        double tMin = DBL_MAX, tMax = -DBL_MAX;
+        for (int j=0; j<3; j++) {
+            double y = t->vertex(j)->pGlobalPosition.y()*sy;
+            tMin = std::min(tMin, y);
+            tMax = std::max(tMax, y);
+        }
+        // the rows whose centers are within the triangle
+        int r0 = std::max(y0, (int)ceil(tMin-0.5)), r1 = std::min(y1, (int)ceil(tMax-0.5));
+        if (r0>=r1) continue;
+        for (int k=(r0-y0)/kBand; k<=(r1-1-y0)/kBand; k++)
+            band[k].push_back(t);
+    }
+
+    // every thread draws its own bands; tiles span many rows, so tiled
+    // buffers are drawn by a single thread
+    ia_parallel_for(nBands, [&](size_t b, size_t e) {
+        double p[3][3];
+        for (size_t k=b; k<e; k++) {
+            int r0 = y0+(int)k*kBand, r1 = std::min(y1, r0+kBand);
+            for (auto t: band[k]) {
+                for (int j=0; j<3; j++) {
+                    IAVector3d const& v = t->vertex(j)->pGlobalPosition;
+                    p[j][0] = v.x()*sx; p[j][1] = v.y()*sy; p[j][2] = 0.0;
+                }
+                ia_scan_triangle(p, x0, r0, x1, r1,
+                                 [this](int y, int xa, int xb, double, double) {
+                    hline(xa, xb, y, 1);
+                });
+            }
+        }
+    }, (pBuffers==TILED) ? nBands : 1);
+    markDirty(x0, y0, x1, y1);
+
+    unbindFromRendering();
 }
 
 
@@ -1062,16 +2366,32 @@ void IAFramebuffer::beginComplexPolygon()
 }
 
 
-void IAFramebuffer::endComplexPolygon(int color)
+/**
+ * Fill the polygon that was created with addPoint() and addGap().
+ *
+ * All loops together are filled using the even-odd rule. Without coverage,
+ * a pixel row y crosses an edge if one end is below y and the other end is at
+ * or above y, and a pixel is filled if the crossings left of its right border
+ * are odd.
+ *
+ * With coverage, every pixel is sampled at 4x4 points spread evenly over its
+ * area, and it is filled if at least half of the samples are inside the
+ * polygon. Filling with color 1 also records the number of samples of every
+ * pixel on the edge, which refineEdgePoint() uses to find the exact outline.
+ * The recorded coverage is exact if the buffer was empty before.
+ *
+ * \param color fill the polygon with 0 or 1
+ * \param coverage sample the pixel area instead of a single point
+ */
+void IAFramebuffer::endComplexPolygon(int color, bool coverage)
 {
     if (pnVertex < 2) return;
 
     addGap(); // adds the first coordinate of this loop and marks it as a gap
-    int begin = 0, end = pnVertex;
 
     Vertex *v = pVertex+0;
     int xMin = v->pX, xMax = xMin, yMin = v->pY, yMax = yMin;
-    for (int i = begin+1; i < end; i++) {
+    for (int i = 1; i < pnVertex; i++) {
         v = pVertex+i;
         if (v->pX < xMin) xMin = v->pX;
         if (v->pX > xMax) xMax = v->pX;
@@ -1079,57 +2399,311 @@ void IAFramebuffer::endComplexPolygon(int color)
         if (v->pY > yMax) yMax = v->pY;
     }
     xMax++; yMax++;
+    if (yMax <= yMin) return;
+
+    bool filled;
+    if (coverage && isBitmap()) {
+        const int sub = IAEdgeCoverage::kSubdivision;
+        if (!pCoverage && color)
+            pCoverage = new IAEdgeCoverage();
+        // sample spans of all sample rows within the current pixel row
+        std::vector<std::pair<int,int>> spans;
+        int pixelY = std::numeric_limits<int>::min();
+        filled = scanPolygon(sub, [&](int row, const float *x, int n) {
+            int y = (row>=0) ? row/sub : -((sub-1-row)/sub);
+            if (y != pixelY) {
+                fillEdgeCoverage(spans, pixelY, color);
+                pixelY = y;
+            }
+            // sample s is at (s+0.5)/sub and inside if x0 <= sample < x1
+            for (int i = 0; i < n-1; i += 2) {
+                int s0 = (int)ceilf(x[i]*sub - 0.5f), s1 = (int)ceilf(x[i+1]*sub - 0.5f);
+                if (s0 < s1) {
+                    spans.push_back( { s0, 1 } );
+                    spans.push_back( { s1, -1 } );
+                }
+            }
+        });
+        fillEdgeCoverage(spans, pixelY, color);
+    } else {
+        dropEdgeCoverage();
+        filled = scanPolygon(1, [&](int pixelY, const float *x, int n) {
+            //  Fill the pixels between node pairs.
+            for (int i = 0; i < n-1; i += 2) {
+                int x0 = (int)x[i], x1 = (int)x[i+1];
+                if (x0 >= xMax) break;
+                if (x1 > xMin) {
+                    if (x0 < xMin) x0 = xMin;
+                    if (x1 > xMax) x1 = xMax;
+                    hline(x0, x1, pixelY, color);
+                }
+            }
+        });
+    }
+    if (filled && color)
+        markDirty(xMin, yMin, xMax, yMax);
+}
+
+
+/**
+ * Find the crossings of every row with the edges of the current polygon.
+ *
+ * This is a scanline algorithm with an active edge table. Edges are sorted
+ * into buckets by the first row that they cross. While stepping through the
+ * rows, edges enter the active list from their bucket, and leave it after
+ * their last row. The active list is kept sorted by x with an insertion sort,
+ * which is very fast because the order rarely changes from one row to the
+ * next. Every row costs only as much as the number of edges crossing it.
+ *
+ * \param sub number of rows per pixel; with 1, rows are at the bottom of each
+ *      pixel, otherwise they are spread evenly over the pixel height
+ * \param row called for every row that crosses edges, with the row index in
+ *      units of 1/sub pixels, and the sorted x coordinates of the crossings
+ *
+ * \return false if the polygon has no edges that cross a row
+ */
+bool IAFramebuffer::scanPolygon(int sub, std::function<void(int, const float*, int)> const& row)
+{
+    int begin = 0, end = pnVertex;
+    float yScale = (float)sub, yOffset = (sub>1) ? 0.5f : 0.0f;
+    auto rowY = [&](int i) { return pVertex[i].pY*yScale - yOffset; };
+
+    int yMin = rowY(begin), yMax = yMin;
+    for (int i = begin+1; i < end; i++) {
+        float y = rowY(i);
+        if (y < yMin) yMin = y;
+        if (y > yMax) yMax = y;
+    }
+    yMax++;
+    if (yMax <= yMin) return false;
+
+    // An edge from vertex j to vertex i crosses all rows y with
+    // yLow < y <= yHigh. The crossing is calculated relative to vertex i.
+    struct Edge {
+        float x, y, dx, dy;
+        int lastRow;
+    };
+    std::vector<Edge> edges;
+    edges.reserve(end - begin);
+    int nRows = yMax - yMin;
+    std::vector<int> bucket(nRows+1, 0);
+    std::vector<int> firstRow;
+    firstRow.reserve(end - begin);
+    for (int i = begin+1; i < end; i++) {
+        int j = i-1;
+        if (pVertex[j].pIsGap)
+            continue;
+        float yi = rowY(i), yj = rowY(j);
+        int first = (int)floorf(yi < yj ? yi : yj) + 1;
+        int last = (int)floorf(yi < yj ? yj : yi);
+        if (first < yMin) first = yMin;
+        if (last >= yMax) last = yMax-1;
+        if (first > last)
+            continue;
+        edges.push_back( { pVertex[i].pX, yi, pVertex[j].pX - pVertex[i].pX, yj - yi, last } );
+        firstRow.push_back(first);
+        bucket[first - yMin + 1]++;
+    }
+    if (edges.empty()) return false;
+
+    // sort the edges by their first row
+    for (int r = 0; r < nRows; r++)
+        bucket[r+1] += bucket[r];
+    std::vector<int> sorted(edges.size());
+    {
+        std::vector<int> fill(bucket.begin(), bucket.end()-1);
+        for (int e = 0; e < (int)edges.size(); e++)
+            sorted[fill[firstRow[e] - yMin]++] = e;
+    }
 
-    int nodes, pixelY, i, j, swap;
-	int *nodeX = (int*)::malloc((end - begin) * sizeof(int));
+    struct Active {
+        float x;
+        int edge;
+    };
+    std::vector<Active> active;
+    std::vector<float> crossing;
 
     //  Loop through the rows of the image.
-    for (pixelY = yMin; pixelY < yMax; pixelY++) {
-        //  Build a list of nodes.
-        nodes = 0;
-        for (i = begin+1; i < end; i++) {
-            j = i-1;
-            if (pVertex[j].pIsGap)
-                continue;
-            if (   (pVertex[i].pY < pixelY && pVertex[j].pY >= pixelY)
-                || (pVertex[j].pY < pixelY && pVertex[i].pY >= pixelY) )
-            {
-                float dy = pVertex[j].pY - pVertex[i].pY;
-                if (fabsf(dy)>.0001) {
-                    nodeX[nodes++] = (int)(pVertex[i].pX +
-                                           (pixelY - pVertex[i].pY) / dy
-                                           * (pVertex[j].pX - pVertex[i].pX));
-                } else {
-                    nodeX[nodes++] = pVertex[i].pX;
-                }
-            }
+    for (int rowIndex = yMin; rowIndex < yMax; rowIndex++) {
+        int r = rowIndex - yMin;
+
+        // add new edges and remove edges that ended in the previous row
+        for (int k = bucket[r]; k < bucket[r+1]; k++)
+            active.push_back( { 0.0f, sorted[k] } );
+        int n = 0;
+        for (auto &a: active) {
+            if (edges[a.edge].lastRow >= rowIndex)
+                active[n++] = a;
         }
-        //Fl_Android_Application::log_e("%d nodes (must be even!)", nodes);
-
-        //  Sort the nodes, via a simple “Bubble” sort.
-        i = 0;
-        while (i < nodes - 1) {
-            if (nodeX[i] > nodeX[i + 1]) {
-                swap = nodeX[i];
-                nodeX[i] = nodeX[i + 1];
-                nodeX[i + 1] = swap;
-                if (i) i--;
+        active.resize(n);
+        if (n==0) continue;
+
+        // find the crossing of every active edge with this row
+        for (auto &a: active) {
+            Edge &e = edges[a.edge];
+            if (fabsf(e.dy)>.0001) {
+                a.x = e.x + (rowIndex - e.y) / e.dy * e.dx;
             } else {
-                i++;
+                a.x = e.x;
             }
         }
 
-        //  Fill the pixels between node pairs.
-        for (i = 0; i < nodes-1; i += 2) {
-            if (nodeX[i] >= xMax) break;
-            if (nodeX[i + 1] > xMin) {
-                if (nodeX[i] < xMin) nodeX[i] = xMin;
-                if (nodeX[i + 1] > xMax) nodeX[i + 1] = xMax;
-                bm_hline(pBitmap, nodeX[i], nodeX[i+1], pixelY, color);
+        // keep the list sorted; it is mostly sorted from the previous row
+        for (int i = 1; i < n; i++) {
+            Active a = active[i];
+            int j = i;
+            while (j > 0 && active[j-1].x > a.x) {
+                active[j] = active[j-1];
+                j--;
             }
+            active[j] = a;
         }
+
+        crossing.resize(n);
+        for (int i = 0; i < n; i++)
+            crossing[i] = active[i].x;
+        row(rowIndex, crossing.data(), n);
+    }
+    return true;
+}
+
+
+/**
+ * Fill one row of pixels from the spans of samples that are inside a polygon.
+ *
+ * Pixels that have all samples inside are filled as runs. For every other
+ * pixel, the samples are counted. It is filled if at least half of them are
+ * inside, and its coverage is recorded when filling with 1.
+ *
+ * \param spans start and end of every span of samples of all sample rows in
+ *      this pixel row, as pairs of sample column and +1 or -1; the list is
+ *      cleared on return
+ * \param y pixel row
+ * \param color fill with 0 or 1
+ */
+void IAFramebuffer::fillEdgeCoverage(std::vector<std::pair<int,int>> &spans, int y, int color)
+{
+    const int sub = IAEdgeCoverage::kSubdivision;
+    if (spans.empty() || y<0 || y>=pHeight) {
+        spans.clear();
+        return;
     }
-	::free((void*)nodeX);
+    std::sort(spans.begin(), spans.end());
+
+    // walk the spans and count how many sample rows are inside at every
+    // sample column
+    std::vector<std::pair<int,int>> cells;
+    int depth = 0, a = 0, sMax = pWidth*sub;
+    for (auto &e: spans) {
+        int b = std::min(e.first, sMax);
+        a = std::max(a, 0);
+        if (depth>0 && b>a) {
+            int pa = a/sub, pb = (b-1)/sub;
+            if (pa==pb) {
+                cells.push_back( { pa, depth*(b-a) } );
+            } else {
+                cells.push_back( { pa, depth*((pa+1)*sub-a) } );
+                if (depth==sub) {
+                    if (pa+1<pb) hline(pa+1, pb, y, color);
+                } else {
+                    for (int x=pa+1; x<pb; x++)
+                        cells.push_back( { x, depth*sub } );
+                }
+                cells.push_back( { pb, depth*(b-pb*sub) } );
+            }
+        }
+        depth += e.second;
+        a = e.first;
+    }
+    spans.clear();
+
+    // add up the samples of pixels that are shared by more than one span
+    std::sort(cells.begin(), cells.end());
+    for (size_t i=0; i<cells.size(); ) {
+        int x = cells[i].first, n = 0;
+        for ( ; i<cells.size() && cells[i].first==x; i++)
+            n += cells[i].second;
+        if (n*2>=IAEdgeCoverage::kSamples)
+            putPixel(x, y, color);
+        if (color && pCoverage)
+            pCoverage->set(x, y, n);
+    }
+}
+
+
+/**
+ * Check if the edge pixels of this buffer have a known coverage.
+ *
+ * \return true if tracers can use refineEdgePoint()
+ */
+bool IAFramebuffer::hasEdgeCoverage()
+{
+    return isBitmap() && hasFBO() && pCoverage && !pCoverage->empty();
+}
+
+
+/**
+ * Forget the coverage of the edge pixels after the bitmap was modified.
+ */
+void IAFramebuffer::dropEdgeCoverage()
+{
+    delete pCoverage;
+    pCoverage = nullptr;
+}
+
+
+/**
+ * Get the fraction of a pixel that is covered by the shape.
+ *
+ * \param x, y pixel position; pixels outside of the buffer are not covered
+ *
+ * \return 0 for a clear pixel, 1 for a fully covered pixel
+ */
+double IAFramebuffer::coverageAt(int x, int y)
+{
+    if (!bm_range(x, pWidth) || !bm_range(y, pHeight)) return 0.0;
+    int n = getPixel(x, y) ? IAEdgeCoverage::kSamples : 0;
+    if (pCoverage) n = pCoverage->get(x, y, n);
+    return (double)n/IAEdgeCoverage::kSamples;
+}
+
+
+/**
+ * Move a point of a traced outline onto the edge of the shape.
+ *
+ * Tracers follow the borders between set and clear pixels. The coverage of
+ * the pixels is interpolated between pixel centers, and the point is moved
+ * along the gradient to where half a pixel is covered. Points that would move
+ * further than one pixel are left alone.
+ *
+ * \param[inout] x, y position in pixels, where pixel (x, y) spans the square
+ *      from (x, y) to (x+1, y+1)
+ *
+ * \return true if the point was moved
+ */
+bool IAFramebuffer::refineEdgePoint(double &x, double &y)
+{
+    if (!hasEdgeCoverage()) return false;
+    double px = x, py = y;
+    for (int k=0; k<3; k++) {
+        double u = px-0.5, v = py-0.5;
+        int ix = (int)floor(u), iy = (int)floor(v);
+        double fx = u-ix, fy = v-iy;
+        double c00 = coverageAt(ix, iy), c10 = coverageAt(ix+1, iy);
+        double c01 = coverageAt(ix, iy+1), c11 = coverageAt(ix+1, iy+1);
+        double c = c00*(1-fx)*(1-fy) + c10*fx*(1-fy) + c01*(1-fx)*fy + c11*fx*fy;
+        double gx = (c10-c00)*(1-fy) + (c11-c01)*fy;
+        double gy = (c01-c00)*(1-fx) + (c11-c10)*fx;
+        double g2 = gx*gx + gy*gy;
+        if (g2<1e-6) break;
+        double s = (c-0.5)/g2;
+        px -= s*gx; py -= s*gy;
+        if (fabs(c-0.5)<0.005) break;
+    }
+    double dx = px-x, dy = py-y;
+    if (dx*dx+dy*dy>1.0) return false;
+    x = px; y = py;
+    return true;
 }
 
 
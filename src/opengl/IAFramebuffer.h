@@ -10,11 +10,14 @@
 #include "Iota.h"
 #include "toolpath/IAToolpath.h"
 #include "potrace/potracelib.h"
+#include "opengl/IABitmapKernels.h"
 
 #include <FL/gl.h>
 #include <FL/glu.h>
 
 #include <memory>
+#include <functional>
+#include <vector>
 
 
 // Abundant error checking: why did glDebugMessageCallback not exist since OpenGL 1.0? Sigh.
@@ -29,6 +32,11 @@ extern const char *glIAErrorString(int err);
 
 class IAToolpath;
 class IAPrinter;
+class IATiledBitmap;
+class IARunLengthBitmap;
+class IAStripePattern;
+class IAEdgeCoverage;
+class IAMesh;
 
 
 /**
@@ -74,11 +82,23 @@ public:
         NONE = 0,
         RGBA,
         RGBAZ,
-        BITMAP
+        BITMAP,
+        TILED
     } Buffers;
 
-    IAFramebuffer(IAPrinter*, Buffers type);
+    /**
+     * The printer defines a full resolution raster for shells and lids, and
+     * a coarse raster for infill and support.
+     */
+    typedef enum {
+        FINE = 0,
+        COARSE
+    } Resolution;
+
+    IAFramebuffer(IAPrinter*, Buffers type, Resolution res=FINE);
     IAFramebuffer(IAFramebuffer*);
+    IAFramebuffer(IAFramebuffer*, Buffers type);
+    IAFramebuffer(IAFramebuffer*, Buffers type, Resolution res);
     ~IAFramebuffer();
     void fill(int color);
 
@@ -92,33 +112,56 @@ public:
     int saveAsJpeg(const char *filename, GLubyte *imgdata=nullptr);
     int saveAsPng(const char *filename, int components, GLubyte *imgdata=nullptr, bool rle=false);
 
-    /** Width in pixels.
+    /** Width in pixels, known after the buffer was bound for the first time.
      \return the width of the buffer. */
     int width() { return pWidth; }
 
-    /** Height in pixels.
+    /** Height in pixels, known after the buffer was bound for the first time.
      \return the height of the buffer. */
     int height() { return pHeight; }
 
     /** Buffer type */
     Buffers buffers() { return pBuffers; }
 
+    /** Raster that this buffer uses */
+    Resolution resolution() { return pResolution; }
+
+    /** Buffers that are drawn in software instead of OpenGL, either dense or tiled.
+     \return true for BITMAP and TILED buffers */
+    bool isBitmap() { return pBuffers==BITMAP || pBuffers==TILED; }
+
     void logicAndNot(IAFramebuffer*);
     void logicAnd(IAFramebuffer*);
+    void logicOr(IAFramebuffer*);
+    void logicXor(IAFramebuffer*);
+    void logicOr(IARunLengthBitmap const&);
+    IARunLengthBitmap *createRunLengthBitmap();
+    size_t countPixels();
+    size_t memoryUsed();
+    double area();
+    void dirtyBox(int &x0, int &y0, int &x1, int &y1);
+    potrace_bitmap_t *createTraceBitmap(int &ox, int &oy);
+    bool hasEdgeCoverage();
+    bool refineEdgePoint(double &x, double &y);
 
     void subtract(IAToolpathListSP, double r);
     void add(IAToolpathListSP, double r);
+    void contract(double r);
+    void expand(double r);
     IAToolpathListSP toolpathFromLassoAndContract(double z, double r);
     IAToolpathListSP toolpathFromLassoAndExpand(double z, double r);
     IAToolpathListSP toolpathFromLasso(double z);
+    IAToolpathListSP toolpathFromStripes(double z, int i, double w);
+    std::vector<IAToolpathListSP> toolpathFromConcentricRings(double z, double w);
 
     void overlayLidPattern(int i, double w);
     void overlayInfillPattern(int i, double w);
 
     void drawLid(IAEdgeList &rim);
+    void drawFootprint(IAMesh *mesh);
 
     void beginComplexPolygon();
-    void endComplexPolygon(int color);
+    void endComplexPolygon(int color, bool coverage=false);
     void addPoint(IAVector3d&);
     void addPoint(double x, double y);
     void addGap();
@@ -134,6 +177,28 @@ protected:
     void deleteFBO();
 
     void addPointRaw(float x, float y, bool gap=false);
+    void offsetBitmap(double r, int color);
+    void offsetEdgeCoverage(double r, int color, int rx0, int ry0, int w, int h,
+                            std::vector<double> const& dist,
+                            std::vector<int> const& nearest,
+                            std::vector<uint8_t> const& edge);
+    /** Logic operations between two bitmap buffers */
+    typedef enum { kAnd, kAndNot, kOr, kXor } BitOp;
+    void combineBitmap(IAFramebuffer *src, BitOp op,
+                       int x0, int y0, int x1, int y1);
+    potrace_word *wordAt(int w, int y, bool create=false);
+    bool getPixel(int x, int y);
+    void putPixel(int x, int y, int color);
+    void hline(int x1, int x2, int y, int color);
+    void overlayStripes(IAStripePattern const& pattern,
+                        std::function<int(int)> const& xFirst);
+    void markDirty(int x0, int y0, int x1, int y1);
+    bool scanPolygon(int sub, std::function<void(int, const float*, int)> const& row);
+    void fillEdgeCoverage(std::vector<std::pair<int,int>> &spans, int y, int color);
+    double coverageAt(int x, int y);
+    void dropEdgeCoverage();
+    void resampleBitmap(IAFramebuffer *src);
+    IAFramebuffer *sameSizeBitmap(IAFramebuffer *src, std::unique_ptr<IAFramebuffer> &tmp);
 
     class Vertex {
     public:
@@ -146,11 +211,11 @@ protected:
     Vertex *pVertex = nullptr;
 
 
-    /** Width of the framebuffer in pixles */
-    int pWidth = kFramebufferSize;
+    /** Width of the framebuffer in pixles, 0 until the buffer is created */
+    int pWidth = 0;
 
-    /** Height of the framebuffer in pixles */
-    int pHeight = kFramebufferSize; // see Iota.cpp
+    /** Height of the framebuffer in pixles, 0 until the buffer is created */
+    int pHeight = 0; // see IAPrinter::rasterSize()
 
     /** Set this flag if the OpenGL framebuffer object is created */
     bool pFramebufferCreated = false;
@@ -167,11 +232,27 @@ protected:
     /** An enum that lists the buffers used in this framebuffer */
     Buffers pBuffers = NONE;
 
+    /** The raster that sets the size of this buffer */
+    Resolution pResolution = FINE;
+
     /** Use this to retrieve the build volume when rendering. */
     IAPrinter *pPrinter = nullptr;
 
+    /** Box in pixels around all pixels that are set in a BITMAP buffer. The
+     box may be larger than needed, but no pixel outside of it is set. pDirtyX1
+     and pDirtyY1 are exclusive. The box is empty if pDirtyX0>=pDirtyX1. */
+    int pDirtyX0 = 0, pDirtyY0 = 0, pDirtyX1 = 0, pDirtyY1 = 0;
+
+    /** Coverage of the edge pixels of a bitmap buffer, if it was drawn with
+     coverage; nullptr after any operation that doesn't track coverage */
+    IAEdgeCoverage *pCoverage = nullptr;
+
 public:
+    /** Pixels of a BITMAP buffer */
     potrace_bitmap_t *pBitmap = nullptr;
+
+    /** Pixels of a TILED buffer */
+    IATiledBitmap *pTiles = nullptr;
 };
 
 
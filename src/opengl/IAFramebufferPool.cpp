@@ -0,0 +1,266 @@
+//
+//  IAFramebufferPool.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IAFramebufferPool.h"
+
+#include "potrace/bitmap.h"
+
+
+/**
+ * Get the pool that all framebuffers share.
+ *
+ * The pool is never deleted, so that OpenGL objects are not released after
+ * the OpenGL context is gone.
+ *
+ * \return the pool
+ */
+IAFramebufferPool &IAFramebufferPool::shared()
+{
+    static IAFramebufferPool *pool = new IAFramebufferPool();
+    return *pool;
+}
+
+
+/**
+ * Get a bitmap with all pixels clear.
+ *
+ * \param res raster of the framebuffer that needs the bitmap
+ * \param w, h size in pixels
+ *
+ * \return a bitmap that must be given back with releaseBitmap(), or nullptr
+ *      if there is not enough memory
+ */
+potrace_bitmap_t *IAFramebufferPool::acquireBitmap(IAFramebuffer::Resolution res, int w, int h)
+{
+    {
+        std::lock_guard<std::mutex> lock(pMutex);
+        dropOtherSizes(IAFramebuffer::BITMAP, res, w, h);
+        for (size_t i=pEntry.size(); i>0; i--) {
+            Entry &e = pEntry[i-1];
+            if (e.type==IAFramebuffer::BITMAP && e.res==res) {
+                potrace_bitmap_t *bm = e.bitmap;
+                pBytesPooled -= bytesFor(e.type, w, h);
+                pEntry.erase(pEntry.begin()+(i-1));
+                countRequest(bytesFor(IAFramebuffer::BITMAP, w, h), false);
+                return bm;
+            }
+        }
+    }
+    // allocate outside of the lock, bm_new() clears megabytes of memory
+    potrace_bitmap_t *bm = bm_new(w, h);
+    if (bm) {
+        std::lock_guard<std::mutex> lock(pMutex);
+        countRequest(bytesFor(IAFramebuffer::BITMAP, w, h), true);
+    }
+    return bm;
+}
+
+
+/**
+ * Give a bitmap back to the pool.
+ *
+ * \param res raster that was used to acquire the bitmap
+ * \param bm a bitmap from acquireBitmap(); all pixels must be clear
+ */
+void IAFramebufferPool::releaseBitmap(IAFramebuffer::Resolution res, potrace_bitmap_t *bm)
+{
+    if (!bm) return;
+    std::lock_guard<std::mutex> lock(pMutex);
+    size_t bytes = bytesFor(IAFramebuffer::BITMAP, bm->w, bm->h);
+    countRelease(bytes);
+    pEntry.push_back({ IAFramebuffer::BITMAP, res, bm->w, bm->h, bm, 0, 0, 0 });
+    pBytesPooled += bytes;
+}
+
+
+/**
+ * Get an OpenGL framebuffer object with its color and depth buffer.
+ *
+ * If no buffer of this type and size is waiting, the caller creates a new
+ * one, and gives it back with releaseGL() when done. The contents of a reused
+ * buffer are undefined.
+ *
+ * \param type RGBA or RGBAZ
+ * \param res raster of the framebuffer
+ * \param w, h size in pixels
+ * \param[out] framebuffer, color, depth the OpenGL objects; depth is 0 for RGBA
+ *
+ * \return true if a buffer was reused, false if the caller must create one
+ */
+bool IAFramebufferPool::acquireGL(IAFramebuffer::Buffers type, IAFramebuffer::Resolution res,
+                                  int w, int h, GLuint &framebuffer, GLuint &color, GLuint &depth)
+{
+    std::lock_guard<std::mutex> lock(pMutex);
+    dropOtherSizes(type, res, w, h);
+    for (size_t i=pEntry.size(); i>0; i--) {
+        Entry &e = pEntry[i-1];
+        if (e.type==type && e.res==res) {
+            framebuffer = e.framebuffer;
+            color = e.color;
+            depth = e.depth;
+            pBytesPooled -= bytesFor(type, w, h);
+            pEntry.erase(pEntry.begin()+(i-1));
+            countRequest(bytesFor(type, w, h), false);
+            return true;
+        }
+    }
+    countRequest(bytesFor(type, w, h), true);
+    return false;
+}
+
+
+/**
+ * Give an OpenGL framebuffer object back to the pool.
+ *
+ * \param type RGBA or RGBAZ
+ * \param res raster of the framebuffer
+ * \param w, h size in pixels
+ * \param framebuffer, color, depth the OpenGL objects
+ */
+void IAFramebufferPool::releaseGL(IAFramebuffer::Buffers type, IAFramebuffer::Resolution res,
+                                  int w, int h, GLuint framebuffer, GLuint color, GLuint depth)
+{
+    std::lock_guard<std::mutex> lock(pMutex);
+    size_t bytes = bytesFor(type, w, h);
+    countRelease(bytes);
+    pEntry.push_back({ type, res, w, h, nullptr, framebuffer, color, depth });
+    pBytesPooled += bytes;
+}
+
+
+/**
+ * Release all buffers that are waiting to be reused, and reset the statistics.
+ *
+ * Buffers that are in use are given back later, and are kept from then on.
+ */
+void IAFramebufferPool::purge()
+{
+    std::lock_guard<std::mutex> lock(pMutex);
+    for (auto &e: pEntry)
+        freeEntry(e);
+    pEntry.clear();
+    pBytesPooled = 0;
+    size_t inUse = pStats.inUse, bytesInUse = pStats.bytesInUse;
+    pStats = Stats();
+    pStats.inUse = pStats.inUseHighWater = inUse;
+    pStats.bytesInUse = pStats.bytesHighWater = bytesInUse;
+}
+
+
+/**
+ * Print the pool statistics to the console.
+ */
+void IAFramebufferPool::printStats()
+{
+    std::lock_guard<std::mutex> lock(pMutex);
+    printf("Framebuffers: %zu requests, %zu allocations, %zu in use, "
+           "%zu at most, %.1f MB at most, %.1f MB pooled.\n",
+           pStats.requests, pStats.allocations, pStats.inUse,
+           pStats.inUseHighWater, pStats.bytesHighWater/1048576.0,
+           pBytesPooled/1048576.0);
+}
+
+
+/**
+ * Estimate the memory of a buffer.
+ *
+ * \param type BITMAP, RGBA, or RGBAZ
+ * \param w, h size in pixels
+ *
+ * \return size in bytes
+ */
+size_t IAFramebufferPool::bytesFor(IAFramebuffer::Buffers type, int w, int h)
+{
+    switch (type) {
+        case IAFramebuffer::BITMAP:
+            return (size_t)((w+BM_WORDBITS-1)/BM_WORDBITS)*h*BM_WORDSIZE;
+        case IAFramebuffer::RGBA:
+            return (size_t)w*h*4;
+        case IAFramebuffer::RGBAZ:
+            return (size_t)w*h*8;
+        default:
+            return 0;
+    }
+}
+
+
+/**
+ * Count a buffer that is handed out. Call with pMutex locked.
+ *
+ * \param bytes size of the buffer
+ * \param allocated the buffer was newly allocated
+ */
+void IAFramebufferPool::countRequest(size_t bytes, bool allocated)
+{
+    pStats.requests++;
+    if (allocated) pStats.allocations++;
+    pStats.inUse++;
+    pStats.bytesInUse += bytes;
+    if (pStats.inUse>pStats.inUseHighWater)
+        pStats.inUseHighWater = pStats.inUse;
+    if (pStats.bytesInUse>pStats.bytesHighWater)
+        pStats.bytesHighWater = pStats.bytesInUse;
+}
+
+
+/**
+ * Count a buffer that is given back. Call with pMutex locked.
+ *
+ * \param bytes size of the buffer
+ */
+void IAFramebufferPool::countRelease(size_t bytes)
+{
+    if (pStats.inUse>0) pStats.inUse--;
+    pStats.bytesInUse = (pStats.bytesInUse>bytes) ? pStats.bytesInUse-bytes : 0;
+}
+
+
+/**
+ * Free the storage of a pooled buffer.
+ *
+ * \param e the pool entry; it must be removed from the pool by the caller
+ */
+void IAFramebufferPool::freeEntry(Entry &e)
+{
+    if (e.type==IAFramebuffer::BITMAP) {
+        bm_free(e.bitmap);
+        e.bitmap = nullptr;
+    } else {
+        IA_HANDLE_GL_ERRORS();
+        if (e.color)
+            glDeleteTextures(1, &e.color);
+        if (e.depth)
+            glDeleteRenderbuffersEXT(1, &e.depth);
+        if (e.framebuffer)
+            glDeleteFramebuffersEXT(1, &e.framebuffer);
+        IA_HANDLE_GL_ERRORS();
+    }
+}
+
+
+/**
+ * Free pooled buffers of a type and raster that have a different size.
+ *
+ * The size of a raster only changes if the printer settings change, so these
+ * buffers will never be used again. Call with pMutex locked.
+ *
+ * \param type, res buffer type and raster
+ * \param w, h the current size of this raster
+ */
+void IAFramebufferPool::dropOtherSizes(IAFramebuffer::Buffers type, IAFramebuffer::Resolution res, int w, int h)
+{
+    for (size_t i=pEntry.size(); i>0; i--) {
+        Entry &e = pEntry[i-1];
+        if (e.type==type && e.res==res && (e.w!=w || e.h!=h)) {
+            pBytesPooled -= bytesFor(e.type, e.w, e.h);
+            freeEntry(e);
+            pEntry.erase(pEntry.begin()+(i-1));
+        }
+    }
+}
+
+
@@ -0,0 +1,98 @@
+//
+//  IAFramebufferPool.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_FRAMEBUFFER_POOL_H
+#define IA_FRAMEBUFFER_POOL_H
+
+
+#include "opengl/IAFramebuffer.h"
+
+#include <mutex>
+#include <vector>
+#include <stddef.h>
+
+
+/**
+ Recycles the pixel storage of framebuffers.
+
+ Slicing a layer creates a handful of short lived framebuffers for lids,
+ masks, infill, skirt, and support. Instead of allocating megabytes of
+ bitmap or an OpenGL framebuffer object for every one of them, IAFramebuffer
+ takes the storage from this pool when it is first bound, and returns it
+ when the framebuffer is deleted.
+
+ Storage is kept by buffer type and resolution. Bitmaps are returned with all
+ pixels clear; OpenGL buffers are cleared by the framebuffer after it gets
+ them. The pool never keeps more buffers than were in use at the same time,
+ so after the first few layers, slicing needs no large allocations at all.
+
+ TILED buffers allocate their tiles on demand and are not pooled.
+ */
+class IAFramebufferPool
+{
+public:
+    /** Statistics to verify that slicing reuses its buffers. */
+    struct Stats {
+        /// storage requests by framebuffers
+        size_t requests = 0;
+        /// requests that needed a new allocation
+        size_t allocations = 0;
+        /// buffers handed out right now
+        size_t inUse = 0;
+        /// highest number of buffers handed out at the same time
+        size_t inUseHighWater = 0;
+        /// memory of the buffers handed out right now in bytes
+        size_t bytesInUse = 0;
+        /// highest memory handed out at the same time in bytes
+        size_t bytesHighWater = 0;
+    };
+
+    static IAFramebufferPool &shared();
+
+    potrace_bitmap_t *acquireBitmap(IAFramebuffer::Resolution res, int w, int h);
+    void releaseBitmap(IAFramebuffer::Resolution res, potrace_bitmap_t *bm);
+    bool acquireGL(IAFramebuffer::Buffers type, IAFramebuffer::Resolution res,
+                   int w, int h, GLuint &framebuffer, GLuint &color, GLuint &depth);
+    void releaseGL(IAFramebuffer::Buffers type, IAFramebuffer::Resolution res,
+                   int w, int h, GLuint framebuffer, GLuint color, GLuint depth);
+    void purge();
+
+    /** Statistics since the last purge. \return request, allocation, and high water counts */
+    Stats const& stats() const { return pStats; }
+    /** Memory of the buffers waiting to be reused. \return size in bytes */
+    size_t bytesPooled() const { return pBytesPooled; }
+    void printStats();
+
+private:
+    /** Storage of one framebuffer that is waiting to be reused. */
+    struct Entry {
+        IAFramebuffer::Buffers type;
+        IAFramebuffer::Resolution res;
+        int w, h;
+        potrace_bitmap_t *bitmap;
+        GLuint framebuffer, color, depth;
+    };
+
+    IAFramebufferPool() { }
+    static size_t bytesFor(IAFramebuffer::Buffers type, int w, int h);
+    void countRequest(size_t bytes, bool allocated);
+    void countRelease(size_t bytes);
+    void freeEntry(Entry &e);
+    void dropOtherSizes(IAFramebuffer::Buffers type, IAFramebuffer::Resolution res, int w, int h);
+
+    /// buffers that are waiting to be reused
+    std::vector<Entry> pEntry;
+    /// memory of all buffers in pEntry in bytes
+    size_t pBytesPooled = 0;
+    Stats pStats;
+    /// bitmaps may be requested from worker threads
+    std::mutex pMutex;
+};
+
+
+#endif /* IA_FRAMEBUFFER_POOL_H */
+
+
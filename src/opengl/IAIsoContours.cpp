@@ -0,0 +1,232 @@
+//
+//  IAIsoContours.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IAIsoContours.h"
+
+#include "app/IAParallel.h"
+
+#include <math.h>
+#include <algorithm>
+#include <mutex>
+
+
+/// loops that enclose fewer square samples than this are dropped, like
+/// specks in potrace
+static const double kMinLoopArea = 20.0;
+
+
+/**
+ * Prepare the contours of a field.
+ *
+ * \param field w*h samples, row by row; the field must stay valid until
+ *      extract() returns
+ * \param w, h number of samples in a row and a column
+ */
+IAIsoContours::IAIsoContours(const double *field, int w, int h)
+:   pField( field ),
+    pW( w ),
+    pH( h )
+{
+}
+
+
+/**
+ * Find the contour lines at all levels.
+ *
+ * \param step distance between levels; level k is at k*step, starting at 0
+ * \param tolerance loops are simplified as long as no point moves by more
+ *      than this, in samples
+ */
+void IAIsoContours::extract(double step, double tolerance)
+{
+    pLoops.clear();
+    if (pW<2 || pH<2 || step<=0.0) return;
+    double vMax = *std::max_element(pField, pField+(size_t)pW*pH);
+    if (vMax<=0.0) return;
+    // level k has contours if k*step is below the highest sample
+    int nLevels = (int)ceil(vMax/step);
+
+    // one pass over all cells finds the segments of all levels; edges are
+    // numbered 2*(y*w+x), plus one for edges along y
+    std::vector<std::vector<Segment>> segments(nLevels);
+    std::mutex merge;
+    ia_parallel_for((size_t)(pH-1), [&](size_t b, size_t e) {
+        std::vector<std::vector<Segment>> local(nLevels);
+        for (int y=(int)b; y<(int)e; y++) {
+            const double *r0 = pField + (size_t)y*pW, *r1 = r0 + pW;
+            for (int x=0; x<pW-1; x++) {
+                // corners and edges in counter-clockwise order
+                double v[4] = { r0[x], r0[x+1], r1[x+1], r1[x] };
+                double lo = std::min(std::min(v[0], v[1]), std::min(v[2], v[3]));
+                double hi = std::max(std::max(v[0], v[1]), std::max(v[2], v[3]));
+                if (hi<=0.0 || lo==hi) continue;
+                int64_t c = (int64_t)y*pW + x;
+                int64_t edge[4] = { 2*c, 2*(c+1)+1, 2*(c+pW), 2*c+1 };
+                for (int k=std::max(0, (int)ceil(lo/step)); k<nLevels && k*step<hi; k++) {
+                    double level = k*step;
+                    bool in[4];
+                    int nIn = 0;
+                    for (int i=0; i<4; i++) nIn += (in[i] = (v[i]>level));
+                    if (nIn==0 || nIn==4) continue;
+                    // a segment starts where the area is left, and ends
+                    // where it is entered, going around the cell
+                    bool saddle = (nIn==2 && in[0]==in[2]);
+                    bool centerIn = (v[0]+v[1]+v[2]+v[3])*0.25>level;
+                    for (int i=0; i<4; i++) {
+                        if (!in[i] || in[(i+1)&3]) continue;
+                        int j;
+                        if (!saddle) {
+                            for (j=1; j<4; j++)
+                                if (!in[(i+j)&3] && in[(i+j+1)&3]) break;
+                            j = (i+j)&3;
+                        } else {
+                            j = centerIn ? (i+1)&3 : (i+3)&3;
+                        }
+                        local[k].push_back( { edge[i], edge[j] } );
+                    }
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(merge);
+        for (int k=0; k<nLevels; k++)
+            segments[k].insert(segments[k].end(), local[k].begin(), local[k].end());
+    }, 16);
+
+    // levels are linked independently of each other
+    pLoops.resize(nLevels);
+    ia_parallel_for((size_t)nLevels, [&](size_t b, size_t e) {
+        for (size_t k=b; k<e; k++)
+            linkLevel(segments[k], k*step, tolerance, pLoops[k]);
+    }, 1);
+    while (!pLoops.empty() && pLoops.back().empty())
+        pLoops.pop_back();
+}
+
+
+/**
+ * Link the segments of a level into loops.
+ *
+ * Every crossing of the level with an edge starts one segment and ends
+ * another, so following the segments always leads back to the start.
+ *
+ * \param segments all segments of the level, sorted in place
+ * \param level the value of the level
+ * \param tolerance for simplifying the loops
+ * \param loops receives the loops
+ */
+void IAIsoContours::linkLevel(std::vector<Segment> &segments, double level,
+                              double tolerance, std::vector<Loop> &loops) const
+{
+    std::sort(segments.begin(), segments.end());
+    std::vector<bool> used(segments.size(), false);
+    for (size_t i=0; i<segments.size(); i++) {
+        if (used[i]) continue;
+        Loop loop;
+        size_t j = i;
+        for (;;) {
+            used[j] = true;
+            loop.push_back(crossing(segments[j].first, level));
+            auto it = std::lower_bound(segments.begin(), segments.end(),
+                                       Segment(segments[j].second, INT64_MIN));
+            if (it==segments.end() || it->first!=segments[j].second) break;
+            j = (size_t)(it-segments.begin());
+            if (used[j]) break;
+        }
+        double area = 0.0;
+        for (size_t a=0, n=loop.size(); a<n; a++) {
+            auto &p = loop[a], &q = loop[(a+1)%n];
+            area += p.first*q.second - q.first*p.second;
+        }
+        if (fabs(area)*0.5<kMinLoopArea) continue;
+        simplify(loop, tolerance);
+        loops.push_back(std::move(loop));
+    }
+}
+
+
+/**
+ * Find where a level crosses an edge.
+ *
+ * \param edge edge number
+ * \param level the value of the level
+ *
+ * \return position of the crossing
+ */
+std::pair<double, double> IAIsoContours::crossing(int64_t edge, double level) const
+{
+    int64_t c = edge>>1;
+    int x = (int)(c%pW), y = (int)(c/pW);
+    double a = pField[c];
+    if (edge&1) {
+        double b = pField[c+pW];
+        return { (double)x, y + (level-a)/(b-a) };
+    } else {
+        double b = pField[c+1];
+        return { x + (level-a)/(b-a), (double)y };
+    }
+}
+
+
+/**
+ * Remove points from a loop that hardly change its shape.
+ *
+ * This is the Ramer-Douglas-Peucker algorithm, applied to both halves of the
+ * loop between the first point and the point farthest from it.
+ *
+ * \param loop the loop, modified in place
+ * \param tolerance maximum distance of a removed point to the new loop
+ */
+void IAIsoContours::simplify(Loop &loop, double tolerance)
+{
+    size_t n = loop.size();
+    if (n<4) return;
+    auto dist2 = [](std::pair<double, double> const& p, std::pair<double, double> const& q) {
+        double dx = p.first-q.first, dy = p.second-q.second;
+        return dx*dx + dy*dy;
+    };
+    size_t far = 0;
+    for (size_t i=1; i<n; i++)
+        if (dist2(loop[i], loop[0])>dist2(loop[far], loop[0])) far = i;
+    if (far==0) return;
+
+    std::vector<bool> keep(n, false);
+    keep[0] = keep[far] = true;
+    // ranges are [a, b], and index n is point 0 again
+    std::vector<std::pair<size_t, size_t>> stack = { { 0, far }, { far, n } };
+    double t2 = tolerance*tolerance;
+    while (!stack.empty()) {
+        size_t a = stack.back().first, b = stack.back().second;
+        stack.pop_back();
+        if (b-a<2) continue;
+        auto &p = loop[a], &q = loop[b%n];
+        double dx = q.first-p.first, dy = q.second-p.second, len2 = dx*dx + dy*dy;
+        size_t best = a;
+        double bestD = t2;
+        for (size_t i=a+1; i<b; i++) {
+            double ex = loop[i].first-p.first, ey = loop[i].second-p.second;
+            double d;
+            if (len2>0.0) {
+                double c = ex*dy - ey*dx;
+                d = c*c/len2;
+            } else {
+                d = ex*ex + ey*ey;
+            }
+            if (d>bestD) { bestD = d; best = i; }
+        }
+        if (best!=a) {
+            keep[best] = true;
+            stack.push_back( { a, best } );
+            stack.push_back( { best, b } );
+        }
+    }
+    size_t m = 0;
+    for (size_t i=0; i<n; i++)
+        if (keep[i]) loop[m++] = loop[i];
+    loop.resize(m);
+}
+
+
@@ -0,0 +1,72 @@
+//
+//  IAIsoContours.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_ISO_CONTOURS_H
+#define IA_ISO_CONTOURS_H
+
+
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+
+/**
+ Closed contour lines of a field of samples at evenly spaced levels.
+
+ The samples are the corners of a grid of cells. A single pass over all
+ cells finds the contour segments of every level that crosses a cell
+ (marching squares), so the cost does not grow with the number of levels
+ beyond the length of the contours. The segments of every level are then
+ linked into loops.
+
+ The area above a level is always on the left of its loops. Sample (i, j)
+ is at position (i, j). The outermost samples must be below all levels, so
+ that all loops are closed.
+
+ \code
+ IAIsoContours c(field.data(), w, h);
+ c.extract(0.4);
+ for (int k=0; k<c.levels(); k++)
+     for (auto &loop: c.loops(k))
+         draw(loop);
+ \endcode
+ */
+class IAIsoContours
+{
+public:
+    /** A closed contour line, the last point connects to the first. */
+    typedef std::vector<std::pair<double, double>> Loop;
+
+    IAIsoContours(const double *field, int w, int h);
+    void extract(double step, double tolerance=0.25);
+
+    /** Number of levels with contours. \return level count */
+    int levels() const { return (int)pLoops.size(); }
+
+    /** Loops of a level. \param k level index, the level is at k*step
+     \return the loops */
+    std::vector<Loop> const& loops(int k) const { return pLoops[k]; }
+
+private:
+    typedef std::pair<int64_t, int64_t> Segment;
+
+    void linkLevel(std::vector<Segment> &segments, double level,
+                   double tolerance, std::vector<Loop> &loops) const;
+    std::pair<double, double> crossing(int64_t edge, double level) const;
+    static void simplify(Loop &loop, double tolerance);
+
+    /// the samples, row by row
+    const double *pField;
+    /// number of samples in a row and a column
+    int pW, pH;
+    /// closed contour lines for every level
+    std::vector<std::vector<Loop>> pLoops;
+};
+
+
+#endif /* IA_ISO_CONTOURS_H */
+
+
@@ -0,0 +1,140 @@
+//
+//  IARunLengthBitmap.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IARunLengthBitmap.h"
+
+#include <algorithm>
+
+
+/**
+ * Create an empty bitmap.
+ *
+ * \param w, h size in pixels
+ */
+IARunLengthBitmap::IARunLengthBitmap(int w, int h)
+:   pWidth( w ),
+    pHeight( h )
+{
+}
+
+
+/**
+ * Remove all runs.
+ */
+void IARunLengthBitmap::clear()
+{
+    pY0 = 0;
+    pX0 = 0; pX1 = 0;
+    pRowStart.clear();
+    pRun.clear();
+}
+
+
+/**
+ * Add a run of set pixels.
+ *
+ * Runs must be added in ascending order, row by row, and from left to right
+ * within a row. A run that touches the previous run is merged with it.
+ *
+ * \param y row
+ * \param x0 first pixel that is set
+ * \param x1 pixel after the last pixel that is set
+ */
+void IARunLengthBitmap::addRun(int y, int x0, int x1)
+{
+    if (x0>=x1) return;
+    if (pRowStart.empty()) {
+        pY0 = y;
+        pX0 = x0; pX1 = x1;
+        pRowStart.push_back(0);
+    }
+    // rows without runs get an empty range
+    while (lastRow()<=y)
+        pRowStart.push_back(pRowStart.back());
+    if (pRowStart[pRowStart.size()-2]<pRowStart.back() && pRun.back()==x0) {
+        pRun.back() = x1;
+    } else {
+        pRun.push_back(x0);
+        pRun.push_back(x1);
+        pRowStart.back() += 2;
+    }
+    pX0 = std::min(pX0, x0);
+    pX1 = std::max(pX1, x1);
+}
+
+
+/**
+ * Release memory that was reserved for more runs.
+ */
+void IARunLengthBitmap::shrink()
+{
+    pRowStart.shrink_to_fit();
+    pRun.shrink_to_fit();
+}
+
+
+/**
+ * Get the runs in a row.
+ *
+ * \param y row
+ * \param[out] n number of runs in this row
+ *
+ * \return the start and end of every run, or nullptr if the row is empty
+ */
+const int32_t *IARunLengthBitmap::row(int y, int &n) const
+{
+    n = 0;
+    if (y<firstRow() || y>=lastRow()) return nullptr;
+    uint32_t a = pRowStart[y-pY0], b = pRowStart[y-pY0+1];
+    n = (int)(b-a)/2;
+    return n ? pRun.data()+a : nullptr;
+}
+
+
+/**
+ * Get the area that contains all runs.
+ *
+ * \param[out] x0, y0 first column and row
+ * \param[out] x1, y1 column and row after the last one; all four values are 0
+ *      if the bitmap is empty
+ */
+void IARunLengthBitmap::box(int &x0, int &y0, int &x1, int &y1) const
+{
+    if (empty()) {
+        x0 = y0 = x1 = y1 = 0;
+    } else {
+        x0 = pX0; y0 = firstRow(); x1 = pX1; y1 = lastRow();
+    }
+}
+
+
+/**
+ * Count the pixels that are set.
+ *
+ * \return number of pixels
+ */
+size_t IARunLengthBitmap::countPixels() const
+{
+    size_t n = 0;
+    for (size_t i=0; i<pRun.size(); i+=2)
+        n += (size_t)(pRun[i+1]-pRun[i]);
+    return n;
+}
+
+
+/**
+ * Estimate the memory that this bitmap uses.
+ *
+ * \return size in bytes
+ */
+size_t IARunLengthBitmap::memoryUsed() const
+{
+    return sizeof(*this) + pRowStart.capacity()*sizeof(uint32_t)
+        + pRun.capacity()*sizeof(int32_t);
+}
+
+
@@ -0,0 +1,69 @@
+//
+//  IARunLengthBitmap.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_RUN_LENGTH_BITMAP_H
+#define IA_RUN_LENGTH_BITMAP_H
+
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ A compact, read-mostly copy of a bitmap that stores every row as a list of
+ runs of set pixels.
+
+ A run is a pair of x coordinates, the first pixel that is set and the pixel
+ after the last one. Runs in a row are sorted and don't touch. Only the rows
+ between the first and the last row that contain pixels are stored, so a
+ layer of a typical model needs a few kilobytes instead of megabytes.
+
+ The bitmap is filled row by row with addRun(), usually by
+ IAFramebuffer::createRunLengthBitmap(), and drawn back into a framebuffer
+ with IAFramebuffer::logicOr(IARunLengthBitmap const&).
+ */
+class IARunLengthBitmap
+{
+public:
+    IARunLengthBitmap(int w, int h);
+    void clear();
+    void addRun(int y, int x0, int x1);
+    void shrink();
+
+    /** Width in pixels. \return the width */
+    int width() const { return pWidth; }
+    /** Height in pixels. \return the height */
+    int height() const { return pHeight; }
+    /** Check for set pixels. \return true if no pixel is set */
+    bool empty() const { return pRun.empty(); }
+    /** First row that may contain runs. \return row index */
+    int firstRow() const { return pY0; }
+    /** Row after the last row that may contain runs. \return row index */
+    int lastRow() const { return pRowStart.empty() ? pY0 : pY0+(int)pRowStart.size()-1; }
+
+    const int32_t *row(int y, int &n) const;
+    void box(int &x0, int &y0, int &x1, int &y1) const;
+    size_t countPixels() const;
+    size_t memoryUsed() const;
+
+private:
+    /// width and height in pixels
+    int pWidth, pHeight;
+    /// first row that is stored
+    int pY0 = 0;
+    /// left and right border of all runs
+    int pX0 = 0, pX1 = 0;
+    /// index into pRun for every stored row, plus the end of the last row
+    std::vector<uint32_t> pRowStart;
+    /// start and end of every run, row by row
+    std::vector<int32_t> pRun;
+};
+
+
+#endif /* IA_RUN_LENGTH_BITMAP_H */
+
+
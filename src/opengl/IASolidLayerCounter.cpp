@@ -0,0 +1,201 @@
+//
+//  IASolidLayerCounter.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IASolidLayerCounter.h"
+
+#include "opengl/IAFramebuffer.h"
+#include "potrace/bitmap.h"
+#include "app/IAParallel.h"
+
+#include <algorithm>
+
+
+/**
+ * Release all full runs and counters.
+ */
+IASolidLayerCounter::~IASolidLayerCounter()
+{
+    clear();
+}
+
+
+/**
+ * Release all full runs and counters.
+ *
+ * restart() must be called before adding layers again.
+ */
+void IASolidLayerCounter::clear()
+{
+    for (auto f: pFullRun)
+        delete f;
+    pFullRun.clear();
+    pPlane.clear();
+    pN = pBits = 0;
+    pNextLayer = pFirstValid = pFirstRun = 0;
+    pWordsPerRow = pRows = 0;
+    pW0 = pY0 = pW1 = pY1 = 0;
+}
+
+
+/**
+ * Start counting at a given layer.
+ *
+ * Layers below layer 0 are empty, so counting from layer 0 or below gives
+ * exact full runs right away. Counting from a higher layer gives exact full
+ * runs from n-1 layers later on.
+ *
+ * \param firstLayer the next call to addLayer() adds this layer
+ * \param n number of layers above and below that must be solid, at least 1
+ */
+void IASolidLayerCounter::restart(int firstLayer, int n)
+{
+    clear();
+    pN = std::max(n, 1);
+    pBits = 1;
+    while ((1<<pBits)<=pN) pBits++;
+    pNextLayer = pFirstRun = firstLayer;
+    pFirstValid = (firstLayer<=0) ? firstLayer : firstLayer+pN-1;
+}
+
+
+/**
+ * Count the pixels of the next layer.
+ *
+ * Only the last n+2 full runs are kept, which is all that
+ * createInfillMask() needs while sliding up the stack.
+ *
+ * \param core the core pattern of layer nextLayer(), a BITMAP or TILED buffer
+ *      in the fine raster
+ */
+void IASolidLayerCounter::addLayer(IAFramebuffer *core)
+{
+    // the full run starts as a copy of the layer, and then loses all pixels
+    // that were not solid long enough; it can only lose pixels, so the
+    // dirty box of the copy stays valid
+    IAFramebuffer *run = new IAFramebuffer(core, IAFramebuffer::BITMAP);
+    run->bindForRendering();
+    run->unbindFromRendering();
+    potrace_bitmap_t *bm = run->pBitmap;
+    if (pPlane.empty()) {
+        pWordsPerRow = bm->dy;
+        pRows = bm->h;
+        pPlane.assign(pBits, std::vector<potrace_word>((size_t)pWordsPerRow*pRows, 0));
+    }
+
+    int x0, y0, x1, y1;
+    run->dirtyBox(x0, y0, x1, y1);
+    int w0 = x0/BM_WORDBITS, w1 = (x1+BM_WORDBITS-1)/BM_WORDBITS;
+    if (x0>=x1 || y0>=y1) w0 = w1 = y0 = y1 = 0;
+
+    // counters outside of the layer are reset, so only the area of this
+    // layer and the previous one must be visited
+    int uw0 = w0, uy0 = y0, uw1 = w1, uy1 = y1;
+    if (pW0<pW1 && pY0<pY1) {
+        if (w0<w1 && y0<y1) {
+            uw0 = std::min(w0, pW0); uy0 = std::min(y0, pY0);
+            uw1 = std::max(w1, pW1); uy1 = std::max(y1, pY1);
+        } else {
+            uw0 = pW0; uy0 = pY0; uw1 = pW1; uy1 = pY1;
+        }
+    }
+
+    int n = pN, bits = pBits;
+    std::vector<potrace_word> *plane = pPlane.data();
+    ia_parallel_for((size_t)(uy1-uy0), [&](size_t b, size_t e) {
+        for (int y=uy0+(int)b; y<uy0+(int)e; y++) {
+            bool rowInside = (y>=y0 && y<y1);
+            potrace_word *row = bm_scanline(bm, y);
+            for (int w=uw0; w<uw1; w++) {
+                bool inside = rowInside && w>=w0 && w<w1;
+                potrace_word c = inside ? row[w] : 0;
+                size_t k = (size_t)y*pWordsPerRow + w;
+                // count up where the pixel is solid and the count is below n
+                potrace_word full = BM_ALLBITS;
+                for (int i=0; i<bits; i++)
+                    full &= ((n>>i)&1) ? plane[i][k] : ~plane[i][k];
+                potrace_word carry = c & ~full;
+                for (int i=0; i<bits; i++) {
+                    potrace_word p = plane[i][k];
+                    plane[i][k] = (p ^ carry) & c;
+                    carry &= p;
+                }
+                if (inside) {
+                    full = c;
+                    for (int i=0; i<bits; i++)
+                        full &= ((n>>i)&1) ? plane[i][k] : ~plane[i][k];
+                    row[w] = full;
+                }
+            }
+        }
+    }, 256);
+    pW0 = w0; pY0 = y0; pW1 = w1; pY1 = y1;
+
+    pFullRun.push_back(run);
+    pNextLayer++;
+    while ((int)pFullRun.size()>pN+2) {
+        delete pFullRun.front();
+        pFullRun.pop_front();
+        pFirstRun++;
+    }
+}
+
+
+/**
+ * Check if the counters can slide up to a layer without a restart.
+ *
+ * \param i the layer that needs an infill mask
+ * \param n number of layers above and below that must be solid
+ *
+ * \return true if createInfillMask() will be exact after adding all layers
+ *      up to i+n, false if restart() must be called first
+ */
+bool IASolidLayerCounter::canCreateInfillMask(int i, int n) const
+{
+    if (n!=pN || pBits==0) return false;
+    if (i-1<0) return true;
+    if (i-1<pFirstRun || i-1<pFirstValid) return false;
+    // jumping far ahead is faster with a restart
+    return i+n-pNextLayer <= 2*pN+1;
+}
+
+
+/**
+ * Create the infill mask of a layer.
+ *
+ * All layers up to i+n must have been added.
+ *
+ * \param i layer index
+ * \param mask a BITMAP buffer in the fine raster; it is cleared, then all
+ *      pixels that are solid in the n layers above and below layer i are set
+ */
+void IASolidLayerCounter::createInfillMask(int i, IAFramebuffer &mask)
+{
+    mask.bindForRendering();
+    mask.fill(0);
+    mask.unbindFromRendering();
+    IAFramebuffer *below = fullRun(i-1), *above = fullRun(i+pN);
+    if (!below || !above) return;
+    mask.logicOr(below);
+    mask.logicAnd(above);
+}
+
+
+/**
+ * Find the full run of a layer.
+ *
+ * \param j layer index
+ *
+ * \return the pixels that are solid in layers j-n+1 to j, or nullptr if
+ *      j is below layer 0 or the run is not kept
+ */
+IAFramebuffer *IASolidLayerCounter::fullRun(int j) const
+{
+    if (j<0 || j<pFirstRun || j>=pNextLayer) return nullptr;
+    return pFullRun[j-pFirstRun];
+}
+
+
@@ -0,0 +1,88 @@
+//
+//  IASolidLayerCounter.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_SOLID_LAYER_COUNTER_H
+#define IA_SOLID_LAYER_COUNTER_H
+
+
+#include "potrace/potracelib.h"
+
+#include <vector>
+#include <deque>
+
+
+class IAFramebuffer;
+
+
+/**
+ Finds the pixels of a layer that are solid for a number of layers above and
+ below, sliding up the layer stack one layer at a time.
+
+ A pixel of layer i is infill if it is inside the model in all layers from
+ i-n to i+n, where n is the number of lids; everything else in the layer is
+ lid. For every pixel, a saturating counter holds the number of consecutive
+ solid layers up to the most recent layer, capped at n. The counters are
+ bit-sliced: bit b of the counters of 64 neighbouring pixels is stored in a
+ single word, so a new layer updates 64 counters with a few logic operations.
+
+ After adding layer j, the pixels whose counter reached n form the "full run"
+ of layer j: they are solid in all layers from j-n+1 to j. The infill mask of
+ layer i is then the full run of layer i-1 combined with the full run of layer
+ i+n, independent of the number of lids.
+
+ \code
+ IASolidLayerCounter c;
+ for (int i=0; i<numLayers; i++) {
+     if (!c.canCreateInfillMask(i, numLids)) c.restart(std::max(0, i-numLids), numLids);
+     while (c.nextLayer()<=i+numLids) c.addLayer(core(c.nextLayer()));
+     IAFramebuffer mask(printer, IAFramebuffer::BITMAP);
+     c.createInfillMask(i, mask);
+ }
+ \endcode
+ */
+class IASolidLayerCounter
+{
+public:
+    IASolidLayerCounter() { }
+    IASolidLayerCounter(IASolidLayerCounter const&) = delete;
+    IASolidLayerCounter &operator=(IASolidLayerCounter const&) = delete;
+    ~IASolidLayerCounter();
+    void clear();
+    void restart(int firstLayer, int n);
+    void addLayer(IAFramebuffer *core);
+    bool canCreateInfillMask(int i, int n) const;
+    void createInfillMask(int i, IAFramebuffer &mask);
+
+    /** Index of the layer that addLayer() expects next. \return layer index */
+    int nextLayer() const { return pNextLayer; }
+
+private:
+    IAFramebuffer *fullRun(int j) const;
+
+    /// number of layers above and below that must be solid
+    int pN = 0;
+    /// number of bits per counter
+    int pBits = 0;
+    /// the next layer that will be added
+    int pNextLayer = 0;
+    /// full runs are exact from this layer on
+    int pFirstValid = 0;
+    /// layer index of pFullRun.front()
+    int pFirstRun = 0;
+    /// full run of every recent layer, as BITMAP framebuffers
+    std::deque<IAFramebuffer*> pFullRun;
+    /// counter bit planes, each with one bit per pixel
+    std::vector<std::vector<potrace_word>> pPlane;
+    /// words per row and rows of the planes
+    int pWordsPerRow = 0, pRows = 0;
+    /// area in words and rows where counters may be non-zero
+    int pW0 = 0, pY0 = 0, pW1 = 0, pY1 = 0;
+};
+
+
+#endif /* IA_SOLID_LAYER_COUNTER_H */
+
+
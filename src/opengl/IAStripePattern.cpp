@@ -0,0 +1,95 @@
+//
+//  IAStripePattern.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IAStripePattern.h"
+
+#include "potrace/bitmap.h"
+
+
+/**
+ * Create a stripe pattern and its word masks.
+ *
+ * \param angle direction of the stripes
+ * \param width number of pixels that are cleared in every period
+ * \param period distance between stripes in pixels, must be at least 1
+ */
+IAStripePattern::IAStripePattern(Angle angle, int width, int period)
+:   pAngle( angle ),
+    pWidth( width ),
+    pPeriod( period<1 ? 1 : period )
+{
+    if (pAngle==kAngle0) return;
+    pMask.resize(pPeriod);
+    for (int q=0; q<pPeriod; q++) {
+        potrace_word m = 0;
+        for (int j=0, u=q; j<BM_WORDBITS; j++) {
+            if (u>=pWidth) m |= bm_mask(j);
+            if (++u==pPeriod) u = 0;
+        }
+        pMask[q] = m;
+    }
+}
+
+
+/**
+ * Find the position of a pixel across the stripes.
+ *
+ * \param x, y pixel coordinates
+ *
+ * \return position within the period, 0 to period-1
+ */
+int IAStripePattern::position(int x, int y) const
+{
+    int u = 0;
+    switch (pAngle) {
+        case kAngle0: u = y; break;
+        case kAngle45: u = x-y; break;
+        case kAngle90: u = x; break;
+        case kAngle135: u = x+y; break;
+    }
+    u %= pPeriod;
+    return (u<0) ? u+pPeriod : u;
+}
+
+
+/**
+ * Clear the pixels under the stripes in consecutive words of a row.
+ *
+ * \param dst pointer to the first word
+ * \param w index of the first word within the row
+ * \param n number of words
+ * \param y row
+ * \param xFirst pixels left of this column are not cleared
+ */
+void IAStripePattern::apply(potrace_word *dst, int w, int n, int y, int xFirst) const
+{
+    if (n<=0) return;
+    if (pAngle==kAngle0) {
+        if (position(0, y)>=pWidth) return;
+        for (int i=0; i<n; i++) {
+            int x = (w+i)*BM_WORDBITS;
+            if (x+BM_WORDBITS<=xFirst) continue;
+            dst[i] &= (x<xFirst) ? ~(BM_ALLBITS >> (xFirst-x)) : 0;
+        }
+        return;
+    }
+    int q = position(w*BM_WORDBITS, y);
+    int step = BM_WORDBITS % pPeriod;
+    for (int i=0; i<n; i++) {
+        int x = (w+i)*BM_WORDBITS;
+        potrace_word m = pMask[q];
+        if (x<xFirst) {
+            // keep everything left of xFirst
+            m = (x+BM_WORDBITS<=xFirst) ? BM_ALLBITS : m | ~(BM_ALLBITS >> (xFirst-x));
+        }
+        dst[i] &= m;
+        q += step;
+        if (q>=pPeriod) q -= pPeriod;
+    }
+}
+
+
@@ -0,0 +1,70 @@
+//
+//  IAStripePattern.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_STRIPE_PATTERN_H
+#define IA_STRIPE_PATTERN_H
+
+
+#include "potrace/potracelib.h"
+
+#include <vector>
+
+
+/**
+ A pattern of parallel stripes that clears pixels in a bitmap, one word at a
+ time.
+
+ A pixel is cleared if its position across the stripes, modulo the period,
+ is less than the stripe width. For all angles except 0 deg, this position
+ grows by one from pixel to pixel within a row, so the masks for all 64
+ pixels of a word can be looked up in a single table with one entry per
+ position in the period.
+
+ \code
+ IAStripePattern p(IAStripePattern::kAngle45, 10, 20);
+ p.apply(bm_scanline(bm, y)+w0, w0, w1-w0, y);
+ \endcode
+ */
+class IAStripePattern
+{
+public:
+    /** Direction of the stripes */
+    typedef enum {
+        /// horizontal stripes, alternating along y
+        kAngle0,
+        /// stripes rising to the right
+        kAngle45,
+        /// vertical stripes, alternating along x
+        kAngle90,
+        /// stripes falling to the right
+        kAngle135
+    } Angle;
+
+    IAStripePattern(Angle angle, int width, int period);
+
+    void apply(potrace_word *dst, int w, int n, int y, int xFirst=0) const;
+
+    /** Stripe period in pixels. \return the period */
+    int period() const { return pPeriod; }
+
+private:
+    int position(int x, int y) const;
+
+    /// direction of the stripes
+    Angle pAngle;
+    /// width of the cleared part of a stripe in pixels
+    int pWidth;
+    /// distance from one stripe to the next in pixels
+    int pPeriod;
+    /// for every position within the period, the bits to keep in a word
+    /// that starts at this position
+    std::vector<potrace_word> pMask;
+};
+
+
+#endif /* IA_STRIPE_PATTERN_H */
+
+
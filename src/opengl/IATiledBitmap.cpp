@@ -0,0 +1,241 @@
+//
+//  IATiledBitmap.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATiledBitmap.h"
+
+#include "potrace/bitmap.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+
+const int IATiledBitmap::kTileWords;
+const int IATiledBitmap::kTileRows;
+const int IATiledBitmap::kTileSize;
+
+
+/**
+ * Create an empty bitmap.
+ *
+ * No tiles are allocated until pixels are set.
+ *
+ * \param w, h size in pixels
+ */
+IATiledBitmap::IATiledBitmap(int w, int h)
+:   pWidth( w ),
+    pHeight( h )
+{
+    int wordsPerRow = (w+BM_WORDBITS-1)/BM_WORDBITS;
+    pColumns = (wordsPerRow+kTileWords-1)/kTileWords;
+    pRows = (h+kTileRows-1)/kTileRows;
+    pTile.resize((size_t)pColumns*pRows, nullptr);
+}
+
+
+/**
+ * Create a copy of another bitmap, including its contents.
+ *
+ * \param src copy size and tiles from here
+ */
+IATiledBitmap::IATiledBitmap(IATiledBitmap const& src)
+:   pWidth( src.pWidth ),
+    pHeight( src.pHeight ),
+    pColumns( src.pColumns ),
+    pRows( src.pRows )
+{
+    pTile.resize(src.pTile.size(), nullptr);
+    for (size_t i=0; i<pTile.size(); i++) {
+        if (src.pTile[i]) {
+            pTile[i] = (potrace_word*)malloc(kTileSize*BM_WORDSIZE);
+            memcpy(pTile[i], src.pTile[i], kTileSize*BM_WORDSIZE);
+        }
+    }
+}
+
+
+/**
+ * Release all tiles.
+ */
+IATiledBitmap::~IATiledBitmap()
+{
+    clear();
+}
+
+
+/**
+ * Clear all pixels by releasing all tiles.
+ */
+void IATiledBitmap::clear()
+{
+    for (auto &t: pTile) {
+        free(t);
+        t = nullptr;
+    }
+}
+
+
+/**
+ * Set or clear all pixels.
+ *
+ * Bits in the last column and row of tiles that are outside of the bitmap
+ * stay clear.
+ *
+ * \param color 0 releases all tiles, 1 allocates every tile and sets all pixels
+ */
+void IATiledBitmap::fill(int color)
+{
+    clear();
+    if (color) {
+        for (int y=0; y<pHeight; y++)
+            hline(0, pWidth, y, 1);
+    }
+}
+
+
+/**
+ * Get a tile and allocate it if needed.
+ *
+ * Different threads may acquire different tiles at the same time.
+ *
+ * \param tx, ty tile column and row
+ *
+ * \return the words of the tile; a new tile is all zeros
+ */
+potrace_word *IATiledBitmap::acquireTile(int tx, int ty)
+{
+    potrace_word *&t = pTile[(size_t)ty*pColumns+tx];
+    if (!t)
+        t = (potrace_word*)calloc(kTileSize, BM_WORDSIZE);
+    return t;
+}
+
+
+/**
+ * Clear all pixels in a tile by releasing it.
+ *
+ * \param tx, ty tile column and row
+ */
+void IATiledBitmap::releaseTile(int tx, int ty)
+{
+    potrace_word *&t = pTile[(size_t)ty*pColumns+tx];
+    free(t);
+    t = nullptr;
+}
+
+
+/**
+ * Find a single word in the bitmap.
+ *
+ * The following words in the same row are stored right after this word, up
+ * to the end of the tile.
+ *
+ * \param w word index within the row
+ * \param y row
+ * \param create allocate the tile if it does not exist yet
+ *
+ * \return a pointer to the word, or nullptr if the word is in a tile that
+ *      does not exist
+ */
+potrace_word *IATiledBitmap::word(int w, int y, bool create)
+{
+    int tx = w/kTileWords, ty = y/kTileRows;
+    potrace_word *t = create ? acquireTile(tx, ty) : tile(tx, ty);
+    if (!t) return nullptr;
+    return t + (y%kTileRows)*kTileWords + (w%kTileWords);
+}
+
+
+/**
+ * Get a pixel.
+ *
+ * \param x, y pixel position, must be inside the bitmap
+ *
+ * \return true if the pixel is set
+ */
+bool IATiledBitmap::get(int x, int y) const
+{
+    int w = x/BM_WORDBITS;
+    potrace_word *t = tile(w/kTileWords, y/kTileRows);
+    if (!t) return false;
+    return (t[(y%kTileRows)*kTileWords + (w%kTileWords)] & bm_mask(x)) != 0;
+}
+
+
+/**
+ * Set or clear a pixel.
+ *
+ * Clearing a pixel never allocates a tile.
+ *
+ * \param x, y pixel position, must be inside the bitmap
+ * \param color 0 or 1
+ */
+void IATiledBitmap::put(int x, int y, int color)
+{
+    potrace_word *p = word(x/BM_WORDBITS, y, color!=0);
+    if (!p) return;
+    if (color) *p |= bm_mask(x); else *p &= ~bm_mask(x);
+}
+
+
+/**
+ * Set or clear a horizontal line of pixels.
+ *
+ * \param x1 first pixel, clipped to the bitmap
+ * \param x2 pixel after the last pixel, clipped to the bitmap
+ * \param y row, must be inside the bitmap
+ * \param color 0 or 1
+ */
+void IATiledBitmap::hline(int x1, int x2, int y, int color)
+{
+    if (x1<0) x1 = 0;
+    if (x2>pWidth) x2 = pWidth;
+    if (x1>=x2) return;
+    int w1 = x1/BM_WORDBITS, w2 = (x2-1)/BM_WORDBITS;
+    for (int w=w1; w<=w2; ) {
+        // all words up to the end of this tile are next to each other
+        int wEnd = std::min(w2+1, (w/kTileWords+1)*kTileWords);
+        potrace_word *p = word(w, y, color!=0);
+        if (p) {
+            for ( ; w<wEnd; w++, p++) {
+                potrace_word m = BM_ALLBITS;
+                if (w==w1) m &= BM_ALLBITS >> (x1 & (BM_WORDBITS-1));
+                if (w==w2) m &= BM_ALLBITS << (BM_WORDBITS-1 - ((x2-1) & (BM_WORDBITS-1)));
+                if (color) *p |= m; else *p &= ~m;
+            }
+        }
+        w = wEnd;
+    }
+}
+
+
+/**
+ * Count the tiles that are allocated.
+ *
+ * \return number of tiles
+ */
+size_t IATiledBitmap::numTiles() const
+{
+    size_t n = 0;
+    for (auto t: pTile)
+        if (t) n++;
+    return n;
+}
+
+
+/**
+ * Estimate the memory that this bitmap uses.
+ *
+ * \return size in bytes
+ */
+size_t IATiledBitmap::memoryUsed() const
+{
+    return sizeof(*this) + pTile.size()*sizeof(potrace_word*)
+        + numTiles()*kTileSize*BM_WORDSIZE;
+}
+
+
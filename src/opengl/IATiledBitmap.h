@@ -0,0 +1,82 @@
+//
+//  IATiledBitmap.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_TILED_BITMAP_H
+#define IA_TILED_BITMAP_H
+
+
+#include "potrace/potracelib.h"
+
+#include <vector>
+#include <stddef.h>
+
+
+/**
+ A sparse bitmap that is split into tiles of equal size.
+
+ Tiles are allocated when a pixel in them is set for the first time. A tile
+ that was never allocated is known to be all zeros, so a model that covers
+ only a small part of the printbed needs only a few tiles.
+
+ Every tile stores kTileRows rows of kTileWords words, using the same bit
+ order as potrace bitmaps. Bits that are outside of the bitmap are always
+ clear.
+ */
+class IATiledBitmap
+{
+public:
+    /// width of a tile in words
+    static const int kTileWords = 4;
+    /// height of a tile in rows
+    static const int kTileRows = 256;
+    /// number of words in a tile
+    static const int kTileSize = kTileWords*kTileRows;
+
+    IATiledBitmap(int w, int h);
+    IATiledBitmap(IATiledBitmap const&);
+    ~IATiledBitmap();
+    IATiledBitmap &operator=(IATiledBitmap const&) = delete;
+
+    void clear();
+    void fill(int color);
+
+    /** Width in pixels. \return the width */
+    int width() const { return pWidth; }
+    /** Height in pixels. \return the height */
+    int height() const { return pHeight; }
+    /** Number of tiles across. \return number of columns */
+    int columns() const { return pColumns; }
+    /** Number of tiles down. \return number of rows */
+    int rows() const { return pRows; }
+
+    /** Get a tile, if it was allocated.
+     \param tx, ty tile column and row
+     \return the words of the tile, or nullptr if the tile is all zeros */
+    potrace_word *tile(int tx, int ty) const { return pTile[(size_t)ty*pColumns+tx]; }
+    potrace_word *acquireTile(int tx, int ty);
+    void releaseTile(int tx, int ty);
+
+    potrace_word *word(int w, int y, bool create);
+    bool get(int x, int y) const;
+    void put(int x, int y, int color);
+    void hline(int x1, int x2, int y, int color);
+
+    size_t numTiles() const;
+    size_t memoryUsed() const;
+
+private:
+    /// width and height in pixels
+    int pWidth, pHeight;
+    /// number of tiles across and down
+    int pColumns, pRows;
+    /// all tiles, row by row; nullptr for tiles that are all zeros
+    std::vector<potrace_word*> pTile;
+};
+
+
+#endif /* IA_TILED_BITMAP_H */
+
+
@@ -96,6 +96,7 @@ int potrace(IAFramebuffer *framebuffer, IAToolpathList *toolpath, double z)
     double yScl = printbed.y()/height;
 
     int x, y, i;
+    int ox = 0, oy = 0;
     potrace_bitmap_t *bm;
     potrace_param_t *param;
     potrace_path_t *p;
@@ -104,8 +105,11 @@ int potrace(IAFramebuffer *framebuffer, IAToolpathList *toolpath, double z)
     potrace_dpoint_t (*c)[3];
 
     /* create a bitmap */
-    if (framebuffer->pBitmap) {
-        bm = bm_dup(framebuffer->pBitmap);
+    if (framebuffer->isBitmap()) {
+        // only trace the area that may contain set pixels
+        bm = framebuffer->createTraceBitmap(ox, oy);
+        if (!bm)
+            return 0;
     } else {
         const uint8_t *px = framebuffer->getRawImageRGB();
         bm = bm_new(width, height);
@@ -164,6 +168,42 @@ int potrace(IAFramebuffer *framebuffer, IAToolpathList *toolpath, double z)
     }
     bm_free(bm);
 
+    /* move the curves from the clipped bitmap back into the framebuffer */
+    if (ox || oy) {
+        for (p = st->plist; p; p = p->next) {
+            for (i=0; i<p->curve.n; i++) {
+                for (int k=0; k<3; k++) {
+                    p->curve.c[i][k].x += ox;
+                    p->curve.c[i][k].y += oy;
+                }
+            }
+        }
+    }
+
+    /* move the points on the curves onto the exact edge; control points
+       follow the end point of the curve that they belong to */
+    if (framebuffer->hasEdgeCoverage()) {
+        for (p = st->plist; p; p = p->next) {
+            n = p->curve.n;
+            tag = p->curve.tag;
+            c = p->curve.c;
+            for (i=0; i<n; i++) {
+                int k = (i+1<n) ? i+1 : 0;
+                double ex = c[i][2].x, ey = c[i][2].y;
+                framebuffer->refineEdgePoint(c[i][2].x, c[i][2].y);
+                double dx = c[i][2].x-ex, dy = c[i][2].y-ey;
+                if (tag[i]==POTRACE_CURVETO) {
+                    c[i][1].x += dx; c[i][1].y += dy;
+                } else {
+                    framebuffer->refineEdgePoint(c[i][1].x, c[i][1].y);
+                }
+                if (tag[k]==POTRACE_CURVETO) {
+                    c[k][0].x += dx; c[k][0].y += dy;
+                }
+            }
+        }
+    }
+
     IAToolpathLoop *toolpathLoop = nullptr;
     /* draw each curve */
     p = st->plist;
@@ -228,14 +228,26 @@ static inline int bm_resize(potrace_bitmap_t *bm, int h) {
 
 static inline void bm_hline(potrace_bitmap_t *bm, int x1, int x2, int y, int color)
 {
-    /** \bug this can be optimized a lot! */
-    if (x1>=x2) return;
     if (x1<0) x1 = 0;
     if (x2>bm->w) x2 = bm->w;
-    if (color)
-        for (int x=x1; x<x2; x++) BM_USET(bm, x, y);
-    else
-        for (int x=x1; x<x2; x++) BM_UCLR(bm, x, y);
+    if (x1>=x2) return;
+    /* set or clear whole words at a time, masking only the first and last word */
+    potrace_word *p = bm_scanline(bm, y);
+    int w1 = x1/BM_WORDBITS, w2 = (x2-1)/BM_WORDBITS;
+    potrace_word m1 = BM_ALLBITS >> (x1 & (BM_WORDBITS-1));
+    potrace_word m2 = BM_ALLBITS << (BM_WORDBITS-1 - ((x2-1) & (BM_WORDBITS-1)));
+    if (w1==w2) {
+        m1 &= m2;
+        if (color) p[w1] |= m1; else p[w1] &= ~m1;
+    } else if (color) {
+        p[w1] |= m1;
+        for (int w=w1+1; w<w2; w++) p[w] = BM_ALLBITS;
+        p[w2] |= m2;
+    } else {
+        p[w1] &= ~m1;
+        for (int w=w1+1; w<w2; w++) p[w] = 0;
+        p[w2] &= ~m2;
+    }
 }
 
 
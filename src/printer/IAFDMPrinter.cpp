@@ -12,6 +12,10 @@
 #include "view/IAProgressDialog.h"
 #include "toolpath/IAToolpath.h"
 #include "opengl/IAFramebuffer.h"
+#include "opengl/IAFramebufferPool.h"
+#include "opengl/IARunLengthBitmap.h"
+#include "geometry/IAMeshSweep.h"
+#include "geometry/IASupportMap.h"
 
 
 #include <FL/Fl_Native_File_Chooser.H>
@@ -198,7 +202,8 @@ IAFDMPrinter::IAFDMPrinter(IAFDMPrinter const& src)
 
 IAFDMPrinter::~IAFDMPrinter()
 {
-    // nothing to delete
+    delete pSupportMap;
+    delete pFootprint;
 }
 
 
@@ -259,12 +264,12 @@ void IAFDMPrinter::createPropertiesControls()
     s = new IAVectorController("specs/printVolumeMin", "Printable Area, minimum:", "", printVolumeMin,
                                "From X:", "mm",
                                "Y:", "mm",
-                               nullptr, nullptr, []{} );
+                               nullptr, nullptr, [this]{purgeSlicesAndCaches();} );
     pPropertiesControllerList.push_back(s);
     s = new IAVectorController("specs/printVolumeMax", "maximum:", "", printVolumeMax,
                                "To X:", "mm (Width)",
                                "Y:", "mm (Depth)",
-                               nullptr, nullptr, []{} );
+                               nullptr, nullptr, [this]{purgeSlicesAndCaches();} );
     pPropertiesControllerList.push_back(s);
     // travel speed, print speed, build plate fan, build plate heater, chamber heater
     static Fl_Menu_Item numExtruderMenu[] = {
@@ -274,6 +279,21 @@ void IAFDMPrinter::createPropertiesControls()
     s = new IAChoiceController("specs/extruder", "Extruders:", numExtruders,
                                []{}, numExtruderMenu );
     pPropertiesControllerList.push_back(s);
+    s = new IAFloatController("specs/rasterPixelSize", "Raster Pixel Size:", rasterPixelSize,
+                              "mm", [this]{purgeSlicesAndCaches();} );
+    s->tooltip("Size of a pixel when slicing layers. Set this to 0 to use one "
+               "eighth of the nozzle diameter.");
+    pPropertiesControllerList.push_back(s);
+    static Fl_Menu_Item coarseRasterMenu[] = {
+        { "off", 0, nullptr, (void*)0, 0, 0, 0, 11 },
+        { "2x", 0, nullptr, (void*)1, 0, 0, 0, 11 },
+        { "4x", 0, nullptr, (void*)2, 0, 0, 0, 11 },
+        { nullptr } };
+    s = new IAChoiceController("specs/rasterPixelSize/coarse", "Coarse Infill Raster:", coarseRasterLevel,
+                               [this]{purgeSlicesAndCaches();}, coarseRasterMenu );
+    s->tooltip("Shells and lids are always sliced at full resolution. Infill and "
+               "support can use larger pixels to save time and memory.");
+    pPropertiesControllerList.push_back(s);
 #if 0
     s = new IALabelController("specs/extruder/0", "Extruder 0:");
     pPropertiesControllerList.push_back(s);
@@ -540,19 +560,51 @@ void IAFDMPrinter::userSliceGenerateAll()
 
 
 /**
- * Create and add the toolpath for a skirt around the omesh base.
+ * Get the area that the mesh covers on the print bed.
+ *
+ * The footprint is drawn once per mesh placement and kept run-length encoded
+ * until the slices are purged.
+ *
+ * \return the footprint in the fine raster, or nullptr if there is no mesh
+ */
+IARunLengthBitmap *IAFDMPrinter::acquireFootprint()
+{
+    IAMesh *mesh = Iota.pMesh;
+    if (pFootprint) {
+        int w, h;
+        rasterSize(w, h);
+        if (!mesh || pFootprint->width()!=w || pFootprint->height()!=h
+            || mesh->position()!=pFootprintPosition)
+        {
+            delete pFootprint;
+            pFootprint = nullptr;
+        }
+    }
+    if (!pFootprint && mesh) {
+        IAFramebuffer fb(this, IAFramebuffer::BITMAP);
+        fb.drawFootprint(mesh);
+        pFootprint = fb.createRunLengthBitmap();
+        pFootprint->shrink();
+        pFootprintPosition = mesh->position();
+    }
+    return pFootprint;
+}
+
+
+/**
+ * Create and add the toolpath for a skirt around the mesh base.
+ *
+ * The skirt follows the footprint of the entire mesh, not just the first
+ * layer, so that it also clears overhangs.
  */
 void IAFDMPrinter::addToolpathForSkirt(IAToolpathList *tp, int i)
 {
     double z = sliceIndexToZ(i);
-    IAFramebuffer skirt(this, IAFramebuffer::RGBA);
-    skirt.bindForRendering();
-    glPushMatrix();
-    glTranslated(Iota.pMesh->position().x(), Iota.pMesh->position().y(), Iota.pMesh->position().z());
-    Iota.pMesh->draw(IAMesh::kMASK, 1.0, 1.0, 1.0);
-    glPopMatrix();
-    skirt.unbindFromRendering();
-    skirt.toolpathFromLassoAndExpand(z, 3);  // 3mm, should probably be more if the extrusion is 1mm or more
+    IARunLengthBitmap *footprint = acquireFootprint();
+    if (!footprint || footprint->empty()) return;
+    IAFramebuffer skirt(this, IAFramebuffer::BITMAP);
+    skirt.logicOr(*footprint);
+    skirt.expand(3);  // 3mm, should probably be more if the extrusion is 1mm or more
     IAToolpathListSP tpSkirt1 = skirt.toolpathFromLassoAndContract(z, nozzleDiameter());
     tp->add(tpSkirt1.get(), modelExtruder(), 5, 0);
     IAToolpathListSP tpSkirt2 = skirt.toolpathFromLassoAndContract(z, nozzleDiameter());
@@ -562,48 +614,30 @@ void IAFDMPrinter::addToolpathForSkirt(IAToolpathList *tp, int i)
 
 /**
  * Create and add the toolpath for a support structure under overhangs.
+ *
+ * The overhangs of the mesh are found once and kept in a support map, so
+ * every layer only needs to pick the areas of the map that reach through it.
  */
 void IAFDMPrinter::addToolpathForSupport(IAToolpathList *tp, int i)
 {
     double z = sliceIndexToZ(i);
-    IAFramebuffer support(this, IAFramebuffer::RGBAZ);
-
-    support.bindForRendering();
-
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_GREATER);
-
-    glClearDepth(0.0);
-    glClear(GL_DEPTH_BUFFER_BIT);
-
-    // Draw only what is above the current z plane, but leave a little
-    // space between the model and the support to reduce stickyness
-    support.beginClipBelowZ(z + supportTopGap()*layerHeight());
-
-    /** \bug don't do this for every layer! */
-    // mark all triangles that need support first, then render only those
-    // mark all vertices that need support, then render them here
-    Iota.pMesh->drawAngledFaces(90.0+supportAngle());
 
-    glPushMatrix();
-    // Draw the upper part of the model, so that the support will not
-    // protrude through it. Leave a little gap so that the support
-    // Also, remember if we need support at all.
-    // sticks less to the model.
-    glTranslated(Iota.pMesh->position().x(),
-                 Iota.pMesh->position().y(),
-                 Iota.pMesh->position().z()
-                 + (supportBottomGap()+supportTopGap())*layerHeight());
-    Iota.pMesh->draw(IAMesh::kMASK, 0.0, 0.0, 0.0);
-    glPopMatrix();
-
-    support.endClip();
-
-    glDepthFunc(GL_LESS);
-    glClearDepth(1.0);
-
-    support.unbindFromRendering();
-    /** \bug change to bitmap mode */
+    // icicles get a pillar of twice the nozzle width after the mask shrinks
+    double icicleRadius = 1.5*nozzleDiameter() + supportSideGap();
+    if (!pSupportMap)
+        pSupportMap = new IASupportMap(this, IAFramebuffer::COARSE);
+    if (!pSupportMap->isBuiltFor(Iota.pMesh, supportAngle(), icicleRadius))
+        pSupportMap->build(Iota.pMesh, supportAngle(), icicleRadius);
+
+    // leave a little space between the model and the support to reduce
+    // stickyness
+    IARunLengthBitmap *mask = pSupportMap->createLayerMask(
+                                    z - supportBottomGap()*layerHeight(),
+                                    z + supportTopGap()*layerHeight());
+    if (!mask) return;
+    IAFramebuffer support(this, IAFramebuffer::BITMAP, IAFramebuffer::COARSE);
+    support.logicOr(*mask);
+    delete mask;
 
     // reduce the size of the mask to leave room for the filament, plus
     // a little gap so that the support tower sides do not stick to
@@ -611,17 +645,15 @@ void IAFDMPrinter::addToolpathForSupport(IAToolpathList *tp, int i)
     support.toolpathFromLassoAndContract(z, nozzleDiameter()/2.0 + supportSideGap());
 
     // Fill it.
+    IAToolpathListSP supportPath;
     if (i==0) {
         // layer 0 must be filled 100% to give good adhesion
-        support.overlayInfillPattern(0, nozzleDiameter());
+        supportPath = support.toolpathFromStripes(z, 0, nozzleDiameter());
     } else {
         // other layers use the set density
-        support.overlayInfillPattern(0, 2*nozzleDiameter() * (100.0 / supportDensity()) - nozzleDiameter());
+        supportPath = support.toolpathFromStripes(z, 0, 2*nozzleDiameter() * (100.0 / supportDensity()) - nozzleDiameter());
     }
-    auto supportPath = support.toolpathFromLasso(z);
     if (supportPath) tp->add(supportPath.get(), supportExtruder(), 60, 0);
-    /// \todo don't draw anything here which we will draw otherwise later
-    /** \bug find icicles and draw support for those */
     /** \bug find and exclude bridges */
 }
 
@@ -658,7 +690,6 @@ void IAFDMPrinter::createToolpathForShell(int i, IAFramebuffer *fb)
     if (tp1) tp->add(tp1.get(), modelExtruder(), 40, 2);
     if (pSliceList[i].pShellToolpath) delete pSliceList[i].pShellToolpath;
     pSliceList[i].pShellToolpath = tp;
-    pSliceList[i].pCoreBitmap = fb;
 }
 
 
@@ -667,21 +698,13 @@ void IAFDMPrinter::addToolpathForLid(IAToolpathList *tp, int i, IAFramebuffer &l
     double z = sliceIndexToZ(i);
     if (lidType()==0) {
         // ZIGZAG (could do bridging if used in the correct direction!)
-        lid.overlayInfillPattern(i, nozzleDiameter());
-        auto lidPath = lid.toolpathFromLasso(z);
+        auto lidPath = lid.toolpathFromStripes(z, i, nozzleDiameter());
         if (lidPath) tp->add(lidPath.get(), modelExtruder(), 20, 0);
     } else {
         // CONCENTRIC (nicer for lids)
-        /** \bug limit this to the width and hight of the build platform divided by the extrusion width */
-        int k;
-        for (k=0;k<300;k++) { /** \bug why 300? */
-            auto tp1 = lid.toolpathFromLassoAndContract(z, nozzleDiameter());
-            if (!tp1) break;
-            tp->add(tp1.get(), modelExtruder(), 20, k);
-        }
-        if (k==300) {
-            // assert(0);
-        }
+        auto rings = lid.toolpathFromConcentricRings(z, nozzleDiameter());
+        for (size_t k=0; k<rings.size(); k++)
+            tp->add(rings[k].get(), modelExtruder(), 20, (int)k);
     }
 }
 
@@ -691,29 +714,88 @@ void IAFDMPrinter::addToolpathForInfill(IAToolpathList *tp, int i, IAFramebuffer
     double z = sliceIndexToZ(i);
     /** \todo We are actually filling the areas twice, where the lids and the infill touch! */
     /** \todo remove material that we generated in the lid already */
-    infill.overlayInfillPattern(i, 2*nozzleDiameter() * (100.0 / infillDensity()) - nozzleDiameter());
-    auto infillPath = infill.toolpathFromLasso(z);
+    auto infillPath = infill.toolpathFromStripes(z, i, 2*nozzleDiameter() * (100.0 / infillDensity()) - nozzleDiameter());
     if (infillPath) tp->add(infillPath.get(), modelExtruder(), 30, 0); /** \bug should be ExtruderDontCare */
 }
 
 
+/**
+ * Derive the raster pixel size from the nozzle.
+ *
+ * Eight pixels per nozzle width keep shells smooth. For the default 0.4mm
+ * nozzle, this is the original resolution of 0.05mm.
+ *
+ * \return pixel size in mm
+ */
+double IAFDMPrinter::autoRasterPixelSize()
+{
+    double d = nozzleDiameter();
+    return (d>0.0) ? d/8.0 : super::autoRasterPixelSize();
+}
+
+
 double IAFDMPrinter::sliceIndexToZ(int i)
 {
     return i * layerHeight() + 0.5 /* + first layer offset */;
 }
 
 
-void IAFDMPrinter::acquireCorePattern(int i)
+/**
+ * Create the bitmap and shell toolpath for a layer, unless they exist already.
+ *
+ * Core patterns that were run-length encoded by the cache are expanded here.
+ *
+ * \param i layer index
+ * \param sweep if set, the rim is taken from this sweep instead of slicing
+ *      the mesh from scratch
+ *
+ * \return the core pattern; it stays valid until the next call that accesses
+ *      core patterns
+ */
+IAFramebuffer *IAFDMPrinter::acquireCorePattern(int i, IAMeshSweep *sweep)
 {
-    if (!pSliceList[i].pCoreBitmap) {
+    IAFramebuffer *core = pSliceList.findCorePattern(i);
+    if (!core) {
         IAFramebuffer *sliceMap = new IAFramebuffer(this, IAFramebuffer::BITMAP);
         IAMeshSlice *slc = new IAMeshSlice( this );
-        slc->setNewZ(sliceIndexToZ(i));
-        slc->generateRim(Iota.pMesh);
+        if (sweep) {
+            sweep->slice(sliceIndexToZ(i), slc);
+        } else {
+            Iota.pMesh->updateGlobalSpace();
+            slc->setNewZ(sliceIndexToZ(i));
+            slc->generateRim(Iota.pMesh);
+        }
         slc->tesselateAndDrawLid(sliceMap);
         createToolpathForShell(i, sliceMap);
         delete slc;
+        // keep only the tiles that the core touches
+        core = new IAFramebuffer(sliceMap, IAFramebuffer::TILED);
+        delete sliceMap;
+        pSliceList.storeCorePattern(i, core);
     }
+    return core;
+}
+
+
+/**
+ * Find the pixels of a layer that are solid for numLids() layers above and
+ * below.
+ *
+ * Slicing up the layer stack adds one core pattern per layer to the solid
+ * layer counter, no matter how many lids are printed. Jumping to a different
+ * layer restarts the counter a few layers below.
+ *
+ * \param i layer index
+ * \param mask a bitmap buffer, receives the infill area of the layer
+ */
+void IAFDMPrinter::createInfillMask(int i, IAFramebuffer &mask)
+{
+    int n = numLids();
+    if (!pSolidLayers.canCreateInfillMask(i, n))
+        pSolidLayers.restart(std::max(0, i-n), n);
+    while (pSolidLayers.nextLayer()<=i+n)
+        pSolidLayers.addLayer(acquireCorePattern(pSolidLayers.nextLayer()));
+    pSolidLayers.createInfillMask(i, mask);
 }
 
 
@@ -724,6 +806,7 @@ void IAFDMPrinter::sliceLayer(int i)
     double z = sliceIndexToZ(i);
     IAFDMSlice &s = pSliceList[i];
 
+    pSliceList.setCoreMemoryBudget((size_t)Iota.gPreferences.pCoreCacheSize<<20);
     acquireCorePattern(i);
 
     // skirt around the entire model
@@ -739,35 +822,14 @@ void IAFDMPrinter::sliceLayer(int i)
     }
 
     if ((!s.pInfillToolpath) || (!s.pLidToolpath)) {
-        IAFramebuffer infill(pSliceList[i].pCoreBitmap);
+        IAFramebuffer infill(acquireCorePattern(i), IAFramebuffer::BITMAP);
 
         // build lids and bottoms
         if (numLids()>0) {
-            acquireCorePattern(i+1);
-            IAFramebuffer mask(pSliceList[i+1].pCoreBitmap);
-            if (numLids()>1) {
-                acquireCorePattern(i+2);
-                if (pSliceList[i+2].pCoreBitmap)
-                    mask.logicAnd(pSliceList[i+2].pCoreBitmap);
-                else
-                    mask.fill(0);
-            }
-            if (i>0) {
-                acquireCorePattern(i-1);
-                mask.logicAnd(pSliceList[i-1].pCoreBitmap);
-            } else {
-                mask.fill(0);
-            }
-            if (numLids()>1) {
-                if (i>1) {
-                    acquireCorePattern(i-2);
-                    mask.logicAnd(pSliceList[i-2].pCoreBitmap);
-                } else {
-                    mask.fill(0);
-                }
-            }
+            IAFramebuffer mask(this, IAFramebuffer::BITMAP);
+            createInfillMask(i, mask);
 
-            IAFramebuffer lid(pSliceList[i].pCoreBitmap);
+            IAFramebuffer lid(&infill);
             lid.logicAndNot(&mask); /// \todo shrink lid
             infill.logicAnd(&mask); /// \todo shrink infill
             if (!s.pLidToolpath) {
@@ -776,10 +838,15 @@ void IAFDMPrinter::sliceLayer(int i)
             }
         }
 
-        // build infills
+        // build infills, on the coarse raster if the printer has one
         if (infillDensity()>0.0001 && !s.pInfillToolpath) {
             IAToolpathList *tp = pSliceList[i].pInfillToolpath = new IAToolpathList(z);
-            addToolpathForInfill(tp, i, infill);
+            if (coarseRasterLevel()>0) {
+                IAFramebuffer coarse(&infill, IAFramebuffer::BITMAP, IAFramebuffer::COARSE);
+                addToolpathForInfill(tp, i, coarse);
+            } else {
+                addToolpathForInfill(tp, i, infill);
+            }
         }
     }
 }
@@ -798,17 +865,28 @@ void IAFDMPrinter::sliceAll()
 
     IAProgressDialog::show("Generating slices",
                            "Slicing layer %d of %d at %.2fmm (%d%%)");
+    pSliceList.setCoreMemoryBudget((size_t)Iota.gPreferences.pCoreCacheSize<<20);
 
     int i = 0, n = (int)((zMax-zMin)/zLayerHeight) + 2;
 
+    // sliceLayer() needs the core patterns up to numLids() layers above;
+    // create them in ascending order, so that a single sweep can cut all of them
+    IAMeshSweep sweep(Iota.pMesh);
+    int nCore = 0;
     for (i=0; i<n; ++i)
     {
         double z = sliceIndexToZ(i);
         if (IAProgressDialog::update(i*100/n, i, n, z, i*100/n)) break;
+        for ( ; nCore<=i+numLids(); ++nCore)
+            acquireCorePattern(nCore, &sweep);
         sliceLayer(i);
     }
 
     IAProgressDialog::hide();
+    if (Iota.gPreferences.pLogSliceStats) {
+        pSliceList.printCacheStats();
+        IAFramebufferPool::shared().printStats();
+    }
     if (zRangeSlider->lowValue()>n-1) {
         int nn = n-2; if (nn<0) nn = 0;
         double d = zRangeSlider->highValue()-zRangeSlider->lowValue();
@@ -861,6 +939,9 @@ void IAFDMPrinter::rangeSliderChanged()
 void IAFDMPrinter::purgeSlicesAndCaches()
 {
     pSliceList.purge();
+    delete pSupportMap; pSupportMap = nullptr;
+    delete pFootprint; pFootprint = nullptr;
+    pSolidLayers.clear();
     super::purgeSlicesAndCaches();
     sliceLayer(zRangeSlider->highValue()); /** \bug very direct access through a view */
     gSceneView->redraw();
@@ -902,11 +983,146 @@ void IAFDMPrinter::writeProperties(Fl_Preferences &printer)
 
 
 
+/**
+ * Release all slices, toolpaths, and core patterns.
+ */
 void IAFDMSliceList::purge()
 {
     for (auto &s: pList) {
         s.second.purge();
     }
+    pLRU.clear();
+    pMemoryUsed = 0;
+    pStats = CacheStats();
+}
+
+
+/**
+ * Find the core pattern of a layer.
+ *
+ * A run-length encoded pattern is expanded into a TILED framebuffer again.
+ *
+ * \param i layer index
+ *
+ * \return the pattern, or nullptr if it must be created and stored with
+ *      storeCorePattern(); the pattern is owned by the slice list and stays
+ *      valid until the next call that accesses core patterns
+ */
+IAFramebuffer *IAFDMSliceList::findCorePattern(int i)
+{
+    auto it = pList.find(i);
+    if (it==pList.end()) return nullptr;
+    IAFDMSlice &s = it->second;
+    if (s.pCoreBitmap) {
+        pStats.hits++;
+    } else if (s.pCoreRuns) {
+        pStats.compressedHits++;
+        IAFramebuffer *core = new IAFramebuffer(pPrinter, IAFramebuffer::TILED);
+        core->logicOr(*s.pCoreRuns);
+        delete s.pCoreRuns;
+        s.pCoreRuns = nullptr;
+        s.pCoreBitmap = core;
+        setCoreMemory(s, core->memoryUsed());
+    } else {
+        return nullptr;
+    }
+    touch(i);
+    evict();
+    return s.pCoreBitmap;
+}
+
+
+/**
+ * Add a new core pattern to a layer.
+ *
+ * \param i layer index
+ * \param core a TILED framebuffer; the slice list takes ownership
+ */
+void IAFDMSliceList::storeCorePattern(int i, IAFramebuffer *core)
+{
+    IAFDMSlice &s = pList[i];
+    if (s.pCoreBitmap || s.pCoreRuns) {
+        pLRU.erase(s.pLRUEntry);
+        delete s.pCoreBitmap;
+        delete s.pCoreRuns;
+        s.pCoreRuns = nullptr;
+    }
+    pStats.misses++;
+    s.pCoreBitmap = core;
+    setCoreMemory(s, core->memoryUsed());
+    pLRU.push_front(i);
+    s.pLRUEntry = pLRU.begin();
+    evict();
+}
+
+
+/**
+ * Print the cache statistics to the console.
+ */
+void IAFDMSliceList::printCacheStats()
+{
+    printf("Core patterns: %zu hits, %zu compressed hits, %zu misses, "
+           "%zu compressed, %zu dropped, %.1f of %.1f MB used.\n",
+           pStats.hits, pStats.compressedHits, pStats.misses,
+           pStats.compressions, pStats.drops,
+           pMemoryUsed/1048576.0, pBudget/1048576.0);
+}
+
+
+/**
+ * Mark the core pattern of a layer as the most recently used one.
+ *
+ * \param i layer index, the layer must have a core pattern
+ */
+void IAFDMSliceList::touch(int i)
+{
+    IAFDMSlice &s = pList[i];
+    pLRU.splice(pLRU.begin(), pLRU, s.pLRUEntry);
+}
+
+
+/**
+ * Update the memory that is used by the core pattern of a slice.
+ *
+ * \param s the slice
+ * \param bytes the new size of the pattern
+ */
+void IAFDMSliceList::setCoreMemory(IAFDMSlice &s, size_t bytes)
+{
+    pMemoryUsed = pMemoryUsed - s.pCoreMemory + bytes;
+    s.pCoreMemory = bytes;
+}
+
+
+/**
+ * Reduce the memory used by core patterns until it fits the budget.
+ *
+ * The least recently used patterns are run-length encoded first. If that is
+ * not enough, they are deleted, starting with the oldest. The most recently
+ * used pattern is never touched.
+ */
+void IAFDMSliceList::evict()
+{
+    if (pMemoryUsed<=pBudget || pLRU.size()<2) return;
+    for (auto it = pLRU.rbegin(); pMemoryUsed>pBudget && std::next(it)!=pLRU.rend(); ++it) {
+        IAFDMSlice &s = pList[*it];
+        if (!s.pCoreBitmap) continue;
+        s.pCoreRuns = s.pCoreBitmap->createRunLengthBitmap();
+        delete s.pCoreBitmap;
+        s.pCoreBitmap = nullptr;
+        setCoreMemory(s, s.pCoreRuns->memoryUsed());
+        pStats.compressions++;
+    }
+    while (pMemoryUsed>pBudget && pLRU.size()>1) {
+        IAFDMSlice &s = pList[pLRU.back()];
+        delete s.pCoreBitmap;
+        s.pCoreBitmap = nullptr;
+        delete s.pCoreRuns;
+        s.pCoreRuns = nullptr;
+        setCoreMemory(s, 0);
+        pLRU.pop_back();
+        pStats.drops++;
+    }
 }
 
 
@@ -930,6 +1146,8 @@ void IAFDMSlice::purge()
     delete pSkirtToolpath; pSkirtToolpath = nullptr;
     delete pSupportToolpath; pSupportToolpath = nullptr;
     delete pCoreBitmap; pCoreBitmap = nullptr;
+    delete pCoreRuns; pCoreRuns = nullptr;
+    pCoreMemory = 0;
 }
 
 
@@ -9,26 +9,78 @@
 
 
 #include "printer/IAPrinter.h"
+#include "opengl/IASolidLayerCounter.h"
 
 #include <mutex>
+#include <list>
+#include <map>
 
 
 class IAFDMPrinter;
 class IAFDMSlice;
+class IAMeshSweep;
+class IARunLengthBitmap;
+class IASupportMap;
 
 
+/**
+ * All slices of a print job.
+ *
+ * The list also manages the memory that core patterns use. Recently used
+ * core patterns are kept as TILED framebuffers. When the total size exceeds
+ * the budget, the least recently used patterns are run-length encoded, and
+ * if that is not enough, dropped entirely, so that they must be sliced again.
+ */
 class IAFDMSliceList
 {
 public:
-    IAFDMSliceList() { }
+    /** Statistics to tune the core pattern cache. */
+    struct CacheStats {
+        /// pattern was found as a framebuffer
+        size_t hits = 0;
+        /// pattern was found run-length encoded
+        size_t compressedHits = 0;
+        /// pattern had to be created
+        size_t misses = 0;
+        /// patterns that were run-length encoded to save memory
+        size_t compressions = 0;
+        /// patterns that were dropped to save memory
+        size_t drops = 0;
+    };
+
+    IAFDMSliceList(IAPrinter *printer) : pPrinter( printer ) { }
     ~IAFDMSliceList() { }
     /** \todo implement asynchrnous calculation of slices. */
     // if ( m.find("f") == m.end() )
     // lock this list and individual slices
     IAFDMSlice &operator[](int i) { return pList[i]; }
     void purge();
+
+    IAFramebuffer *findCorePattern(int i);
+    void storeCorePattern(int i, IAFramebuffer *core);
+    /** Set the memory budget for core patterns. \param bytes size in bytes */
+    void setCoreMemoryBudget(size_t bytes) { pBudget = bytes; evict(); }
+    /** Memory used by core patterns. \return size in bytes */
+    size_t coreMemoryUsed() const { return pMemoryUsed; }
+    /** Cache statistics since the last purge. \return hits, misses, and evictions */
+    CacheStats const& cacheStats() const { return pStats; }
+    void printCacheStats();
+
 private:
+    void touch(int i);
+    void setCoreMemory(IAFDMSlice &s, size_t bytes);
+    void evict();
+
     std::map<int, IAFDMSlice> pList;
+    /// needed to expand run-length encoded patterns
+    IAPrinter *pPrinter = nullptr;
+    /// layers with a core pattern, most recently used first
+    std::list<int> pLRU;
+    /// memory used by all core patterns in bytes
+    size_t pMemoryUsed = 0;
+    /// memory budget for all core patterns in bytes
+    size_t pBudget = (size_t)256<<20;
+    CacheStats pStats;
 };
 
 
@@ -53,8 +105,14 @@ public:
     IAToolpathList *pInfillToolpath = nullptr;
     IAToolpathList *pSkirtToolpath = nullptr;
     IAToolpathList *pSupportToolpath = nullptr;
-    /// Store the bitmap for the slice without the shell
+    /// Store the bitmap for the slice without the shell, as a sparse TILED buffer
     IAFramebuffer *pCoreBitmap = nullptr;
+    /// Or store that bitmap run-length encoded, if it was not used recently
+    IARunLengthBitmap *pCoreRuns = nullptr;
+    /// Memory used by the core pattern, as accounted in the slice list
+    size_t pCoreMemory = 0;
+    /// Position in the list of recently used core patterns
+    std::list<int>::iterator pLRUEntry;
 };
 
 
@@ -101,6 +159,9 @@ public:
     // ---- scene settings
     virtual void initializeSceneSettings() override;
 
+    // ---- raster
+    virtual double autoRasterPixelSize() override;
+
 
     // printer
     IAFloatProperty nozzleDiameter { "nozzleDiameter", 0.4 };
@@ -129,7 +190,9 @@ public:
     // ----
     double sliceIndexToZ(int i);
 
-    void acquireCorePattern(int i);
+    IAFramebuffer *acquireCorePattern(int i, IAMeshSweep *sweep=nullptr);
+    void createInfillMask(int i, IAFramebuffer &mask);
+    IARunLengthBitmap *acquireFootprint();
 
     void sliceLayer(int i);
     void sliceAll();
@@ -146,7 +209,15 @@ public:
     
 private:
 
-    IAFDMSliceList pSliceList;
+    IAFDMSliceList pSliceList { this };
+    /// overhangs of the mesh, created when the first layer needs support
+    IASupportMap *pSupportMap = nullptr;
+    /// area under the mesh, created when the skirt is needed
+    IARunLengthBitmap *pFootprint = nullptr;
+    /// position of the mesh when pFootprint was created
+    IAVector3d pFootprintPosition;
+    /// runs of solid layers around the most recently sliced layer
+    IASolidLayerCounter pSolidLayers;
 };
 
 
@@ -15,8 +15,10 @@
 #include "IAPrinterSLS.h"
 #include "view/IAGUIMain.h"
 #include "toolpath/IAToolpath.h"
+#include "opengl/IAFramebufferPool.h"
 
 #include <math.h>
+#include <algorithm>
 
 #include <FL/gl.h>
 #include <FL/glu.h>
@@ -58,6 +60,8 @@ IAPrinter::IAPrinter(IAPrinter const& src)
     printVolumeMin.set( src.printVolumeMin() );
     printVolumeMax.set( src.printVolumeMax() );
     layerHeight.set( src.layerHeight() );
+    rasterPixelSize.set( src.rasterPixelSize() );
+    coarseRasterLevel.set( src.coarseRasterLevel() );
 }
 
 
@@ -126,6 +130,7 @@ void IAPrinter::initializeSceneSettings()
 void IAPrinter::purgeSlicesAndCaches()
 {
     gSlice.clear();
+    IAFramebufferPool::shared().purge();
     gSceneView->redraw();
 }
 
@@ -156,6 +161,8 @@ void IAPrinter::readProperties(Fl_Preferences &printer)
     motionRangeMax.read(properties);
     printVolumeMin.read(properties);
     printVolumeMax.read(properties);
+    rasterPixelSize.read(properties);
+    coarseRasterLevel.read(properties);
 }
 
 
@@ -182,6 +189,8 @@ void IAPrinter::writeProperties(Fl_Preferences &printer)
     motionRangeMax.write(properties);
     printVolumeMin.write(properties);
     printVolumeMax.write(properties);
+    rasterPixelSize.write(properties);
+    coarseRasterLevel.write(properties);
 }
 
 
@@ -434,6 +443,59 @@ void IAPrinter::updateBuildVolume()
 }
 
 
+/**
+ * Find a useful raster pixel size if the user did not set one.
+ *
+ * The base class uses 0.05mm, which used to be the fixed resolution of all
+ * framebuffers. Printers with a known tool size should override this.
+ *
+ * \return pixel size in mm
+ */
+double IAPrinter::autoRasterPixelSize()
+{
+    return 0.05;
+}
+
+
+/**
+ * Get the size of a raster pixel.
+ *
+ * \param coarse if set, return the pixel size for infill and support
+ *
+ * \return pixel size in mm
+ */
+double IAPrinter::rasterPixelSizeFor(bool coarse)
+{
+    double px = rasterPixelSize();
+    if (px<=0.0) px = autoRasterPixelSize();
+    if (coarse && coarseRasterLevel()>0) px *= (1<<std::min(coarseRasterLevel(), 4));
+    return px;
+}
+
+
+/**
+ * Calculate the size of a framebuffer that covers the print volume.
+ *
+ * Very large print volumes get larger pixels, so that no side exceeds
+ * kMaxRasterSize.
+ *
+ * \param[out] w, h width and height in pixels
+ * \param coarse if set, return the size of the coarse raster for infill and
+ *      support
+ */
+void IAPrinter::rasterSize(int &w, int &h, bool coarse)
+{
+    double px = rasterPixelSizeFor(coarse);
+    double wd = pPrintVolume.x()/px, hd = pPrintVolume.y()/px;
+    double scale = std::max(wd, hd)/kMaxRasterSize;
+    if (scale>1.0) {
+        wd /= scale; hd /= scale;
+    }
+    w = std::max(16, (int)lround(wd));
+    h = std::max(16, (int)lround(hd));
+}
+
+
 
 
 
@@ -88,6 +88,20 @@ public:
 
     bool pFirstWrite = true;
 
+    // ---- raster
+    virtual double autoRasterPixelSize();
+    double rasterPixelSizeFor(bool coarse=false);
+    void rasterSize(int &w, int &h, bool coarse=false);
+
+    /// Largest width or height of a raster in pixels.
+    static const int kMaxRasterSize = 16384;
+
+    /// Size of a raster pixel in mm; 0 derives it from the printer.
+    IAFloatProperty rasterPixelSize { "rasterPixelSize", 0.0 };
+    /// Infill and support are rastered with pixels 2^n times larger;
+    /// 0 uses the same raster for everything.
+    IAIntProperty coarseRasterLevel { "coarseRasterLevel", 0 };
+
     // ---- scene settings
     virtual void initializeSceneSettings();
     void buildSessionSettings(Fl_Tree*);
@@ -12,6 +12,7 @@
 #include "view/IAProgressDialog.h"
 #include "toolpath/IAToolpath.h"
 #include "opengl/IAFramebuffer.h"
+#include "geometry/IAMeshSweep.h"
 
 
 #include <FL/Fl_Native_File_Chooser.H>
@@ -159,14 +160,13 @@ void IAPrinterInkjet::saveSlices(const char *filename)
 
     int i = 0, n = (int)((zMax-zMin)/zLayerHeight) + 2;
 
+    IAMeshSweep sweep(Iota.pMesh);
     for (i=0; i<n; ++i)
     {
         double z = i * layerHeight() + 0.5 /* + first layer offset */;
         if (IAProgressDialog::update(i*100/n, i, n, z, i*100/n)) break;
 
-        gSlice.setNewZ(z);
-        gSlice.clear();
-        gSlice.generateRim( Iota.pMesh );
+        sweep.slice(z, &gSlice);
         gSlice.tesselateAndDrawLid(gSlice.pColorbuffer);
         uint8_t *rgb = gSlice.pColorbuffer->getRawImageRGBA();
 
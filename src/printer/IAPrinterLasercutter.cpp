@@ -152,6 +152,7 @@ void IAPrinterLasercutter::saveToolpaths(const char *filename)
     double zMin = 0.5 * layerHeight();
     double zLayerHeight = layerHeight();
     double zMax = hgt;
+    Iota.pMesh->updateGlobalSpace();
 
     IAProgressDialog::show("Saving slices",
                            "Writing layer %d of %d at %.3fmm (%d%%)");
@@ -20,11 +20,23 @@
 #include <algorithm>
 
 
+/**
+ * Find the pixel under a point in an RGB image of the current printer's raster.
+ */
+static uint8_t *rgbPixel(uint8_t *rgb, IAVector3d v)
+{
+    IAPrinter *printer = Iota.pCurrentPrinter;
+    int w, h;
+    printer->rasterSize(w, h);
+    int xo = (int)(v.x() / printer->pPrintVolume.x() * w);
+    int yo = (int)(v.y() / printer->pPrintVolume.y() * h);
+    return rgb + (xo+w*yo)*3;
+}
+
+
 bool isBlack(uint8_t *rgb, IAVector3d v)
 {
-    IAVector3d s = v * (kFramebufferSize / 214.0);
-    int xo = (int)s.x(), yo = (int)s.y();
-    uint8_t *c = rgb + (xo+kFramebufferSize*yo)*3;
+    uint8_t *c = rgbPixel(rgb, v);
     if (c[0]<128 && c[1]<128 && c[2]<128) {
         return true;
     } else {
@@ -86,9 +98,7 @@ void IAToolpath::colorize(uint8_t *rgb, IAToolpath *black, IAToolpath *white)
 
 uint32_t getRGB(uint8_t *rgb, IAVector3d v)
 {
-    IAVector3d s = v * (kFramebufferSize / 214.0);
-    int xo = (int)s.x(), yo = (int)s.y();
-    uint8_t *c = rgb + (xo+kFramebufferSize*yo)*3;
+    uint8_t *c = rgbPixel(rgb, v);
     return ((c[0]<<16)|(c[1]<<8)|(c[2]));
 }
 
@@ -757,6 +767,31 @@ IAToolpath *IAToolpathLoop::clone(IAToolpath *t)
 // =============================================================================
 
 
+IAToolpathLine::IAToolpathLine(double z)
+:   IAToolpath( z )
+{
+}
+
+
+IAToolpathLine::~IAToolpathLine()
+{
+}
+
+
+IAToolpath *IAToolpathLine::clone(IAToolpath *t)
+{
+    if (!t)
+        t = new IAToolpathLine(pZ);
+    return super::clone(t);
+}
+
+
+#ifdef __APPLE__
+#pragma mark -
+#endif
+// =============================================================================
+
+
 /**
  * Create any sort of toolpath element.
  */
@@ -0,0 +1,241 @@
+//
+//  IABenchRimFill.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "geometry/IAMesh.h"
+#include "geometry/IAMeshSlice.h"
+#include "opengl/IAFramebuffer.h"
+#include "printer/IAFDMPrinter.h"
+#include "potrace/bitmap.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+
+/// a polygon corner in pixels, as IAFramebuffer::addPoint() stores it
+struct OldVertex {
+    float pX, pY;
+    bool pIsGap;
+};
+
+
+/**
+ * Fill a polygon the way IAFramebuffer::endComplexPolygon() did before the
+ * active edge table.
+ *
+ * Every row tested every edge, the crossings were bubble sorted, and the
+ * spans were drawn one pixel at a time.
+ *
+ * \param bm draw into this bitmap
+ * \param v all corners, every loop closed with a gap, as addGap() does
+ * \param color fill with 0 or 1
+ */
+static void oldEndComplexPolygon(potrace_bitmap_t *bm,
+                                 std::vector<OldVertex> const& v, int color)
+{
+    int end = (int)v.size();
+    if (end < 2) return;
+
+    int xMin = v[0].pX, xMax = xMin, yMin = v[0].pY, yMax = yMin;
+    for (int i = 1; i < end; i++) {
+        if (v[i].pX < xMin) xMin = v[i].pX;
+        if (v[i].pX > xMax) xMax = v[i].pX;
+        if (v[i].pY < yMin) yMin = v[i].pY;
+        if (v[i].pY > yMax) yMax = v[i].pY;
+    }
+    xMax++; yMax++;
+
+    int nodes, pixelY, i, j, swap;
+    std::vector<int> nodeX(end);
+
+    for (pixelY = yMin; pixelY < yMax; pixelY++) {
+        nodes = 0;
+        for (i = 1; i < end; i++) {
+            j = i-1;
+            if (v[j].pIsGap)
+                continue;
+            if (   (v[i].pY < pixelY && v[j].pY >= pixelY)
+                || (v[j].pY < pixelY && v[i].pY >= pixelY) )
+            {
+                float dy = v[j].pY - v[i].pY;
+                if (fabsf(dy)>.0001) {
+                    nodeX[nodes++] = (int)(v[i].pX + (pixelY - v[i].pY) / dy
+                                           * (v[j].pX - v[i].pX));
+                } else {
+                    nodeX[nodes++] = v[i].pX;
+                }
+            }
+        }
+
+        i = 0;
+        while (i < nodes - 1) {
+            if (nodeX[i] > nodeX[i + 1]) {
+                swap = nodeX[i];
+                nodeX[i] = nodeX[i + 1];
+                nodeX[i + 1] = swap;
+                if (i) i--;
+            } else {
+                i++;
+            }
+        }
+
+        for (i = 0; i < nodes-1; i += 2) {
+            if (nodeX[i] >= xMax) break;
+            if (nodeX[i + 1] > xMin) {
+                int x1 = std::max(nodeX[i], xMin), x2 = std::min(nodeX[i+1], xMax);
+                if (x1>=x2) continue;
+                if (x1<0) x1 = 0;
+                if (x2>bm->w) x2 = bm->w;
+                if (color)
+                    for (int x=x1; x<x2; x++) BM_USET(bm, x, pixelY);
+                else
+                    for (int x=x1; x<x2; x++) BM_UCLR(bm, x, pixelY);
+            }
+        }
+    }
+}
+
+
+/**
+ * Convert a rim into the corner list that IAFramebuffer builds from it.
+ */
+static void rimToVertices(IAEdgeList const& rim, IAFramebuffer *fb,
+                          IAPrinter *printer, std::vector<OldVertex> &v)
+{
+    v.clear();
+    size_t loopStart = 0;
+    for (auto e: rim) {
+        if (e) {
+            IAVector3d const& p = e->pVertex[0]->pGlobalPosition;
+            v.push_back({ (float)(p.x()/printer->pPrintVolume.x()*fb->width()),
+                          (float)(p.y()/printer->pPrintVolume.y()*fb->height()),
+                          false });
+        } else if (v.size()>loopStart) {
+            OldVertex first = v[loopStart];
+            first.pIsGap = true;
+            v.push_back(first);
+            loopStart = v.size();
+        }
+    }
+    if (v.size()>loopStart) {
+        OldVertex first = v[loopStart];
+        first.pIsGap = true;
+        v.push_back(first);
+    }
+}
+
+
+/**
+ * Fill the rims of a few layers of a mesh with both implementations.
+ *
+ * \param label describes the mesh
+ * \param mesh the mesh on the print bed
+ * \param printer the printer that sets the raster
+ * \param zs slice at these heights
+ */
+static void benchRimFill(const char *label, IAMesh *mesh, IAFDMPrinter *printer,
+                         std::vector<double> const& zs)
+{
+    IAFramebuffer fb(printer, IAFramebuffer::BITMAP);
+    potrace_bitmap_t *ref = nullptr;
+    IAMeshSlice slice(printer);
+    std::vector<OldVertex> v;
+    double tOld = 0.0, tNew = 0.0, tCoverage = 0.0;
+    size_t nEdges = 0;
+    int nDifferent = 0;
+
+    for (double z: zs) {
+        slice.setNewZ(z);
+        slice.generateRim(mesh);
+        IAEdgeList const& rim = slice.rim();
+        nEdges += rim.size();
+
+        // the current scanline fill
+        fb.fill(0);
+        fb.bindForRendering();
+        double t0 = ia_test_seconds();
+        fb.beginComplexPolygon();
+        for (auto e: rim) {
+            if (e) fb.addPoint(e->pVertex[0]->pGlobalPosition);
+            else fb.addGap();
+        }
+        fb.endComplexPolygon(1, false);
+        tNew += ia_test_seconds()-t0;
+        fb.unbindFromRendering();
+
+        // the old fill on a bitmap of the same size
+        if (!ref) ref = bm_new(fb.width(), fb.height());
+        bm_clear(ref, 0);
+        rimToVertices(rim, &fb, printer, v);
+        t0 = ia_test_seconds();
+        oldEndComplexPolygon(ref, v, 1);
+        tOld += ia_test_seconds()-t0;
+
+        for (int y=0; y<fb.height(); y++) {
+            if (memcmp(bm_scanline(ref, y), bm_scanline(fb.pBitmap, y),
+                       (size_t)ref->dy*BM_WORDSIZE)!=0) {
+                nDifferent++;
+                break;
+            }
+        }
+
+        // the fill that slicing actually uses, for reference
+        fb.fill(0);
+        fb.bindForRendering();
+        t0 = ia_test_seconds();
+        fb.drawLid(const_cast<IAEdgeList&>(rim));
+        tCoverage += ia_test_seconds()-t0;
+        fb.unbindFromRendering();
+    }
+    if (ref) bm_free(ref);
+
+    size_t n = zs.size();
+    printf("  %s, %zu layers, %zu edges per layer:\n", label, n, nEdges/std::max(n, (size_t)1));
+    printf("    old bubble sort fill:  %8.3f ms per layer\n", 1000.0*tOld/n);
+    printf("    scanline fill:         %8.3f ms per layer, %.1fx faster\n",
+           1000.0*tNew/n, tOld/tNew);
+    printf("    drawLid with coverage: %8.3f ms per layer\n", 1000.0*tCoverage/n);
+    if (nDifferent)
+        printf("    WARNING: %d layers differ from the old fill\n", nDifferent);
+}
+
+
+/**
+ * Fill real slice rims with the old and the new polygon fill.
+ */
+int main(int argc, char **argv)
+{
+    int nSeg = 4000;
+    if (argc>1) {
+        // scale the number of segments around the z axis by the given factor
+        double f = atof(argv[1]);
+        if (f>0.0) nSeg = std::max(8, (int)(nSeg*f));
+    }
+    IAFDMPrinter *printer = ia_test_printer();
+    int w, h;
+    printer->rasterSize(w, h);
+    printf("Rim fill on a %dx%d pixel raster, %.3f mm per pixel\n",
+           w, h, printer->rasterPixelSizeFor());
+
+    std::vector<double> zs;
+    for (int i=1; i<10; i++) zs.push_back(i*10.0);
+
+    std::vector<uint8_t> stl = ia_test_sphere_stl(50.0, 200, nSeg);
+    IAMesh *mesh = ia_test_load_stl(stl, printer);
+    benchRimFill("sphere", mesh, printer, zs);
+    delete mesh;
+
+    stl = ia_test_cylinder_stl(100.0, 100.0, 8*nSeg);
+    mesh = ia_test_load_stl(stl, printer);
+    benchRimFill("cylinder", mesh, printer, zs);
+    delete mesh;
+
+    return 0;
+}
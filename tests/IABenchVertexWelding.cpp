@@ -0,0 +1,166 @@
+//
+//  IABenchVertexWelding.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "fileformats/IAGeometryReaderBinaryStl.h"
+#include "geometry/IAMesh.h"
+#include "geometry/IAVertexWelder.h"
+#include "printer/IAFDMPrinter.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+
+
+/// the old welder gives up after this many seconds
+static const double kOldWelderTimeLimit = 30.0;
+
+
+/**
+ * Weld corners the way IAMesh did before IAVertexWelder.
+ *
+ * Vertices were kept in a multimap keyed on their distance from the origin,
+ * and every lookup compared all vertices within 0.0001 of that distance.
+ *
+ * \param corners all triangle corners in file order
+ * \param[out] nDone number of corners welded before the time limit
+ *
+ * \return number of unique vertices
+ */
+static size_t weldOld(std::vector<IAVector3d> const& corners, size_t &nDone)
+{
+    std::multimap<double, IAVertex*> map;
+    std::vector<IAVertex*> vertices;
+    double t0 = ia_test_seconds();
+    for (nDone=0; nDone<corners.size(); nDone++) {
+        if ((nDone&0xFFF)==0 && ia_test_seconds()-t0>kOldWelderTimeLimit)
+            break;
+        IAVector3d const& pos = corners[nDone];
+        double length = pos.length();
+        auto itlow = map.lower_bound(length-0.0001);
+        auto itup = map.upper_bound(length+0.0001);
+        bool found = false;
+        for (auto it=itlow; it!=itup; ++it) {
+            if (it->second->pLocalPosition==pos) { found = true; break; }
+        }
+        if (found) continue;
+        IAVertex *v = new IAVertex();
+        v->pLocalPosition = pos;
+        vertices.push_back(v);
+        map.insert(std::make_pair(length, v));
+    }
+    for (auto v: vertices) delete v;
+    return vertices.size();
+}
+
+
+/**
+ * Weld corners one by one with IAVertexWelder, as IAMesh does now.
+ *
+ * \param corners all triangle corners in file order
+ *
+ * \return number of unique vertices
+ */
+static size_t weldNew(std::vector<IAVector3d> const& corners)
+{
+    IAVertexWelder welder;
+    welder.reserve(corners.size()/6);
+    std::vector<IAVertex*> vertices;
+    for (auto const& pos: corners) {
+        if (welder.find(pos)) continue;
+        IAVertex *v = new IAVertex();
+        v->pLocalPosition = pos;
+        vertices.push_back(v);
+        welder.insert(v);
+    }
+    for (auto v: vertices) delete v;
+    return vertices.size();
+}
+
+
+/**
+ * Time both welders on the corners of an STL file.
+ *
+ * \param label describes where the mesh is
+ * \param stl the file data
+ * \param offset move all corners by this much
+ */
+static void benchWelding(const char *label, std::vector<uint8_t> const& stl,
+                         IAVector3d const& offset)
+{
+    uint32_t nt;
+    memcpy(&nt, stl.data()+80, 4);
+    std::vector<IAVector3d> corners;
+    corners.reserve(3*(size_t)nt);
+    for (size_t i=0; i<nt; i++) {
+        float p[9];
+        memcpy(p, stl.data()+84+50*i+12, sizeof(p));
+        for (int j=0; j<3; j++)
+            corners.push_back(IAVector3d(p[3*j], p[3*j+1], p[3*j+2]) + offset);
+    }
+
+    double t0 = ia_test_seconds();
+    size_t nNew = weldNew(corners);
+    double tNew = ia_test_seconds()-t0;
+
+    size_t nDone;
+    t0 = ia_test_seconds();
+    size_t nOld = weldOld(corners, nDone);
+    double tOld = ia_test_seconds()-t0;
+
+    printf("  %s:\n", label);
+    printf("    IAVertexWelder:   %8.3f s, %zu vertices\n", tNew, nNew);
+    if (nDone==corners.size()) {
+        printf("    length multimap:  %8.3f s, %zu vertices, %.1fx slower\n",
+               tOld, nOld, tOld/tNew);
+    } else {
+        printf("    length multimap:  stopped after %.1f s at %zu of %zu corners\n",
+               tOld, nDone, corners.size());
+    }
+}
+
+
+/**
+ * Import a sphere with about a million triangles and compare the welders.
+ */
+int main(int argc, char **argv)
+{
+    int nLat = 500, nLon = 1000;
+    if (argc>1) {
+        // scale the triangle count by the given factor
+        double f = sqrt(atof(argv[1]));
+        if (f>0.0) { nLat = std::max(2, (int)(nLat*f)); nLon = std::max(3, (int)(nLon*f)); }
+    }
+    IAFDMPrinter *printer = ia_test_printer();
+    std::vector<uint8_t> stl = ia_test_sphere_stl(50.0, nLat, nLon);
+    uint32_t nt;
+    memcpy(&nt, stl.data()+80, 4);
+    printf("Sphere with %u triangles, %zu MB binary STL\n", nt, stl.size()>>20);
+
+    // the whole import, including twinning, validation and normals
+    double t0 = ia_test_seconds();
+    IAGeometryReaderBinaryStl reader("sphere.stl", stl.data(), stl.size());
+    IAMesh *mesh = reader.load();
+    double tLoad = ia_test_seconds()-t0;
+    mesh->centerOnPrintbed(printer);
+    t0 = ia_test_seconds();
+    mesh->updateGlobalSpace();
+    double tIndex = ia_test_seconds()-t0;
+    printf("  import:           %8.3f s, %zu vertices\n", tLoad, mesh->vertexList.size());
+    printf("  z index:          %8.3f s\n", tIndex);
+    delete mesh;
+
+    // welding one corner at a time, as the ASCII STL reader does;
+    // all vertices of a sphere around the origin have the same length, which
+    // is the worst case for the old map
+    benchWelding("centered on the origin", stl, IAVector3d(0.0, 0.0, 0.0));
+    benchWelding("centered on the print bed", stl, IAVector3d(107.0, 107.0, 50.0));
+    return 0;
+}
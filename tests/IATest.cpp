@@ -0,0 +1,241 @@
+//
+//  IATest.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "Iota.h"
+#include "fileformats/IAGeometryReaderBinaryStl.h"
+#include "geometry/IAMesh.h"
+#include "printer/IAFDMPrinter.h"
+#include "toolpath/IAToolpath.h"
+
+#include <math.h>
+#include <string.h>
+#include <chrono>
+
+
+int gIATestFailures = 0;
+
+
+/**
+ * Create an FDM printer with default settings and make it the current printer.
+ *
+ * \param pixelSize raster pixel size in mm, 0 for the printer default
+ *
+ * \return the printer; it is never deleted, because framebuffers and
+ *      toolpaths keep pointers to the current printer
+ */
+IAFDMPrinter *ia_test_printer(double pixelSize)
+{
+    IAFDMPrinter *printer = new IAFDMPrinter();
+    printer->rasterPixelSize.set(pixelSize);
+    Iota.pCurrentPrinter = printer;
+    return printer;
+}
+
+
+/**
+ * Append a triangle to a binary STL file in memory.
+ */
+static void addStlTriangle(std::vector<uint8_t> &stl, double const* a,
+                           double const* b, double const* c)
+{
+    float rec[12] = { 0.0f, 0.0f, 0.0f };
+    for (int i=0; i<3; i++) {
+        rec[3+i] = (float)a[i];
+        rec[6+i] = (float)b[i];
+        rec[9+i] = (float)c[i];
+    }
+    size_t n = stl.size();
+    stl.resize(n+50, 0);
+    memcpy(stl.data()+n, rec, sizeof(rec));
+}
+
+
+/**
+ * Start a binary STL file in memory.
+ */
+static void beginStl(std::vector<uint8_t> &stl, uint32_t nTriangles)
+{
+    stl.assign(84, 0);
+    memcpy(stl.data()+80, &nTriangles, 4);
+    stl.reserve(84+50*(size_t)nTriangles);
+}
+
+
+/**
+ * Create a closed sphere around the origin as a binary STL file.
+ *
+ * The sphere is made from nLon slices and nLat stacks, and has
+ * 2*nLon*(nLat-1) triangles. All triangles are counterclockwise when seen
+ * from outside.
+ *
+ * \param r radius in mm
+ * \param nLat number of stacks from pole to pole, at least 2
+ * \param nLon number of slices around the z axis, at least 3
+ *
+ * \return the file data
+ */
+std::vector<uint8_t> ia_test_sphere_stl(double r, int nLat, int nLon)
+{
+    std::vector<uint8_t> stl;
+    beginStl(stl, 2*(uint32_t)nLon*(uint32_t)(nLat-1));
+    auto point = [=](int i, int j, double *p) {
+        double theta = M_PI*i/nLat, phi = 2.0*M_PI*(j%nLon)/nLon;
+        p[0] = r*sin(theta)*cos(phi);
+        p[1] = r*sin(theta)*sin(phi);
+        p[2] = r*cos(theta);
+        if (i==0 || i==nLat) p[0] = p[1] = 0.0;
+    };
+    double p00[3], p01[3], p10[3], p11[3];
+    for (int i=0; i<nLat; i++) {
+        for (int j=0; j<nLon; j++) {
+            point(i, j, p00); point(i, j+1, p01);
+            point(i+1, j, p10); point(i+1, j+1, p11);
+            if (i>0)
+                addStlTriangle(stl, p00, p10, p01);
+            if (i<nLat-1)
+                addStlTriangle(stl, p01, p10, p11);
+        }
+    }
+    return stl;
+}
+
+
+/**
+ * Create a closed cylinder standing on the origin as a binary STL file.
+ *
+ * \param r radius in mm
+ * \param h height in mm
+ * \param n number of segments around the z axis, at least 3
+ *
+ * \return the file data, 4*n triangles, counterclockwise when seen from
+ *      outside
+ */
+std::vector<uint8_t> ia_test_cylinder_stl(double r, double h, int n)
+{
+    std::vector<uint8_t> stl;
+    beginStl(stl, 4*(uint32_t)n);
+    double bc[3] = { 0.0, 0.0, 0.0 }, tc[3] = { 0.0, 0.0, h };
+    for (int j=0; j<n; j++) {
+        double a0 = 2.0*M_PI*j/n, a1 = 2.0*M_PI*((j+1)%n)/n;
+        double b0[3] = { r*cos(a0), r*sin(a0), 0.0 }, b1[3] = { r*cos(a1), r*sin(a1), 0.0 };
+        double t0[3] = { b0[0], b0[1], h }, t1[3] = { b1[0], b1[1], h };
+        addStlTriangle(stl, bc, b1, b0);
+        addStlTriangle(stl, b0, b1, t1);
+        addStlTriangle(stl, b0, t1, t0);
+        addStlTriangle(stl, tc, t0, t1);
+    }
+    return stl;
+}
+
+
+/**
+ * Add a closed box to a binary STL file.
+ *
+ * A file can hold any number of boxes; they don't need to touch.
+ *
+ * \param stl the file data, may be empty
+ * \param lo, hi two opposite corners of the box, x, y, and z in mm
+ */
+void ia_test_add_box_stl(std::vector<uint8_t> &stl, double const lo[3], double const hi[3])
+{
+    uint32_t n = 0;
+    if (stl.size()<84)
+        beginStl(stl, 0);
+    else
+        memcpy(&n, stl.data()+80, 4);
+    n += 12;
+    memcpy(stl.data()+80, &n, 4);
+    // every face as two triangles, counterclockwise from outside
+    static const int face[6][4] = {
+        { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 },
+        { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 }
+    };
+    double c[8][3];
+    for (int i=0; i<8; i++) {
+        c[i][0] = (i&1) ? hi[0] : lo[0];
+        c[i][1] = (i&2) ? hi[1] : lo[1];
+        c[i][2] = (i&4) ? hi[2] : lo[2];
+    }
+    for (auto const& f: face) {
+        addStlTriangle(stl, c[f[0]], c[f[1]], c[f[2]]);
+        addStlTriangle(stl, c[f[0]], c[f[2]], c[f[3]]);
+    }
+}
+
+
+/**
+ * Load a binary STL file from memory and put it on the print bed.
+ *
+ * \param stl the file data
+ * \param printer the mesh is centered on the bed of this printer
+ *
+ * \return a mesh that is ready for slicing
+ */
+IAMesh *ia_test_load_stl(std::vector<uint8_t> &stl, IAFDMPrinter *printer)
+{
+    IAGeometryReaderBinaryStl reader("test.stl", stl.data(), stl.size());
+    IAMesh *mesh = reader.load();
+    mesh->centerOnPrintbed(printer);
+    mesh->updateGlobalSpace();
+    return mesh;
+}
+
+
+/**
+ * Collect the extruding moves of a toolpath.
+ *
+ * \param tp the toolpath, may be nullptr
+ *
+ * \return start and end point of every motion that is not a rapid move, in mm
+ */
+std::vector<IAVector3d> ia_test_motions(IAToolpathList *tp)
+{
+    std::vector<IAVector3d> seg;
+    if (!tp) return seg;
+    for (auto t: tp->pToolpathList) {
+        for (auto e: t->pElementList) {
+            IAToolpathMotion *m = dynamic_cast<IAToolpathMotion*>(e);
+            if (m && !m->pIsRapid) {
+                seg.push_back(m->pStart);
+                seg.push_back(m->pEnd);
+            }
+        }
+    }
+    return seg;
+}
+
+
+/**
+ * Read a monotonic clock.
+ *
+ * \return time in seconds since some fixed point in the past
+ */
+double ia_test_seconds()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+/**
+ * Print the outcome of a test.
+ *
+ * \param name the name of the test
+ *
+ * \return the exit code for main(), 0 if all checks passed
+ */
+int ia_test_result(const char *name)
+{
+    if (gIATestFailures) {
+        printf("%s: %d checks FAILED.\n", name, gIATestFailures);
+        return 1;
+    }
+    printf("%s: all checks passed.\n", name);
+    return 0;
+}
@@ -0,0 +1,50 @@
+//
+//  IATest.h
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+#ifndef IA_TEST_H
+#define IA_TEST_H
+
+
+#include "geometry/IAVector3d.h"
+
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+
+
+class IAMesh;
+class IAFDMPrinter;
+class IAToolpathList;
+
+
+/**
+ * Check a condition in a unit test and count the failure if it is false.
+ *
+ * Tests keep going after a failed check, so that a single run reports all
+ * problems. ia_test_result() turns the failure count into the exit code.
+ */
+#define IA_TEST_CHECK(cond) \
+do { \
+if (!(cond)) { \
+printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+gIATestFailures++; \
+} \
+} while(0)
+
+/// number of failed checks so far
+extern int gIATestFailures;
+
+IAFDMPrinter *ia_test_printer(double pixelSize=0.0);
+std::vector<uint8_t> ia_test_sphere_stl(double r, int nLat, int nLon);
+std::vector<uint8_t> ia_test_cylinder_stl(double r, double h, int n);
+void ia_test_add_box_stl(std::vector<uint8_t> &stl, double const lo[3], double const hi[3]);
+IAMesh *ia_test_load_stl(std::vector<uint8_t> &stl, IAFDMPrinter *printer);
+std::vector<IAVector3d> ia_test_motions(IAToolpathList *tp);
+double ia_test_seconds();
+int ia_test_result(const char *name);
+
+
+#endif /* IA_TEST_H */
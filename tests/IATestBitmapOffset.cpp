@@ -0,0 +1,152 @@
+//
+//  IATestBitmapOffset.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "opengl/IAFramebuffer.h"
+#include "potrace/bitmap.h"
+#include "printer/IAFDMPrinter.h"
+#include "toolpath/IAToolpath.h"
+
+#include <math.h>
+
+
+/// pixel size of the test printer in mm
+static const double kPixelSize = 0.1;
+
+
+/**
+ * Draw a star with a hole, and a thin bar that disappears when contracted.
+ */
+static void drawShapes(IAFramebuffer &fb, bool coverage)
+{
+    fb.bindForRendering();
+    fb.fill(0);
+    fb.beginComplexPolygon();
+    for (int i=0; i<14; i++) {
+        double a = 2.0*M_PI*i/14, r = (i&1) ? 15.0 : 35.0;
+        fb.addPoint(70.0+r*cos(a), 70.0+r*sin(a));
+    }
+    fb.addGap();
+    for (int i=0; i<20; i++) {
+        double a = -2.0*M_PI*i/20;
+        fb.addPoint(70.0+8.0*cos(a), 70.0+8.0*sin(a));
+    }
+    fb.addGap();
+    fb.addPoint(120.0, 120.0);
+    fb.addPoint(180.0, 121.3);
+    fb.addPoint(180.0, 122.1);
+    fb.addPoint(120.0, 120.8);
+    fb.endComplexPolygon(1, coverage);
+    fb.unbindFromRendering();
+}
+
+
+/**
+ * Compare a distance transform offset to the traced outline stamped into the
+ * bitmap.
+ *
+ * The stamped outline is made of octagons, and the traced outline cuts the
+ * corners of pixel steps, so the two may differ by up to two pixels along the
+ * new outline, but nowhere else.
+ *
+ * \param coverage draw the shapes with edge coverage
+ * \param r offset in mm
+ * \param color 1 to expand, 0 to contract
+ */
+static void checkOffset(IAFDMPrinter *printer, bool coverage, double r, int color)
+{
+    IAFramebuffer ref(printer, IAFramebuffer::BITMAP);
+    drawShapes(ref, coverage);
+    IAFramebuffer fb(printer, IAFramebuffer::BITMAP);
+    drawShapes(fb, coverage);
+
+    IAFramebuffer lasso(&ref);
+    IAToolpathListSP tp = lasso.toolpathFromLasso(0.2);
+    IA_TEST_CHECK(tp!=nullptr);
+    if (color) {
+        ref.add(tp, r);
+        fb.expand(r);
+    } else {
+        ref.subtract(tp, r);
+        fb.contract(r);
+    }
+
+    // every pixel that differs must be near the outline of the reference
+    int w = ref.width(), h = ref.height();
+    auto get = [&](int x, int y)->int {
+        if (x<0 || y<0 || x>=w || y>=h) return 0;
+        return BM_UGET(ref.pBitmap, x, y) ? 1 : 0;
+    };
+    size_t nDiff = 0, nOffOutline = 0;
+    for (int y=0; y<h; y++) {
+        for (int x=0; x<w; x++) {
+            int c = get(x, y);
+            if ((BM_UGET(fb.pBitmap, x, y) ? 1 : 0)==c) continue;
+            nDiff++;
+            bool nearOutline = false;
+            for (int v=y-2; v<=y+2; v++)
+                for (int u=x-2; u<=x+2; u++)
+                    if (get(u, v)!=c) nearOutline = true;
+            if (!nearOutline) nOffOutline++;
+        }
+    }
+    size_t nRef = ref.countPixels(), n = fb.countPixels();
+    printf("%s by %.1f mm%s: %zu pixels, %zu stamped, %zu differ, "
+           "%zu off the outline\n", color ? "expand" : "contract", r,
+           coverage ? " with coverage" : "", n, nRef, nDiff, nOffOutline);
+    IA_TEST_CHECK(nOffOutline==0);
+    IA_TEST_CHECK(nDiff<nRef/50);
+}
+
+
+/**
+ * A disk offset by r is a disk whose radius is r larger or smaller.
+ */
+static void checkDisk(IAFDMPrinter *printer, double r, int color)
+{
+    const double rDisk = 20.0;
+    IAFramebuffer fb(printer, IAFramebuffer::BITMAP);
+    fb.bindForRendering();
+    fb.fill(0);
+    fb.beginComplexPolygon();
+    for (int i=0; i<720; i++) {
+        double a = 2.0*M_PI*i/720;
+        fb.addPoint(100.0+rDisk*cos(a), 100.0+rDisk*sin(a));
+    }
+    fb.endComplexPolygon(1);
+    fb.unbindFromRendering();
+    if (color) fb.expand(r); else fb.contract(r);
+
+    double rNew = color ? rDisk+r : rDisk-r;
+    double expected = M_PI*rNew*rNew/(kPixelSize*kPixelSize);
+    size_t n = fb.countPixels();
+    printf("disk %s by %.1f mm: %zu pixels, %.0f expected\n",
+           color ? "expanded" : "contracted", r, n, expected);
+    IA_TEST_CHECK(fabs(n-expected)<0.005*expected);
+}
+
+
+/**
+ * contract() and expand() must give the same result as stamping the traced
+ * outline with subtract() and add(), which they replace.
+ */
+int main(int argc, char **argv)
+{
+    IAFDMPrinter *printer = ia_test_printer(kPixelSize);
+    for (bool coverage: { false, true }) {
+        for (double r: { 0.2, 0.5, 1.5 }) {
+            checkOffset(printer, coverage, r, 0);
+            checkOffset(printer, coverage, r, 1);
+        }
+    }
+    for (double r: { 0.5, 3.0 }) {
+        checkDisk(printer, r, 0);
+        checkDisk(printer, r, 1);
+    }
+    return ia_test_result("bitmap_offset_test");
+}
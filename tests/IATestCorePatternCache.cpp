@@ -0,0 +1,95 @@
+//
+//  IATestCorePatternCache.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "opengl/IAFramebuffer.h"
+#include "printer/IAFDMPrinter.h"
+
+#include <math.h>
+
+
+/// pixel size of the test printer in mm
+static const double kPixelSize = 0.5;
+
+
+/**
+ * Create the core pattern of a layer, a disk whose size depends on the layer.
+ */
+static IAFramebuffer *createCore(IAFDMPrinter *printer, int i)
+{
+    IAFramebuffer *fb = new IAFramebuffer(printer, IAFramebuffer::TILED);
+    fb->bindForRendering();
+    fb->fill(0);
+    fb->beginComplexPolygon();
+    for (int k=0; k<64; k++) {
+        double a = 2.0*M_PI*k/64;
+        fb->addPoint(100.0+(20.0+i)*cos(a), 100.0+(20.0+i)*sin(a));
+    }
+    fb->endComplexPolygon(1);
+    fb->unbindFromRendering();
+    return fb;
+}
+
+
+/**
+ * Core patterns must come back from the cache with the same pixels, whether
+ * they were kept as they are or run-length encoded, and the cache must drop
+ * the least recently used patterns when it runs out of memory.
+ */
+int main(int argc, char **argv)
+{
+    IAFDMPrinter *printer = ia_test_printer(kPixelSize);
+    const int n = 10;
+    std::vector<size_t> nPixels;
+    size_t coreSize = 0;
+
+    IAFDMSliceList list(printer);
+    list.setCoreMemoryBudget((size_t)1<<30);
+    for (int i=0; i<n; i++) {
+        IAFramebuffer *core = createCore(printer, i);
+        nPixels.push_back(core->countPixels());
+        coreSize = std::max(coreSize, core->memoryUsed());
+        list.storeCorePattern(i, core);
+    }
+    IA_TEST_CHECK(list.findCorePattern(n)==nullptr);
+    for (int i=0; i<n; i++) {
+        IAFramebuffer *core = list.findCorePattern(i);
+        IA_TEST_CHECK(core && core->countPixels()==nPixels[i]);
+    }
+    IAFDMSliceList::CacheStats s = list.cacheStats();
+    IA_TEST_CHECK(s.misses==n && s.hits==n);
+    IA_TEST_CHECK(s.compressedHits==0 && s.compressions==0 && s.drops==0);
+
+    // only the most recently used pattern fits as it is, the others are
+    // run-length encoded, and come back with the same pixels; reading them
+    // in order encodes the previous one every time
+    list.setCoreMemoryBudget(coreSize + coreSize/2);
+    s = list.cacheStats();
+    IA_TEST_CHECK(s.compressions==n-1 && s.drops==0);
+    IA_TEST_CHECK(list.coreMemoryUsed()<=coreSize + coreSize/2);
+    for (int i=0; i<n; i++) {
+        IAFramebuffer *core = list.findCorePattern(i);
+        IA_TEST_CHECK(core && core->countPixels()==nPixels[i]);
+    }
+    s = list.cacheStats();
+    IA_TEST_CHECK(s.compressedHits==n && s.hits==n);
+    IA_TEST_CHECK(s.compressions==2*n-1);
+
+    // without memory, only the most recently used pattern is kept
+    list.setCoreMemoryBudget(0);
+    s = list.cacheStats();
+    IA_TEST_CHECK(s.drops==n-1);
+    IA_TEST_CHECK(list.findCorePattern(0)==nullptr);
+    IA_TEST_CHECK(list.findCorePattern(n-1)!=nullptr);
+    list.printCacheStats();
+
+    list.purge();
+    IA_TEST_CHECK(list.coreMemoryUsed()==0);
+    IA_TEST_CHECK(list.cacheStats().misses==0);
+    return ia_test_result("core_pattern_cache_test");
+}
@@ -0,0 +1,177 @@
+//
+//  IATestDirtyBox.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "opengl/IAFramebuffer.h"
+#include "opengl/IATiledBitmap.h"
+#include "potrace/bitmap.h"
+#include "printer/IAFDMPrinter.h"
+
+#include <algorithm>
+
+
+/// pixel size of the test printer in mm
+static const double kPixelSize = 0.2;
+
+
+/**
+ * Read a pixel of a BITMAP or TILED buffer.
+ */
+static bool pixel(IAFramebuffer &fb, int x, int y)
+{
+    if (fb.buffers()==IAFramebuffer::TILED)
+        return fb.pTiles->get(x, y);
+    return BM_UGET(fb.pBitmap, x, y)!=0;
+}
+
+
+/**
+ * Draw a rectangle in mm.
+ */
+static void drawRect(IAFramebuffer &fb, double x0, double y0, double x1, double y1, int color=1)
+{
+    fb.bindForRendering();
+    fb.beginComplexPolygon();
+    fb.addPoint(x0, y0);
+    fb.addPoint(x1, y0);
+    fb.addPoint(x1, y1);
+    fb.addPoint(x0, y1);
+    fb.endComplexPolygon(color);
+    fb.unbindFromRendering();
+}
+
+
+/**
+ * Check that no pixel outside of the dirty box is set, and that pixels are
+ * counted correctly.
+ *
+ * \param fb a bitmap buffer
+ * \param what the operation that was tested
+ * \param slack the box may be this many pixels larger than the set pixels
+ *      on every side, or -1 for any size
+ */
+static void checkBox(IAFramebuffer &fb, const char *what, int slack=2)
+{
+    int w = fb.width(), h = fb.height();
+    int x0 = w, y0 = h, x1 = 0, y1 = 0;
+    size_t n = 0;
+    for (int y=0; y<h; y++) {
+        for (int x=0; x<w; x++) {
+            if (!pixel(fb, x, y)) continue;
+            n++;
+            x0 = std::min(x0, x); x1 = std::max(x1, x+1);
+            y0 = std::min(y0, y); y1 = std::max(y1, y+1);
+        }
+    }
+    int bx0, by0, bx1, by1;
+    fb.dirtyBox(bx0, by0, bx1, by1);
+    bool inside = (n==0) || (bx0<=x0 && by0<=y0 && bx1>=x1 && by1>=y1);
+    bool tight = true;
+    if (slack>=0 && n==0)
+        tight = (bx0>=bx1 || by0>=by1);
+    else if (slack>=0)
+        tight = (x0-bx0<=slack && y0-by0<=slack && bx1-x1<=slack && by1-y1<=slack);
+    if (!inside || !tight || fb.countPixels()!=n)
+        printf("%s: %zu pixels in %d, %d, %d, %d; box %d, %d, %d, %d; %zu counted\n",
+               what, n, x0, y0, x1, y1, bx0, by0, bx1, by1, fb.countPixels());
+    IA_TEST_CHECK(inside);
+    IA_TEST_CHECK(tight);
+    IA_TEST_CHECK(fb.countPixels()==n);
+}
+
+
+/**
+ * Follow the dirty box of a buffer through drawing, filling, copying, and
+ * logic operations.
+ */
+static void testBuffer(IAFDMPrinter *printer, IAFramebuffer::Buffers type)
+{
+    IAFramebuffer::Buffers other = (type==IAFramebuffer::BITMAP)
+        ? IAFramebuffer::TILED : IAFramebuffer::BITMAP;
+
+    IAFramebuffer fb(printer, type);
+    fb.bindForRendering();
+    fb.fill(0);
+    fb.unbindFromRendering();
+    checkBox(fb, "empty");
+
+    drawRect(fb, 20.0, 30.0, 40.0, 60.0);
+    checkBox(fb, "draw");
+    size_t nRect = fb.countPixels();
+    IA_TEST_CHECK(nRect>0);
+
+    // clearing only visits the dirty box, so nothing may be left behind
+    fb.fill(0);
+    checkBox(fb, "clear");
+    drawRect(fb, 150.0, 150.0, 170.0, 180.0);
+    checkBox(fb, "draw after clear");
+    IA_TEST_CHECK(fb.countPixels()==nRect);
+    fb.fill(0);
+    drawRect(fb, 20.0, 30.0, 40.0, 60.0);
+
+    // copies keep the box, and the pixels
+    IAFramebuffer copy(&fb);
+    checkBox(copy, "copy");
+    IA_TEST_CHECK(copy.countPixels()==nRect);
+    IAFramebuffer converted(&fb, other);
+    checkBox(converted, "copy to the other type");
+    IA_TEST_CHECK(converted.countPixels()==nRect);
+
+    // the union grows the box, the intersection shrinks it
+    IAFramebuffer b(printer, other);
+    drawRect(b, 100.0, 100.0, 120.0, 130.0);
+    fb.logicOr(&b);
+    checkBox(fb, "or", -1);
+    IA_TEST_CHECK(fb.countPixels()==2*nRect);
+
+    IAFramebuffer c(printer, type);
+    drawRect(c, 30.0, 20.0, 110.0, 110.0);
+    IAFramebuffer d(&fb);
+    d.logicAnd(&c);
+    checkBox(d, "and");
+    d.logicAnd(&converted);
+    checkBox(d, "and again");
+    IAFramebuffer empty(printer, type);
+    d.logicAnd(&empty);
+    checkBox(d, "and with an empty buffer");
+
+    IAFramebuffer e(&fb);
+    e.logicAndNot(&c);
+    checkBox(e, "and not", -1);
+    e.logicXor(&c);
+    checkBox(e, "xor", -1);
+    e.logicXor(&e);
+    checkBox(e, "xor with itself", -1);
+
+    IAFramebuffer g(&converted, type);
+    g.expand(3.0);
+    checkBox(g, "expand");
+    g.contract(6.0);
+    checkBox(g, "contract", -1);
+    drawRect(g, 10.0, 10.0, 190.0, 190.0, 0);
+    checkBox(g, "draw with color 0", -1);
+
+    fb.fill(1);
+    checkBox(fb, "fill");
+    IA_TEST_CHECK(fb.countPixels()==(size_t)fb.width()*fb.height());
+    fb.fill(0);
+    checkBox(fb, "clear after fill");
+}
+
+
+/**
+ * No pixel of a bitmap buffer may be set outside of its dirty box, after any
+ * operation.
+ */
+int main(int argc, char **argv)
+{
+    IAFDMPrinter *printer = ia_test_printer(kPixelSize);
+    testBuffer(printer, IAFramebuffer::BITMAP);
+    testBuffer(printer, IAFramebuffer::TILED);
+    return ia_test_result("dirty_box_test");
+}
@@ -0,0 +1,176 @@
+//
+//  IATestEdgeCoverage.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "Iota.h"
+#include "geometry/IAMesh.h"
+#include "geometry/IAMeshSlice.h"
+#include "opengl/IAFramebuffer.h"
+#include "printer/IAFDMPrinter.h"
+#include "toolpath/IAToolpath.h"
+
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+
+/// how far traced outlines are from the rim
+struct Deviation {
+    double pMax = 0.0;      ///< largest distance of a traced point to the rim
+    double pSumSq = 0.0;    ///< sum of squared distances of traced points
+    size_t pN = 0;          ///< number of traced points
+    double pMaxMissed = 0.0;///< largest distance of a rim corner to the trace
+    double rms() const { return pN ? sqrt(pSumSq/pN) : 0.0; }
+};
+
+
+/**
+ * Distance of a point to a set of line segments in the xy plane.
+ *
+ * \param p the point
+ * \param seg start and end points of the segments, in pairs
+ */
+static double distanceToSegments(IAVector3d const& p, std::vector<IAVector3d> const& seg)
+{
+    double best = DBL_MAX;
+    for (size_t i=0; i+1<seg.size(); i+=2) {
+        double ax = seg[i].x(), ay = seg[i].y();
+        double dx = seg[i+1].x()-ax, dy = seg[i+1].y()-ay;
+        double len2 = dx*dx+dy*dy, t = 0.0;
+        if (len2>0.0)
+            t = std::min(1.0, std::max(0.0, ((p.x()-ax)*dx+(p.y()-ay)*dy)/len2));
+        double ex = ax+t*dx-p.x(), ey = ay+t*dy-p.y();
+        best = std::min(best, ex*ex+ey*ey);
+    }
+    return sqrt(best);
+}
+
+
+/**
+ * Convert a rim into line segments, closing every loop.
+ */
+static std::vector<IAVector3d> rimSegments(IAEdgeList const& rim)
+{
+    std::vector<IAVector3d> seg;
+    IAVector3d first, prev;
+    bool inLoop = false;
+    for (auto e: rim) {
+        if (!e) {
+            if (inLoop) { seg.push_back(prev); seg.push_back(first); }
+            inLoop = false;
+            continue;
+        }
+        IAVector3d const& p = e->pVertex[0]->pGlobalPosition;
+        if (inLoop) { seg.push_back(prev); seg.push_back(p); }
+        else first = p;
+        prev = p;
+        inLoop = true;
+    }
+    if (inLoop) { seg.push_back(prev); seg.push_back(first); }
+    return seg;
+}
+
+
+/**
+ * Compare a traced outline with the rim it was drawn from.
+ *
+ * Every traced motion is sampled at a few points along its length, and every
+ * rim corner must be near the trace as well, so that a missing loop shows.
+ */
+static void addDeviation(Deviation &d, std::vector<IAVector3d> const& rim,
+                         std::vector<IAVector3d> const& traced)
+{
+    for (size_t i=0; i+1<traced.size(); i+=2) {
+        for (int j=0; j<4; j++) {
+            IAVector3d p = traced[i] + (traced[i+1]-traced[i])*(j/4.0);
+            double dist = distanceToSegments(p, rim);
+            d.pMax = std::max(d.pMax, dist);
+            d.pSumSq += dist*dist;
+            d.pN++;
+        }
+    }
+    for (size_t i=0; i<rim.size(); i+=2)
+        d.pMaxMissed = std::max(d.pMaxMissed, distanceToSegments(rim[i], traced));
+}
+
+
+/**
+ * Slice a mesh at a few heights, draw and trace every slice, and measure
+ * how far the traced outline is from the rim.
+ *
+ * \param printer the printer that sets the raster; it is made the current
+ *      printer, because tracing converts pixels to mm with it
+ * \param coverage draw the slices with coverage, as slicing does, or draw
+ *      them with the plain scanline fill
+ */
+static Deviation traceSlices(IAMesh *mesh, IAFDMPrinter *printer,
+                             std::vector<double> const& zs, bool coverage)
+{
+    Iota.pCurrentPrinter = printer;
+    Deviation d;
+    IAMeshSlice slice(printer);
+    IAFramebuffer fb(printer, IAFramebuffer::BITMAP);
+    for (double z: zs) {
+        slice.setNewZ(z);
+        slice.generateRim(mesh);
+        fb.fill(0);
+        if (coverage) {
+            slice.tesselateAndDrawLid(&fb);
+        } else {
+            fb.bindForRendering();
+            fb.beginComplexPolygon();
+            for (auto e: slice.rim()) {
+                if (e) fb.addPoint(e->pVertex[0]->pGlobalPosition);
+                else fb.addGap();
+            }
+            fb.endComplexPolygon(1, false);
+            fb.unbindFromRendering();
+        }
+        IAToolpathListSP tp = fb.toolpathFromLasso(z);
+        IA_TEST_CHECK(tp!=nullptr);
+        addDeviation(d, rimSegments(slice.rim()), ia_test_motions(tp.get()));
+    }
+    return d;
+}
+
+
+/**
+ * Outlines traced from a raster with a quarter of the pixels, but with edge
+ * coverage, must be at least as close to the slice rim as outlines traced
+ * from the full raster without coverage.
+ */
+int main(int argc, char **argv)
+{
+    IAFDMPrinter *fine = ia_test_printer(0.05);
+    IAFDMPrinter *coarse = ia_test_printer(0.1);
+    std::vector<uint8_t> stl = ia_test_sphere_stl(20.0, 60, 120);
+    IAMesh *mesh = ia_test_load_stl(stl, fine);
+
+    std::vector<double> zs;
+    for (int i=1; i<8; i++) zs.push_back(i*5.0+0.05);
+
+    Deviation plain = traceSlices(mesh, fine, zs, false);
+    Deviation cov = traceSlices(mesh, coarse, zs, true);
+    printf("0.05 mm, no coverage: max %.4f mm, rms %.4f mm, max missed %.4f mm\n",
+           plain.pMax, plain.rms(), plain.pMaxMissed);
+    printf("0.10 mm, coverage:    max %.4f mm, rms %.4f mm, max missed %.4f mm\n",
+           cov.pMax, cov.rms(), cov.pMaxMissed);
+
+    IA_TEST_CHECK(cov.pN>0 && plain.pN>0);
+    // no point strays more than 3/4 of a coarse pixel, and on average the
+    // trace stays within a quarter pixel
+    IA_TEST_CHECK(cov.pMax<0.075);
+    IA_TEST_CHECK(cov.pMaxMissed<0.075);
+    IA_TEST_CHECK(cov.rms()<0.025);
+    // and it is no worse than the fine raster without coverage
+    IA_TEST_CHECK(cov.pMax<=plain.pMax);
+    IA_TEST_CHECK(cov.rms()<=plain.rms());
+
+    delete mesh;
+    return ia_test_result("edge_coverage_test");
+}
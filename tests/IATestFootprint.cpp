@@ -0,0 +1,97 @@
+//
+//  IATestFootprint.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "geometry/IAMesh.h"
+#include "opengl/IAFramebuffer.h"
+#include "printer/IAFDMPrinter.h"
+
+#include <math.h>
+
+
+/// pixel size of the test printer in mm
+static const double kPixelSize = 0.1;
+
+
+/**
+ * Draw the footprint of a mesh into a bitmap and a tiled buffer.
+ *
+ * \return the number of pixels of the footprint, or 0 if the buffers differ
+ */
+static size_t footprintPixels(IAFDMPrinter *printer, IAMesh *mesh)
+{
+    IAFramebuffer fb(printer, IAFramebuffer::BITMAP);
+    fb.drawFootprint(mesh);
+    IAFramebuffer tiled(printer, IAFramebuffer::TILED);
+    tiled.drawFootprint(mesh);
+    size_t n = fb.countPixels();
+    IA_TEST_CHECK(tiled.countPixels()==n);
+    return n;
+}
+
+
+/**
+ * A wide box on a narrow box covers the area of the wide box, and the
+ * narrow box where it reaches past the wide one.
+ */
+static void testBoxes(IAFDMPrinter *printer)
+{
+    std::vector<uint8_t> stl;
+    double stemLo[3] = { -5.0, -30.0, 0.0 }, stemHi[3] = { 5.0, 30.0, 20.0 };
+    double topLo[3] = { -25.0, -10.0, 20.0 }, topHi[3] = { 25.0, 10.0, 25.0 };
+    ia_test_add_box_stl(stl, stemLo, stemHi);
+    ia_test_add_box_stl(stl, topLo, topHi);
+    IAMesh *mesh = ia_test_load_stl(stl, printer);
+
+    // a pixel is covered if its center is inside the box
+    IAVector3d pos = mesh->position();
+    auto pixels = [&](double const lo[3], double const hi[3])->long {
+        auto col = [](double v) { return (long)ceil(v/kPixelSize-0.5); };
+        return (col(hi[0]+pos.x())-col(lo[0]+pos.x()))
+             * (col(hi[1]+pos.y())-col(lo[1]+pos.y()));
+    };
+    double crossLo[3] = { -5.0, -10.0, 0.0 }, crossHi[3] = { 5.0, 10.0, 0.0 };
+    size_t nExpected = (size_t)(pixels(stemLo, stemHi) + pixels(topLo, topHi)
+                                - pixels(crossLo, crossHi));
+    size_t n = footprintPixels(printer, mesh);
+    printf("boxes: %zu pixels, %zu expected\n", n, nExpected);
+    IA_TEST_CHECK(n==nExpected);
+    delete mesh;
+}
+
+
+/**
+ * The footprint of a cylinder is the polygon of its base.
+ */
+static void testCylinder(IAFDMPrinter *printer)
+{
+    const double r = 30.0;
+    const int nSegments = 48;
+    std::vector<uint8_t> stl = ia_test_cylinder_stl(r, 40.0, nSegments);
+    IAMesh *mesh = ia_test_load_stl(stl, printer);
+
+    double area = 0.5*nSegments*r*r*sin(2.0*M_PI/nSegments);
+    double expected = area/(kPixelSize*kPixelSize);
+    size_t n = footprintPixels(printer, mesh);
+    printf("cylinder: %zu pixels, %.0f expected\n", n, expected);
+    IA_TEST_CHECK(fabs(n-expected)<0.002*expected);
+    delete mesh;
+}
+
+
+/**
+ * IAFramebuffer::drawFootprint() must cover every pixel under a mesh, and
+ * no other pixels.
+ */
+int main(int argc, char **argv)
+{
+    IAFDMPrinter *printer = ia_test_printer(kPixelSize);
+    testBoxes(printer);
+    testCylinder(printer);
+    return ia_test_result("footprint_test");
+}
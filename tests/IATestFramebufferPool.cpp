@@ -0,0 +1,126 @@
+//
+//  IATestFramebufferPool.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "opengl/IAFramebuffer.h"
+#include "opengl/IAFramebufferPool.h"
+#include "potrace/bitmap.h"
+#include "printer/IAFDMPrinter.h"
+
+#include <memory>
+
+
+/**
+ * Draw a square into a buffer, so that it is returned to the pool with
+ * pixels set.
+ */
+static void drawSquare(IAFramebuffer &fb, double x, double y)
+{
+    fb.bindForRendering();
+    fb.beginComplexPolygon();
+    fb.addPoint(x, y);
+    fb.addPoint(x+20.0, y);
+    fb.addPoint(x+20.0, y+20.0);
+    fb.addPoint(x, y+20.0);
+    fb.endComplexPolygon(1);
+    fb.unbindFromRendering();
+}
+
+
+/**
+ * Count all set pixels of a dense bitmap, ignoring the dirty box.
+ */
+static size_t setPixels(IAFramebuffer &fb)
+{
+    size_t n = 0;
+    for (int y=0; y<fb.height(); y++)
+        for (int x=0; x<fb.width(); x++)
+            if (BM_UGET(fb.pBitmap, x, y)) n++;
+    return n;
+}
+
+
+/**
+ * Slicing layer after layer must reuse the same few bitmaps, and hand them
+ * out with all pixels clear.
+ */
+static void testReuse(IAFDMPrinter *printer)
+{
+    IAFramebufferPool &pool = IAFramebufferPool::shared();
+    pool.purge();
+    const int nLayers = 10, nBuffers = 3;
+    size_t nDirty = 0;
+    for (int i=0; i<nLayers; i++) {
+        std::vector<std::unique_ptr<IAFramebuffer>> fb;
+        for (int j=0; j<nBuffers; j++) {
+            fb.emplace_back(new IAFramebuffer(printer, IAFramebuffer::BITMAP));
+            fb.back()->bindForRendering();
+            nDirty += setPixels(*fb.back());
+            drawSquare(*fb.back(), 20.0+10*i, 20.0+30*j);
+        }
+        // a coarse mask and a tiled buffer for every layer
+        IAFramebuffer mask(printer, IAFramebuffer::BITMAP, IAFramebuffer::COARSE);
+        drawSquare(mask, 50.0, 50.0);
+        IAFramebuffer tiled(printer, IAFramebuffer::TILED);
+        drawSquare(tiled, 50.0, 50.0);
+    }
+    IAFramebufferPool::Stats s = pool.stats();
+    printf("reuse: %zu requests, %zu allocations, %zu in use, %zu high water, "
+           "%zu bytes pooled\n", s.requests, s.allocations, s.inUse,
+           s.inUseHighWater, pool.bytesPooled());
+    IA_TEST_CHECK(nDirty==0);
+    IA_TEST_CHECK(s.requests==(size_t)nLayers*(nBuffers+1));
+    IA_TEST_CHECK(s.allocations==(size_t)nBuffers+1);
+    IA_TEST_CHECK(s.inUse==0 && s.bytesInUse==0);
+    IA_TEST_CHECK(s.inUseHighWater==(size_t)nBuffers+1);
+    IA_TEST_CHECK(pool.bytesPooled()==s.bytesHighWater);
+}
+
+
+/**
+ * Bitmaps of a raster that changed its size are freed, not reused.
+ */
+static void testResize(IAFDMPrinter *printer, IAFDMPrinter *other)
+{
+    IAFramebufferPool &pool = IAFramebufferPool::shared();
+    pool.purge();
+    { IAFramebuffer fb(printer, IAFramebuffer::BITMAP); drawSquare(fb, 10.0, 10.0); }
+    { IAFramebuffer fb(printer, IAFramebuffer::BITMAP); drawSquare(fb, 10.0, 10.0); }
+    size_t pooled = pool.bytesPooled();
+    IA_TEST_CHECK(pool.stats().allocations==1);
+    IA_TEST_CHECK(pooled>0);
+
+    { IAFramebuffer fb(other, IAFramebuffer::BITMAP); drawSquare(fb, 10.0, 10.0); }
+    IA_TEST_CHECK(pool.stats().allocations==2);
+    IA_TEST_CHECK(pool.bytesPooled()!=pooled);
+    { IAFramebuffer fb(printer, IAFramebuffer::BITMAP); drawSquare(fb, 10.0, 10.0); }
+    IA_TEST_CHECK(pool.stats().allocations==3);
+    IA_TEST_CHECK(pool.bytesPooled()==pooled);
+    IA_TEST_CHECK(pool.stats().inUseHighWater==1);
+
+    // buffers that are in use while purging are still counted
+    IAFramebuffer fb(printer, IAFramebuffer::BITMAP);
+    fb.bindForRendering();
+    pool.purge();
+    IA_TEST_CHECK(pool.bytesPooled()==0);
+    IA_TEST_CHECK(pool.stats().inUse==1 && pool.stats().requests==0);
+}
+
+
+/**
+ * IAFramebufferPool must keep no more bitmaps than were in use at the same
+ * time, and reuse them for every following layer.
+ */
+int main(int argc, char **argv)
+{
+    IAFDMPrinter *printer = ia_test_printer(0.1);
+    IAFDMPrinter *other = ia_test_printer(0.2);
+    testReuse(printer);
+    testResize(printer, other);
+    return ia_test_result("framebuffer_pool_test");
+}
@@ -0,0 +1,229 @@
+//
+//  IATestIsoContours.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "opengl/IAFramebuffer.h"
+#include "opengl/IAIsoContours.h"
+#include "printer/IAFDMPrinter.h"
+#include "toolpath/IAToolpath.h"
+
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+
+/// pixel size of the test printer in mm
+static const double kPixelSize = 0.1;
+
+
+/**
+ * Signed area of a loop, positive if it is counterclockwise.
+ */
+static double loopArea(IAIsoContours::Loop const& loop)
+{
+    double a = 0.0;
+    for (size_t i=0, j=loop.size()-1; i<loop.size(); j=i++)
+        a += loop[j].first*loop[i].second - loop[i].first*loop[j].second;
+    return 0.5*a;
+}
+
+
+/**
+ * The contours of a cone are circles, one per level, with the area above
+ * the level on the left.
+ */
+static void testCone()
+{
+    const int n = 201;
+    const double c = 100.0, r = 90.0, step = 7.5;
+    std::vector<double> field((size_t)n*n);
+    for (int y=0; y<n; y++)
+        for (int x=0; x<n; x++)
+            field[(size_t)y*n+x] = r - sqrt((x-c)*(x-c)+(y-c)*(y-c));
+
+    IAIsoContours contours(field.data(), n, n);
+    contours.extract(step, 0.25);
+    IA_TEST_CHECK(contours.levels()==(int)ceil(r/step));
+    double maxError = 0.0;
+    for (int k=0; k<contours.levels(); k++) {
+        auto const& loops = contours.loops(k);
+        IA_TEST_CHECK(loops.size()==1);
+        for (auto const& loop: loops) {
+            IA_TEST_CHECK(loopArea(loop)>0.0);
+            for (auto const& p: loop) {
+                double d = sqrt((p.first-c)*(p.first-c)+(p.second-c)*(p.second-c));
+                maxError = std::max(maxError, fabs(d-(r-k*step)));
+            }
+        }
+    }
+    printf("cone: %d levels, %.3f samples max radius error\n", contours.levels(), maxError);
+    IA_TEST_CHECK(maxError<0.3);
+}
+
+
+/**
+ * Two cones merge into one loop below the saddle between them, and split
+ * into two loops above it. Loops that are too small are dropped.
+ */
+static void testTwoPeaks()
+{
+    const int w = 181, h = 101;
+    std::vector<double> field((size_t)w*h);
+    for (int y=0; y<h; y++) {
+        for (int x=0; x<w; x++) {
+            double d1 = sqrt((x-55.0)*(x-55.0)+(y-50.0)*(y-50.0));
+            double d2 = sqrt((x-125.0)*(x-125.0)+(y-50.0)*(y-50.0));
+            field[(size_t)y*w+x] = 42.0 - std::min(d1, d2);
+        }
+    }
+    IAIsoContours contours(field.data(), w, h);
+    contours.extract(4.0, 0.25);
+    // the loops at 40 have a radius of 2 and are dropped like specks
+    IA_TEST_CHECK(contours.levels()==10);
+    for (int k=0; k<contours.levels(); k++) {
+        // the saddle is at 42-35 = 7
+        size_t expected = (k*4.0<7.0) ? 1 : 2;
+        IA_TEST_CHECK(contours.loops(k).size()==expected);
+    }
+}
+
+
+/**
+ * Find the mean radius of a loop around a center, and how far its points
+ * stray from that radius.
+ */
+static void loopRadius(IAToolpath *t, double cx, double cy, double &mean, double &maxError)
+{
+    std::vector<double> r;
+    for (auto e: t->pElementList) {
+        IAToolpathMotion *m = dynamic_cast<IAToolpathMotion*>(e);
+        if (m && !m->pIsRapid)
+            r.push_back(sqrt((m->pEnd.x()-cx)*(m->pEnd.x()-cx)+(m->pEnd.y()-cy)*(m->pEnd.y()-cy)));
+    }
+    mean = 0.0;
+    for (double v: r) mean += v;
+    mean /= std::max(r.size(), (size_t)1);
+    maxError = 0.0;
+    for (double v: r) maxError = std::max(maxError, fabs(v-mean));
+}
+
+
+/**
+ * Distance of a point to a set of line segments in the xy plane.
+ *
+ * \param p the point
+ * \param seg start and end points of the segments, in pairs
+ */
+static double distanceToSegments(IAVector3d const& p, std::vector<IAVector3d> const& seg)
+{
+    double best = DBL_MAX;
+    for (size_t i=0; i+1<seg.size(); i+=2) {
+        double ax = seg[i].x(), ay = seg[i].y();
+        double dx = seg[i+1].x()-ax, dy = seg[i+1].y()-ay;
+        double len2 = dx*dx+dy*dy, t = 0.0;
+        if (len2>0.0)
+            t = std::min(1.0, std::max(0.0, ((p.x()-ax)*dx+(p.y()-ay)*dy)/len2));
+        double ex = ax+t*dx-p.x(), ey = ay+t*dy-p.y();
+        best = std::min(best, ex*ex+ey*ey);
+    }
+    return sqrt(best);
+}
+
+
+/**
+ * Largest distance of any point of one outline to another outline, both
+ * ways.
+ */
+static double outlineDistance(std::vector<IAVector3d> const& a, std::vector<IAVector3d> const& b)
+{
+    double d = 0.0;
+    for (auto const& p: a) d = std::max(d, distanceToSegments(p, b));
+    for (auto const& p: b) d = std::max(d, distanceToSegments(p, a));
+    return d;
+}
+
+
+/**
+ * The rings of a disk with a hole are concentric circles, exactly w apart,
+ * and the outermost ring is the traced outline.
+ */
+static void testRings(IAFDMPrinter *printer)
+{
+    const double cx = 100.0, cy = 100.0, rOut = 20.0, rIn = 8.0, w = 0.4;
+    IAFramebuffer fb(printer, IAFramebuffer::BITMAP);
+    fb.bindForRendering();
+    fb.fill(0);
+    fb.beginComplexPolygon();
+    for (int i=0; i<720; i++) {
+        double a = 2.0*M_PI*i/720;
+        fb.addPoint(cx+rOut*cos(a), cy+rOut*sin(a));
+    }
+    fb.addGap();
+    for (int i=0; i<720; i++) {
+        double a = -2.0*M_PI*i/720;
+        fb.addPoint(cx+rIn*cos(a), cy+rIn*sin(a));
+    }
+    fb.endComplexPolygon(1);
+    fb.unbindFromRendering();
+
+    IAFramebuffer lasso(&fb);
+    IAToolpathListSP outline = lasso.toolpathFromLasso(0.2);
+    std::vector<IAToolpathListSP> rings = fb.toolpathFromConcentricRings(0.2, w);
+
+    // the rings meet half way between the outer and the inner circle
+    int nExpected = (int)ceil((rOut-rIn)/2.0/w);
+    IA_TEST_CHECK(outline!=nullptr);
+    IA_TEST_CHECK(abs((int)rings.size()-nExpected)<=1);
+    if (!outline || rings.empty()) return;
+
+    // level 0 is the outline
+    double d0 = outlineDistance(ia_test_motions(rings[0].get()),
+                                ia_test_motions(outline.get()));
+    printf("rings: %zu rings, ring 0 is %.3f mm from the traced outline\n",
+           rings.size(), d0);
+    IA_TEST_CHECK(d0<kPixelSize);
+
+    // every ring is a circle along the outer and one along the inner
+    // border; like the traced outline, the rings follow the pixel steps of
+    // the drawn circle by about a pixel
+    double prevOut = 0.0, prevIn = 0.0, maxRound = 0.0, maxSpacing = 0.0;
+    for (size_t k=0; k+1<rings.size(); k++) {
+        auto const& loops = rings[k]->pToolpathList;
+        IA_TEST_CHECK(loops.size()==2);
+        if (loops.size()!=2) continue;
+        double r[2], e[2];
+        for (int j=0; j<2; j++) {
+            loopRadius(loops[j], cx, cy, r[j], e[j]);
+            maxRound = std::max(maxRound, e[j]);
+        }
+        double out = std::max(r[0], r[1]), in = std::min(r[0], r[1]);
+        if (k>0) {
+            maxSpacing = std::max(maxSpacing, fabs(prevOut-out-w));
+            maxSpacing = std::max(maxSpacing, fabs(in-prevIn-w));
+        }
+        prevOut = out; prevIn = in;
+    }
+    printf("rings: %.3f mm max deviation from a circle, "
+           "%.4f mm max deviation from w between rings\n", maxRound, maxSpacing);
+    IA_TEST_CHECK(maxRound<1.5*kPixelSize);
+    IA_TEST_CHECK(maxSpacing<0.25*kPixelSize);
+}
+
+
+/**
+ * IAIsoContours must find all contour lines of a field, and concentric rings
+ * must be spaced exactly w apart, starting at the traced outline.
+ */
+int main(int argc, char **argv)
+{
+    IAFDMPrinter *printer = ia_test_printer(kPixelSize);
+    testCone();
+    testTwoPeaks();
+    testRings(printer);
+    return ia_test_result("iso_contours_test");
+}
@@ -0,0 +1,241 @@
+//
+//  IATestMeshCache.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "Iota.h"
+#include "fileformats/IAGeometryReader.h"
+#include "fileformats/IAGeometryReaderMeshCache.h"
+#include "geometry/IAMesh.h"
+
+#include <FL/filename.H>
+#include <FL/fl_utf8.h>
+
+#include <unordered_map>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+# include <sys/utime.h>
+# define utime _utime
+# define utimbuf _utimbuf
+#else
+# include <utime.h>
+#endif
+
+
+/// all files of this test go here, below the current directory
+static const char *kDir = "mesh_cache_test.tmp/";
+
+
+/**
+ * Write a file, and set its modification time.
+ */
+static void writeFile(const char *name, std::vector<uint8_t> const& data, time_t mtime)
+{
+    FILE *f = fl_fopen(name, "wb");
+    IA_TEST_CHECK(f!=nullptr);
+    if (!f) return;
+    fwrite(data.data(), 1, data.size(), f);
+    fclose(f);
+    struct utimbuf t = { mtime, mtime };
+    utime(name, &t);
+}
+
+
+/**
+ * Load a model file the slow way.
+ */
+static IAMesh *parse(const char *name)
+{
+    auto reader = IAGeometryReader::findReaderFor(name);
+    IA_TEST_CHECK(reader!=nullptr);
+    return reader ? reader->load() : nullptr;
+}
+
+
+/**
+ * Load a model from the cache.
+ *
+ * \return nullptr if there is no cache file, or if it is damaged
+ */
+static IAMesh *restore(const char *name)
+{
+    auto reader = IAGeometryReaderMeshCache::findReaderFor(name);
+    if (!reader) return nullptr;
+    IAMesh *mesh = reader->load();
+    if (!mesh) Iota.Error.clear();
+    return mesh;
+}
+
+
+/**
+ * Compare two meshes, including the order of vertices and the links between
+ * half-edges.
+ *
+ * \return true if they are the same
+ */
+static bool sameMesh(IAMesh *a, IAMesh *b)
+{
+    if (!a || !b) return false;
+    if (a->vertexList.size()!=b->vertexList.size()) return false;
+    if (a->triangleList.size()!=b->triangleList.size()) return false;
+    if (a->edgeList.size()!=b->edgeList.size()) return false;
+    if (!(a->pMin==b->pMin) || !(a->pMax==b->pMax)) return false;
+    std::unordered_map<IAHalfEdge*, size_t> ea, eb;
+    for (size_t i=0; i<a->edgeList.size(); i++) {
+        ea[a->edgeList[i]] = i;
+        eb[b->edgeList[i]] = i;
+    }
+    for (size_t i=0; i<a->triangleList.size(); i++) {
+        IATriangle *ta = a->triangleList[i], *tb = b->triangleList[i];
+        if (!(ta->pNormal==tb->pNormal)) return false;
+        for (int j=0; j<3; j++) {
+            IAVertex *va = ta->vertex(j), *vb = tb->vertex(j);
+            if (!(va->pLocalPosition==vb->pLocalPosition)) return false;
+            if (!(va->pNormal==vb->pNormal)) return false;
+            IAHalfEdge *twa = ta->edge(j)->twin(), *twb = tb->edge(j)->twin();
+            if ((twa==nullptr)!=(twb==nullptr)) return false;
+            if (twa && ea[twa]!=eb[twb]) return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * A cached mesh must be restored exactly, and only while its source file is
+ * unchanged.
+ */
+static void testRoundTrip()
+{
+    std::string stlName = std::string(kDir) + "sphere.stl";
+    std::vector<uint8_t> stl = ia_test_sphere_stl(20.0, 20, 40);
+    writeFile(stlName.c_str(), stl, 1000000000);
+
+    IAMesh *parsed = parse(stlName.c_str());
+    IA_TEST_CHECK(parsed!=nullptr);
+    IA_TEST_CHECK(restore(stlName.c_str())==nullptr);
+    IA_TEST_CHECK(IAGeometryReaderMeshCache::write(stlName.c_str(), parsed));
+
+    IAMesh *cached = restore(stlName.c_str());
+    IA_TEST_CHECK(sameMesh(parsed, cached));
+    delete cached;
+
+    // a touched file with the same content still finds its cache file
+    writeFile(stlName.c_str(), stl, 1000000100);
+    cached = restore(stlName.c_str());
+    IA_TEST_CHECK(sameMesh(parsed, cached));
+    delete cached;
+
+    // a file with the same size, but different content, does not
+    std::vector<uint8_t> other = ia_test_sphere_stl(21.0, 20, 40);
+    IA_TEST_CHECK(other.size()==stl.size());
+    writeFile(stlName.c_str(), other, 1000000200);
+    IA_TEST_CHECK(restore(stlName.c_str())==nullptr);
+    delete parsed;
+    fl_unlink(stlName.c_str());
+}
+
+
+/**
+ * Twins that don't point back at each other must make the reader fail, so
+ * that the app parses the source file instead.
+ */
+static void testDamagedTwins()
+{
+    std::string stlName = std::string(kDir) + "cylinder.stl";
+    std::vector<uint8_t> stl = ia_test_cylinder_stl(10.0, 20.0, 24);
+    writeFile(stlName.c_str(), stl, 1000000000);
+    IAMesh *parsed = parse(stlName.c_str());
+    IA_TEST_CHECK(IAGeometryReaderMeshCache::write(stlName.c_str(), parsed));
+    IAMesh *cached = restore(stlName.c_str());
+    IA_TEST_CHECK(sameMesh(parsed, cached));
+    delete cached;
+
+    // swap two twin indices at the end of the file
+    char cacheName[FL_PATH_MAX];
+    IAGeometryReaderMeshCache::cacheFilename(cacheName, sizeof(cacheName), stlName.c_str());
+    struct stat st;
+    IA_TEST_CHECK(fl_stat(cacheName, &st)==0);
+    FILE *f = fl_fopen(cacheName, "r+b");
+    IA_TEST_CHECK(f!=nullptr);
+    if (f) {
+        uint32_t twin[2];
+        fseek(f, (long)st.st_size-8, SEEK_SET);
+        IA_TEST_CHECK(fread(twin, 4, 2, f)==2);
+        IA_TEST_CHECK(twin[0]!=twin[1]);
+        std::swap(twin[0], twin[1]);
+        fseek(f, (long)st.st_size-8, SEEK_SET);
+        fwrite(twin, 4, 2, f);
+        fclose(f);
+    }
+    IA_TEST_CHECK(IAGeometryReaderMeshCache::findReaderFor(stlName.c_str())!=nullptr);
+    IA_TEST_CHECK(restore(stlName.c_str())==nullptr);
+    delete parsed;
+    fl_unlink(stlName.c_str());
+}
+
+
+/**
+ * Trimming the cache removes the files that were not used for the longest
+ * time.
+ */
+static void testTrim()
+{
+    IAGeometryReaderMeshCache::trim(0);
+    const int n = 4;
+    std::vector<std::string> names;
+    uint64_t size = 0;
+    for (int i=0; i<n; i++) {
+        char buf[FL_PATH_MAX], cacheName[FL_PATH_MAX];
+        snprintf(buf, sizeof(buf), "%spart%d.stl", kDir, i);
+        names.push_back(buf);
+        std::vector<uint8_t> stl = ia_test_cylinder_stl(5.0+i, 10.0, 12);
+        writeFile(buf, stl, 1000000000);
+        IAMesh *mesh = parse(buf);
+        IA_TEST_CHECK(IAGeometryReaderMeshCache::write(buf, mesh));
+        delete mesh;
+        // file 1 was used last, file 0 before it, and so on
+        IAGeometryReaderMeshCache::cacheFilename(cacheName, sizeof(cacheName), buf);
+        time_t t = 1000000000 + (i==1 ? 10 : i==0 ? 9 : 5-i);
+        struct utimbuf ut = { t, t };
+        utime(cacheName, &ut);
+        struct stat st;
+        if (fl_stat(cacheName, &st)==0) size = std::max(size, (uint64_t)st.st_size);
+    }
+    IAGeometryReaderMeshCache::trim(2*size);
+    IAMesh *m;
+    IA_TEST_CHECK((m = restore(names[0].c_str()))!=nullptr); delete m;
+    IA_TEST_CHECK((m = restore(names[1].c_str()))!=nullptr); delete m;
+    IA_TEST_CHECK(restore(names[2].c_str())==nullptr);
+    IA_TEST_CHECK(restore(names[3].c_str())==nullptr);
+
+    IAGeometryReaderMeshCache::trim(0);
+    for (auto const& name: names) {
+        IA_TEST_CHECK(restore(name.c_str())==nullptr);
+        fl_unlink(name.c_str());
+    }
+}
+
+
+/**
+ * IAGeometryReaderMeshCache must restore the meshes that it wrote, notice
+ * changed or damaged files, and keep the cache within its size.
+ */
+int main(int argc, char **argv)
+{
+    fl_make_path(kDir);
+    free(Iota.gPreferences.pMeshCachePath);
+    Iota.gPreferences.pMeshCachePath = strdup(kDir);
+
+    testRoundTrip();
+    testDamagedTwins();
+    testTrim();
+    return ia_test_result("mesh_cache_test");
+}
@@ -0,0 +1,128 @@
+//
+//  IATestParallel.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "app/IAParallel.h"
+
+#include <atomic>
+#include <thread>
+#include <stdlib.h>
+
+
+/**
+ * Every element is visited exactly once, also in loops that are started
+ * from within a loop.
+ */
+static void testCoverage()
+{
+    for (size_t n: { 0, 1, 7, 1000, 100001 }) {
+        std::vector<std::atomic<int>> hits(n);
+        ia_parallel_for(n, [&](size_t b, size_t e) {
+            for (size_t i=b; i<e; i++) hits[i]++;
+        }, 16);
+        size_t nWrong = 0;
+        for (auto &h: hits) if (h!=1) nWrong++;
+        IA_TEST_CHECK(nWrong==0);
+    }
+
+    const size_t n = 64, m = 5000;
+    std::vector<std::atomic<int>> hits(n*m);
+    ia_parallel_for(n, [&](size_t b, size_t e) {
+        for (size_t i=b; i<e; i++) {
+            ia_parallel_for(m, [&](size_t b2, size_t e2) {
+                for (size_t j=b2; j<e2; j++) hits[i*m+j]++;
+            }, 16);
+        }
+    }, 1);
+    size_t nWrong = 0;
+    for (auto &h: hits) if (h!=1) nWrong++;
+    IA_TEST_CHECK(nWrong==0);
+}
+
+
+/**
+ * Loops that are started from several threads at the same time must not
+ * mix up their tasks.
+ */
+static void testConcurrentCallers()
+{
+    const int nCallers = 4, nLoops = 200;
+    std::atomic<int> nWrong { 0 };
+    std::vector<std::thread> callers;
+    for (int c=0; c<nCallers; c++) {
+        callers.emplace_back([&nWrong, c]() {
+            for (int k=0; k<nLoops; k++) {
+                size_t n = 1000+100*c+k;
+                std::atomic<size_t> sum { 0 };
+                ia_parallel_for(n, [&](size_t b, size_t e) {
+                    size_t s = 0;
+                    for (size_t i=b; i<e; i++) s += i;
+                    sum += s;
+                }, 16);
+                if (sum!=n*(n-1)/2) nWrong++;
+            }
+        });
+    }
+    for (auto &t: callers) t.join();
+    IA_TEST_CHECK(nWrong==0);
+}
+
+
+/**
+ * ia_parallel_sort() must sort like std::sort, for any number of chunks.
+ */
+static void testSort()
+{
+    srand(1);
+    for (size_t n: { 10, 16384*3+5, 200000 }) {
+        std::vector<int> v(n);
+        for (auto &x: v) x = rand()%100000;
+        std::vector<int> ref = v;
+        std::sort(ref.begin(), ref.end());
+        ia_parallel_sort(v, std::less<int>());
+        IA_TEST_CHECK(v==ref);
+    }
+}
+
+
+/**
+ * Many small loops in a row reuse the same workers; this is the case that
+ * used to start and join a thread per chunk every time.
+ */
+static void testManyLoops()
+{
+    const int nLoops = 20000;
+    std::vector<int> data(256, 1);
+    std::atomic<long> sum { 0 };
+    double t0 = ia_test_seconds();
+    for (int k=0; k<nLoops; k++) {
+        ia_parallel_for(data.size(), [&](size_t b, size_t e) {
+            long s = 0;
+            for (size_t i=b; i<e; i++) s += data[i];
+            sum += s;
+        }, 16);
+    }
+    double t = ia_test_seconds()-t0;
+    printf("%d loops on %zu threads: %.1f us per loop\n", nLoops,
+           IAThreadPool::shared().size(), t/nLoops*1e6);
+    IA_TEST_CHECK(sum==(long)nLoops*(long)data.size());
+}
+
+
+/**
+ * ia_parallel_for() and ia_parallel_sort() must give the same results as
+ * serial loops, no matter how they are nested or who calls them.
+ */
+int main(int argc, char **argv)
+{
+    testCoverage();
+    testConcurrentCallers();
+    testSort();
+    testManyLoops();
+    return ia_test_result("parallel_test");
+}
@@ -0,0 +1,116 @@
+//
+//  IATestParallelSlicing.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "app/IAParallel.h"
+#include "geometry/IACompactMesh.h"
+#include "geometry/IAMesh.h"
+#include "geometry/IAMeshSlice.h"
+#include "printer/IAFDMPrinter.h"
+
+
+/// one rim as a flat list of coordinates
+typedef std::vector<double> Outline;
+
+/// stands in for the nullptr that ends a loop
+static const double kEndOfLoop = -1e300;
+
+
+/**
+ * Copy the rim of a slice, so it can be compared after the slice is gone.
+ */
+static void recordRim(IAMeshSlice const& slice, Outline &outline)
+{
+    outline.clear();
+    for (auto e: slice.rim()) {
+        if (!e) {
+            outline.push_back(kEndOfLoop);
+            continue;
+        }
+        for (int j=0; j<2; j++) {
+            IAVector3d const& g = e->pVertex[j]->pGlobalPosition;
+            IAVector3d const& l = e->pVertex[j]->pLocalPosition;
+            outline.insert(outline.end(), { g.x(), g.y(), g.z(), l.x(), l.y(), l.z() });
+        }
+    }
+}
+
+
+/**
+ * Slice all layers of a mesh on one thread, and again on all threads.
+ *
+ * Every thread reuses a single slice for all its layers, just like the
+ * serial run, so stale flags from an earlier layer would show as well.
+ *
+ * \param label name of the mesh type
+ * \param printer slices are created for this printer
+ * \param nLayers, layerHeight number and height of the layers
+ * \param rim called as rim(slice, z) to create the rim of a layer
+ */
+template <class F>
+static void compareSerialAndParallel(const char *label, IAFDMPrinter *printer,
+                                     int nLayers, double layerHeight, F rim)
+{
+    std::vector<Outline> serial(nLayers), parallel(nLayers);
+
+    IAMeshSlice slice(printer);
+    for (int i=0; i<nLayers; i++) {
+        rim(slice, (i+0.5)*layerHeight);
+        recordRim(slice, serial[i]);
+    }
+
+    ia_parallel_for((size_t)nLayers, [&](size_t b, size_t e) {
+        IAMeshSlice threadSlice(printer);
+        for (size_t i=b; i<e; i++) {
+            rim(threadSlice, (i+0.5)*layerHeight);
+            recordRim(threadSlice, parallel[i]);
+        }
+    }, 1);
+
+    int nEmpty = 0, nDifferent = 0;
+    for (int i=0; i<nLayers; i++) {
+        if (serial[i].empty()) nEmpty++;
+        if (serial[i]!=parallel[i]) nDifferent++;
+    }
+    printf("%s: %d layers, %d empty, %d different\n", label, nLayers, nEmpty, nDifferent);
+    IA_TEST_CHECK(nEmpty==0);
+    IA_TEST_CHECK(nDifferent==0);
+}
+
+
+/**
+ * Slicing a shared mesh on many threads must give exactly the same rims as
+ * slicing it on one thread.
+ */
+int main(int argc, char **argv)
+{
+    IAFDMPrinter *printer = ia_test_printer();
+    std::vector<uint8_t> stl = ia_test_sphere_stl(20.0, 90, 180);
+    IAMesh *mesh = ia_test_load_stl(stl, printer);
+    const IAMesh *sharedMesh = mesh;
+    double layerHeight = 0.1;
+    int nLayers = (int)(40.0/layerHeight);
+
+    compareSerialAndParallel("IAMesh", printer, nLayers, layerHeight,
+                             [sharedMesh](IAMeshSlice &slice, double z) {
+        slice.setNewZ(z);
+        slice.generateRim(sharedMesh);
+    });
+
+    IACompactMesh compact;
+    compact.fromMesh(mesh);
+    const IACompactMesh *sharedCompact = &compact;
+    compareSerialAndParallel("IACompactMesh", printer, nLayers, layerHeight,
+                             [sharedCompact](IAMeshSlice &slice, double z) {
+        slice.setNewZ(z);
+        slice.addRim(sharedCompact);
+    });
+
+    delete mesh;
+    return ia_test_result("parallel_slicing_test");
+}
@@ -0,0 +1,176 @@
+//
+//  IATestRunLengthBitmap.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "opengl/IAFramebuffer.h"
+#include "opengl/IARunLengthBitmap.h"
+#include "printer/IAFDMPrinter.h"
+#include "potrace/bitmap.h"
+
+#include <math.h>
+
+
+/**
+ * Adding runs merges neighbours and keeps empty rows empty.
+ */
+static void testAddRun()
+{
+    IARunLengthBitmap rle(100, 50);
+    IA_TEST_CHECK(rle.empty());
+    int x0, y0, x1, y1, n;
+    rle.box(x0, y0, x1, y1);
+    IA_TEST_CHECK(x0==0 && y0==0 && x1==0 && y1==0);
+    IA_TEST_CHECK(rle.row(0, n)==nullptr && n==0);
+
+    rle.addRun(10, 5, 5);       // empty, ignored
+    IA_TEST_CHECK(rle.empty());
+    rle.addRun(10, 5, 8);
+    rle.addRun(10, 8, 12);      // touches, merged
+    rle.addRun(10, 20, 30);
+    rle.addRun(13, 0, 100);     // rows 11 and 12 stay empty
+
+    IA_TEST_CHECK(rle.firstRow()==10);
+    IA_TEST_CHECK(rle.lastRow()==14);
+    const int32_t *r = rle.row(10, n);
+    IA_TEST_CHECK(r && n==2);
+    if (r && n==2)
+        IA_TEST_CHECK(r[0]==5 && r[1]==12 && r[2]==20 && r[3]==30);
+    IA_TEST_CHECK(rle.row(11, n)==nullptr && n==0);
+    IA_TEST_CHECK(rle.row(12, n)==nullptr && n==0);
+    r = rle.row(13, n);
+    IA_TEST_CHECK(r && n==1 && r[0]==0 && r[1]==100);
+    IA_TEST_CHECK(rle.row(9, n)==nullptr && n==0);
+    IA_TEST_CHECK(rle.row(14, n)==nullptr && n==0);
+
+    rle.box(x0, y0, x1, y1);
+    IA_TEST_CHECK(x0==0 && y0==10 && x1==100 && y1==14);
+    IA_TEST_CHECK(rle.countPixels()==7+10+100);
+    IA_TEST_CHECK(rle.memoryUsed()>=sizeof(rle));
+
+    rle.clear();
+    IA_TEST_CHECK(rle.empty() && rle.countPixels()==0);
+}
+
+
+/**
+ * Draw a few overlapping stars, rings, and boxes, some of them reaching past
+ * the left and right border of the buffer, where words are cut off.
+ *
+ * The fill clips to the width, but not to the height of a buffer, so all
+ * shapes stay between the top and the bottom.
+ */
+static void drawShapes(IAFramebuffer &fb, uint32_t seed)
+{
+    auto rnd = [&seed](double lo, double hi) {
+        seed = seed*1664525u + 1013904223u;
+        return lo + (hi-lo)*(seed>>8)/16777216.0;
+    };
+    fb.bindForRendering();  // creates the buffer, so its size is known
+    fb.fill(0);
+    double wMM = fb.width()*0.5, hMM = fb.height()*0.5; // 0.5 mm pixels
+    for (int s=0; s<6; s++) {
+        double r = rnd(5, 40), cx = rnd(0, wMM), cy = rnd(r+1, hMM-r-1);
+        int n = (int)rnd(5, 40);
+        fb.beginComplexPolygon();
+        for (int i=0; i<n; i++) {
+            double a = 2.0*M_PI*i/n, ri = (i&1) ? r*rnd(0.3, 1.0) : r;
+            fb.addPoint(cx+ri*cos(a), cy+ri*sin(a));
+        }
+        fb.addGap();
+        for (int i=0; i<n; i++) {   // a hole
+            double a = 2.0*M_PI*i/n;
+            fb.addPoint(cx+0.2*r*cos(a), cy+0.2*r*sin(a));
+        }
+        fb.endComplexPolygon(s==4 ? 0 : 1);
+    }
+    fb.beginComplexPolygon();
+    fb.addPoint(wMM-40.0, 10.0); fb.addPoint(wMM+5.0, 10.0);
+    fb.addPoint(wMM+5.0, 30.0); fb.addPoint(wMM-40.0, 30.0);
+    fb.endComplexPolygon(1);
+    fb.unbindFromRendering();
+}
+
+
+/**
+ * Compare every row of a run-length bitmap to a dense bitmap.
+ */
+static void checkRuns(IARunLengthBitmap const& rle, potrace_bitmap_t *bm)
+{
+    size_t nSet = 0, nBad = 0;
+    for (int y=0; y<bm->h; y++) {
+        int n;
+        const int32_t *r = rle.row(y, n);
+        int k = 0, prevEnd = -1;
+        for (int i=0; i<n; i++) {
+            if (r[2*i]<=prevEnd || r[2*i]>=r[2*i+1] || r[2*i+1]>bm->w) nBad++;
+            prevEnd = r[2*i+1];
+        }
+        for (int x=0; x<bm->w; x++) {
+            while (k<n && r[2*k+1]<=x) k++;
+            bool inRun = (k<n && r[2*k]<=x);
+            bool set = BM_UGET(bm, x, y);
+            if (set) nSet++;
+            if (set!=inRun) nBad++;
+        }
+    }
+    IA_TEST_CHECK(nSet>0);
+    IA_TEST_CHECK(nBad==0);
+    IA_TEST_CHECK(rle.countPixels()==nSet);
+}
+
+
+/**
+ * Convert a buffer to runs and back, and OR the runs into a buffer that
+ * has pixels already.
+ */
+static void testRoundTrip(IAFDMPrinter *printer, IAFramebuffer::Buffers type)
+{
+    IAFramebuffer ref(printer, IAFramebuffer::BITMAP);
+    IAFramebuffer fb(printer, type);
+    for (uint32_t seed=1; seed<5; seed++) {
+        drawShapes(ref, seed);
+        drawShapes(fb, seed);
+        IARunLengthBitmap *rle = fb.createRunLengthBitmap();
+        IA_TEST_CHECK(rle!=nullptr);
+        if (!rle) continue;
+        checkRuns(*rle, ref.pBitmap);
+        IA_TEST_CHECK(rle->countPixels()==fb.countPixels());
+
+        // OR into an empty buffer restores the original
+        IAFramebuffer dst(printer, IAFramebuffer::BITMAP);
+        dst.fill(0);
+        dst.logicOr(*rle);
+        IARunLengthBitmap *again = dst.createRunLengthBitmap();
+        checkRuns(*again, ref.pBitmap);
+        delete again;
+
+        // OR into other shapes gives the union
+        drawShapes(dst, seed+100);
+        IAFramebuffer other(&dst);
+        dst.logicOr(*rle);
+        other.logicOr(&ref);
+        IA_TEST_CHECK(dst.countPixels()==other.countPixels());
+        other.logicXor(&dst);
+        IA_TEST_CHECK(other.countPixels()==0);
+        delete rle;
+    }
+}
+
+
+/**
+ * IARunLengthBitmap must store exactly the pixels of the buffer it was
+ * created from.
+ */
+int main(int argc, char **argv)
+{
+    IAFDMPrinter *printer = ia_test_printer(0.5);
+    testAddRun();
+    testRoundTrip(printer, IAFramebuffer::BITMAP);
+    testRoundTrip(printer, IAFramebuffer::TILED);
+    return ia_test_result("run_length_bitmap_test");
+}
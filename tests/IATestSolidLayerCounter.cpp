@@ -0,0 +1,164 @@
+//
+//  IATestSolidLayerCounter.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "opengl/IAFramebuffer.h"
+#include "opengl/IASolidLayerCounter.h"
+#include "printer/IAFDMPrinter.h"
+#include "potrace/bitmap.h"
+
+#include <math.h>
+#include <algorithm>
+
+
+/// pixel size of the test printer in mm
+static const double kPixelSize = 0.5;
+
+
+/**
+ * Draw a disk, or clear it if color is 0.
+ */
+static void drawDisk(IAFramebuffer &fb, double cx, double cy, double r, int color)
+{
+    fb.beginComplexPolygon();
+    for (int i=0; i<48; i++) {
+        double a = 2.0*M_PI*i/48;
+        fb.addPoint(cx+r*cos(a), cy+r*sin(a));
+    }
+    fb.endComplexPolygon(color);
+}
+
+
+/**
+ * Create the core patterns of a stack of layers.
+ *
+ * Every layer is a large disk that grows and shrinks from layer to layer,
+ * with a few random holes, so that pixels become solid and hollow again at
+ * many different heights.
+ */
+static std::vector<IAFramebuffer*> createLayers(IAFDMPrinter *printer, int nLayers,
+                                                IAFramebuffer::Buffers type)
+{
+    uint32_t seed = 12345;
+    auto rnd = [&seed](double lo, double hi) {
+        seed = seed*1664525u + 1013904223u;
+        return lo + (hi-lo)*(seed>>8)/16777216.0;
+    };
+    std::vector<IAFramebuffer*> layers;
+    for (int k=0; k<nLayers; k++) {
+        IAFramebuffer *fb = new IAFramebuffer(printer, type);
+        fb->bindForRendering();
+        fb->fill(0);
+        double c = fb->width()*kPixelSize/2.0;
+        drawDisk(*fb, c, c, 60.0+20.0*sin(k*0.7), 1);
+        for (int h=0; h<3; h++)
+            drawDisk(*fb, rnd(c-50, c+50), rnd(c-50, c+50), rnd(2, 15), 0);
+        fb->unbindFromRendering();
+        layers.push_back(fb);
+    }
+    return layers;
+}
+
+
+/**
+ * Find the infill pixels of one layer the slow way and compare them to a
+ * mask.
+ *
+ * The mask contains the pixels that are solid in the n layers below and the
+ * n layers above. Layer i itself is not checked; slicing combines the mask
+ * with the core of layer i.
+ *
+ * \return number of pixels that differ
+ */
+static size_t compareInfill(std::vector<IAFramebuffer*> const& ref, int i, int n,
+                            IAFramebuffer &mask)
+{
+    potrace_bitmap_t *m = mask.pBitmap;
+    size_t nBad = 0;
+    bool allLayers = (i-n>=0 && i+n<(int)ref.size());
+    for (int y=0; y<m->h; y++) {
+        for (int x=0; x<m->w; x++) {
+            bool solid = allLayers;
+            for (int k=i-n; solid && k<=i+n; k++)
+                if (k!=i) solid = BM_UGET(ref[k]->pBitmap, x, y);
+            if (solid!=(bool)BM_UGET(m, x, y)) nBad++;
+        }
+    }
+    return nBad;
+}
+
+
+/**
+ * Create infill masks for a sequence of layers, the way slicing does.
+ *
+ * \param cores the layers that are given to the counter
+ * \param ref the same layers as BITMAP buffers
+ * \param order create masks for these layers, in this order
+ * \param n number of lids
+ */
+static void checkMasks(IAFDMPrinter *printer, std::vector<IAFramebuffer*> const& cores,
+                       std::vector<IAFramebuffer*> const& ref,
+                       std::vector<int> const& order, int n)
+{
+    IASolidLayerCounter c;
+    IAFramebuffer mask(printer, IAFramebuffer::BITMAP);
+    IAFramebuffer empty(printer, IAFramebuffer::BITMAP);
+    empty.bindForRendering();
+    empty.fill(0);
+    empty.unbindFromRendering();
+    int nLayers = (int)cores.size(), nRestart = 0, nBadLayers = 0;
+    size_t nInfill = 0;
+    for (int i: order) {
+        if (!c.canCreateInfillMask(i, n)) {
+            c.restart(std::max(0, i-n), n);
+            nRestart++;
+        }
+        while (c.nextLayer()<=i+n) {
+            int j = c.nextLayer();
+            c.addLayer(j<nLayers ? cores[j] : &empty);
+        }
+        c.createInfillMask(i, mask);
+        nInfill += mask.countPixels();
+        size_t nBad = compareInfill(ref, i, n, mask);
+        if (nBad) {
+            printf("  layer %d, %d lids: %zu pixels differ\n", i, n, nBad);
+            nBadLayers++;
+        }
+    }
+    printf("%d lids, %zu layers, %d restarts, %zu infill pixels\n",
+           n, order.size(), nRestart, nInfill);
+    IA_TEST_CHECK(nInfill>0);
+    IA_TEST_CHECK(nBadLayers==0);
+}
+
+
+/**
+ * The infill masks of IASolidLayerCounter must match a brute force check of
+ * all layers above and below, when sliding up layer by layer and when
+ * jumping around the stack.
+ */
+int main(int argc, char **argv)
+{
+    IAFDMPrinter *printer = ia_test_printer(kPixelSize);
+    const int nLayers = 30;
+    std::vector<IAFramebuffer*> ref = createLayers(printer, nLayers, IAFramebuffer::BITMAP);
+    std::vector<IAFramebuffer*> tiled = createLayers(printer, nLayers, IAFramebuffer::TILED);
+
+    std::vector<int> up, jumps = { 5, 6, 7, 20, 21, 3, 4, 29, 0, 1, 15, 12, 13 };
+    for (int i=0; i<nLayers; i++) up.push_back(i);
+
+    for (int n: { 1, 2, 3, 5 }) {
+        checkMasks(printer, ref, ref, up, n);
+        checkMasks(printer, ref, ref, jumps, n);
+        checkMasks(printer, tiled, ref, up, n);
+    }
+
+    for (auto fb: ref) delete fb;
+    for (auto fb: tiled) delete fb;
+    return ia_test_result("solid_layer_counter_test");
+}
@@ -0,0 +1,88 @@
+//
+//  IATestStripePattern.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "opengl/IAStripePattern.h"
+#include "potrace/bitmap.h"
+
+
+/**
+ * Check the word masks of a pattern against a pixel by pixel reference.
+ *
+ * \param angle, width, period the pattern
+ *
+ * \return number of words that differ
+ */
+static int checkPattern(IAStripePattern::Angle angle, int width, int period)
+{
+    IAStripePattern pattern(angle, width, period);
+    const int nWords = 5;
+    int nBad = 0;
+    uint64_t seed = (uint64_t)(angle*7919 + width*31 + period);
+    for (int y=0; y<70; y+=3) {
+        for (int w=0; w<4; w++) {
+            for (int xFirst: { 0, 1, 63, 64, 100, 200, 1000 }) {
+                potrace_word src[nWords], dst[nWords];
+                for (int i=0; i<nWords; i++) {
+                    seed = seed*6364136223846793005ULL + 1442695040888963407ULL;
+                    src[i] = dst[i] = (potrace_word)(seed>>(64-BM_WORDBITS));
+                }
+                pattern.apply(dst, w, nWords, y, xFirst);
+                for (int i=0; i<nWords; i++) {
+                    potrace_word expected = src[i];
+                    for (int j=0; j<BM_WORDBITS; j++) {
+                        int x = (w+i)*BM_WORDBITS + j, u = 0;
+                        switch (angle) {
+                            case IAStripePattern::kAngle0: u = y; break;
+                            case IAStripePattern::kAngle45: u = x-y; break;
+                            case IAStripePattern::kAngle90: u = x; break;
+                            case IAStripePattern::kAngle135: u = x+y; break;
+                        }
+                        u = ((u % period) + period) % period;
+                        if (x>=xFirst && u<width)
+                            expected &= ~bm_mask(j);
+                    }
+                    if (dst[i]!=expected) nBad++;
+                }
+            }
+        }
+    }
+    return nBad;
+}
+
+
+/**
+ * IAStripePattern must clear exactly the pixels that are under a stripe and
+ * right of xFirst, for all angles and for periods shorter and longer than
+ * a word.
+ */
+int main(int argc, char **argv)
+{
+    IAStripePattern::Angle angles[] = {
+        IAStripePattern::kAngle0, IAStripePattern::kAngle45,
+        IAStripePattern::kAngle90, IAStripePattern::kAngle135
+    };
+    struct { int width, period; } sizes[] = {
+        { 0, 1 }, { 1, 1 }, { 1, 2 }, { 3, 7 }, { 5, 10 }, { 0, 10 }, { 10, 10 },
+        { 20, 63 }, { 32, 64 }, { 40, 65 }, { 50, 100 }, { 99, 100 }, { 150, 300 }
+    };
+    for (auto angle: angles) {
+        for (auto s: sizes) {
+            int nBad = checkPattern(angle, s.width, s.period);
+            if (nBad)
+                printf("angle %d, width %d, period %d: %d words differ\n",
+                       (int)angle, s.width, s.period, nBad);
+            IA_TEST_CHECK(nBad==0);
+        }
+    }
+
+    IAStripePattern p(IAStripePattern::kAngle45, 3, 0);
+    IA_TEST_CHECK(p.period()==1);
+
+    return ia_test_result("stripe_pattern_test");
+}
@@ -0,0 +1,140 @@
+//
+//  IATestStripesToolpath.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "opengl/IAFramebuffer.h"
+#include "potrace/bitmap.h"
+#include "printer/IAFDMPrinter.h"
+#include "toolpath/IAToolpath.h"
+
+#include <math.h>
+#include <algorithm>
+
+
+/// pixel size of the test printer in mm
+static const double kPixelSize = 0.1;
+
+
+/**
+ * Draw a star with a hole, and a comb whose teeth are about as far apart as
+ * the infill lines, so that zigzags must not jump from tooth to tooth.
+ */
+static void drawShapes(IAFramebuffer &fb)
+{
+    fb.bindForRendering();
+    fb.fill(0);
+    fb.beginComplexPolygon();
+    for (int i=0; i<14; i++) {
+        double a = 2.0*M_PI*i/14, r = (i&1) ? 15.0 : 35.0;
+        fb.addPoint(70.0+r*cos(a), 70.0+r*sin(a));
+    }
+    fb.addGap();
+    for (int i=0; i<20; i++) {
+        double a = -2.0*M_PI*i/20;
+        fb.addPoint(70.0+8.0*cos(a), 70.0+8.0*sin(a));
+    }
+    fb.endComplexPolygon(1);
+
+    fb.beginComplexPolygon();
+    fb.addPoint(120.0, 120.0);
+    fb.addPoint(180.0, 120.0);
+    for (int t=0; t<12; t++) {
+        double x = 180.0-5.0*t;
+        fb.addPoint(x, 160.0);
+        fb.addPoint(x-2.5, 160.0);
+        fb.addPoint(x-2.5, 125.0);
+        fb.addPoint(x-5.0, 125.0);
+    }
+    fb.endComplexPolygon(1);
+    fb.unbindFromRendering();
+}
+
+
+/**
+ * Check the zigzags of one layer.
+ *
+ * \param fb the buffer with the area to fill
+ * \param ref a BITMAP copy of the area, to look up pixels
+ * \param i layer index, sets the direction of the lines
+ * \param w distance between lines in mm
+ */
+static void checkStripes(IAFramebuffer &fb, IAFramebuffer &ref, int i, double w)
+{
+    IAToolpathListSP tp = fb.toolpathFromStripes(0.2, i, w);
+    IA_TEST_CHECK(tp!=nullptr);
+    std::vector<IAVector3d> seg = ia_test_motions(tp.get());
+
+    auto isSet = [&ref](int x, int y)->bool {
+        if (x<0 || y<0 || x>=ref.width() || y>=ref.height()) return false;
+        return BM_UGET(ref.pBitmap, x, y);
+    };
+    // distance in pixels from a point to the nearest set pixel, up to 3
+    auto distanceToArea = [&](IAVector3d const& p)->double {
+        int px = (int)floor(p.x()), py = (int)floor(p.y());
+        double best = 3.0;
+        for (int v=py-3; v<=py+3; v++) {
+            for (int h=px-3; h<=px+3; h++) {
+                if (!isSet(h, v)) continue;
+                double ex = std::max(0.0, std::max(h-p.x(), p.x()-(h+1)));
+                double ey = std::max(0.0, std::max(v-p.y(), p.y()-(v+1)));
+                best = std::min(best, sqrt(ex*ex+ey*ey));
+            }
+        }
+        return best;
+    };
+
+    // every line starts and ends on a set pixel, and every point of a line
+    // or of a link between lines is inside the area, or on its border
+    size_t nEndOutside = 0;
+    double maxDistance = 0.0, lineLength = 0.0;
+    for (size_t j=0; j+1<seg.size(); j+=2) {
+        IAVector3d a = seg[j]*(1.0/kPixelSize), b = seg[j+1]*(1.0/kPixelSize);
+        if (!isSet((int)floor(a.x()), (int)floor(a.y()))) nEndOutside++;
+        if (!isSet((int)floor(b.x()), (int)floor(b.y()))) nEndOutside++;
+        double dx = b.x()-a.x(), dy = b.y()-a.y(), d = sqrt(dx*dx+dy*dy);
+        int n = (int)ceil(d*4.0);
+        for (int t=1; t<n; t++)
+            maxDistance = std::max(maxDistance, distanceToArea(a + (b-a)*((double)t/n)));
+        // links between lines are not diagonal
+        if (fabs(fabs(dx)-fabs(dy))<0.01)
+            lineLength += d*kPixelSize;
+    }
+
+    // the lines are w apart, so they cover about the whole area
+    double area = ref.countPixels()*kPixelSize*kPixelSize;
+    double coverage = lineLength*w/area;
+    printf("layer %d, w %.1f mm: %zu moves, %.2f of the area, "
+           "%zu ends outside, %.2f pixels max distance\n",
+           i, w, seg.size()/2, coverage, nEndOutside, maxDistance);
+    IA_TEST_CHECK(nEndOutside==0);
+    IA_TEST_CHECK(maxDistance<1e-3);
+    IA_TEST_CHECK(coverage>0.85 && coverage<1.15);
+}
+
+
+/**
+ * Zigzag infill lines taken from the bitmap, and the links between them, must
+ * stay inside the area they fill.
+ */
+int main(int argc, char **argv)
+{
+    IAFDMPrinter *printer = ia_test_printer(kPixelSize);
+    IAFramebuffer ref(printer, IAFramebuffer::BITMAP);
+    drawShapes(ref);
+    IAFramebuffer tiled(&ref, IAFramebuffer::TILED);
+
+    for (double w: { 0.4, 1.0, 3.0 }) {
+        for (int i: { 0, 1 }) {
+            IAFramebuffer fb(&ref);
+            checkStripes(fb, ref, i, w);
+            IAFramebuffer fbTiled(&tiled);
+            checkStripes(fbTiled, ref, i, w);
+        }
+    }
+    return ia_test_result("stripes_toolpath_test");
+}
@@ -0,0 +1,127 @@
+//
+//  IATestSupportMap.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "geometry/IAMesh.h"
+#include "geometry/IASupportMap.h"
+#include "opengl/IAFramebuffer.h"
+#include "opengl/IARunLengthBitmap.h"
+#include "printer/IAFDMPrinter.h"
+#include "potrace/bitmap.h"
+
+#include <math.h>
+
+
+/// pixel size of the test printer in mm
+static const double kPixelSize = 0.5;
+
+/// the layer masks are widened by this much above and below a layer, in mm
+static const double kGap = 0.2;
+
+
+/**
+ * Check the support mask of one layer.
+ *
+ * \param map the support map of the mesh
+ * \param mesh the mesh, to convert its coordinates into pixels
+ * \param printer the printer that sets the raster
+ * \param z height of the layer in mm
+ * \param nExpected the number of support pixels of the layer
+ * \param probes x and y in mesh coordinates, and 1 if the point needs support
+ */
+static void checkLayer(IASupportMap &map, IAMesh *mesh, IAFDMPrinter *printer, double z,
+                       size_t nExpected, std::vector<std::vector<double>> const& probes)
+{
+    IARunLengthBitmap *mask = map.createLayerMask(z-kGap, z+kGap);
+    size_t n = mask ? mask->countPixels() : 0;
+    printf("layer at %.1f mm: %zu support pixels, %zu expected\n", z, n, nExpected);
+    IA_TEST_CHECK(n==nExpected);
+    if (!mask) return;
+
+    IAFramebuffer fb(printer, IAFramebuffer::BITMAP);
+    fb.logicOr(*mask);
+    delete mask;
+    IAVector3d pos = mesh->position();
+    for (auto const& p: probes) {
+        int x = (int)floor((p[0]+pos.x())/kPixelSize);
+        int y = (int)floor((p[1]+pos.y())/kPixelSize);
+        bool set = BM_UGET(fb.pBitmap, x, y);
+        if (set!=(p[2]!=0.0))
+            printf("  at %.1f, %.1f, %.1f: expected %d\n", p[0], p[1], z, (int)p[2]);
+        IA_TEST_CHECK(set==(p[2]!=0.0));
+    }
+}
+
+
+/**
+ * Two shelves float above each other, and the upper one is wider than the
+ * lower one. A foot keeps the model on the print bed.
+ *
+ * The lower shelf needs support from the bed. The upper shelf needs support
+ * from the top of the lower shelf, and from the bed where it reaches past it.
+ */
+static void testStackedOverhangs(IAFDMPrinter *printer)
+{
+    std::vector<uint8_t> stl;
+    double footLo[3] = { -30.0, 30.0, 0.0 }, footHi[3] = { -20.0, 40.0, 45.0 };
+    double lowLo[3] = { -10.0, -10.0, 20.0 }, lowHi[3] = { 10.0, 10.0, 25.0 };
+    double highLo[3] = { -10.0, -10.0, 40.0 }, highHi[3] = { 20.0, 10.0, 45.0 };
+    ia_test_add_box_stl(stl, footLo, footHi);
+    ia_test_add_box_stl(stl, lowLo, lowHi);
+    ia_test_add_box_stl(stl, highLo, highHi);
+    IAMesh *mesh = ia_test_load_stl(stl, printer);
+
+    IASupportMap map(printer, IAFramebuffer::FINE);
+    map.build(mesh, 50.0, 0.6);
+    IA_TEST_CHECK(!map.empty());
+    IA_TEST_CHECK(map.isBuiltFor(mesh, 50.0, 0.6));
+
+    // the boxes are centered on the bed as a whole, so their edges may fall
+    // on pixel centers; count the pixels of an area the way the mask does
+    IAVector3d pos = mesh->position();
+    auto pixels = [&](double x0, double y0, double x1, double y1)->size_t {
+        auto col = [](double v) { return (long)ceil(v/kPixelSize-0.5); };
+        return (size_t)(col(x1+pos.x())-col(x0+pos.x()))
+             * (size_t)(col(y1+pos.y())-col(y0+pos.y()));
+    };
+    size_t nLow = pixels(-10, -10, 10, 10), nHigh = pixels(-10, -10, 20, 10);
+    size_t nPast = nHigh-nLow;
+
+    std::vector<double> center = { 0.0, 0.0 }, past = { 15.0, 0.0 }, foot = { -25.0, 35.0 };
+    auto probe = [](std::vector<double> p, int set) { p.push_back(set); return p; };
+
+    // under both shelves
+    checkLayer(map, mesh, printer, 10.0, nHigh,
+               { probe(center, 1), probe(past, 1), probe(foot, 0) });
+    // inside the lower shelf, only the wider part of the upper shelf
+    checkLayer(map, mesh, printer, 22.5, nPast,
+               { probe(center, 0), probe(past, 1) });
+    // between the shelves
+    checkLayer(map, mesh, printer, 30.0, nHigh,
+               { probe(center, 1), probe(past, 1), probe(foot, 0) });
+    // right under the shelves, within the gap
+    checkLayer(map, mesh, printer, 19.9, nPast, { probe(center, 0) });
+    checkLayer(map, mesh, printer, 39.9, 0, { });
+    // inside the upper shelf and above the model
+    checkLayer(map, mesh, printer, 42.5, 0, { });
+    checkLayer(map, mesh, printer, 50.0, 0, { });
+
+    delete mesh;
+}
+
+
+/**
+ * Every overhang of a mesh must get support, including overhangs that are
+ * below other overhangs.
+ */
+int main(int argc, char **argv)
+{
+    IAFDMPrinter *printer = ia_test_printer(kPixelSize);
+    testStackedOverhangs(printer);
+    return ia_test_result("support_map_test");
+}
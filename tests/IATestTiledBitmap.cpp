@@ -0,0 +1,172 @@
+//
+//  IATestTiledBitmap.cpp
+//
+//  Copyright (c) 2013-2018 Matthias Melcher. All rights reserved.
+//
+
+
+#include "IATest.h"
+
+#include "opengl/IAFramebuffer.h"
+#include "opengl/IATiledBitmap.h"
+#include "potrace/bitmap.h"
+#include "printer/IAFDMPrinter.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+
+/// pixel size of the test printer in mm
+static const double kPixelSize = 0.1;
+
+
+/**
+ * Compare a tiled bitmap to a plain array of pixels.
+ *
+ * \return the number of pixels that differ
+ */
+static size_t compare(IATiledBitmap const& tb, std::vector<char> const& ref)
+{
+    size_t n = 0;
+    for (int y=0; y<tb.height(); y++)
+        for (int x=0; x<tb.width(); x++)
+            if (tb.get(x, y)!=(ref[(size_t)y*tb.width()+x]!=0)) n++;
+    return n;
+}
+
+
+/**
+ * Lines and pixels across tile borders must land in the right tiles, and
+ * only the tiles that hold set pixels may be allocated.
+ */
+static void testTiles()
+{
+    // not a multiple of the tile size in either direction
+    const int w = 3*IATiledBitmap::kTileWords*BM_WORDBITS+37;
+    const int h = 2*IATiledBitmap::kTileRows+11;
+    IATiledBitmap tb(w, h);
+    std::vector<char> ref((size_t)w*h, 0);
+    IA_TEST_CHECK(tb.columns()==4 && tb.rows()==3);
+    IA_TEST_CHECK(tb.numTiles()==0);
+
+    // a line across all columns of tiles in the first row of tiles
+    tb.hline(-10, w+10, 5, 1);
+    for (int x=0; x<w; x++) ref[(size_t)5*w+x] = 1;
+    IA_TEST_CHECK(tb.numTiles()==4);
+    // clearing never allocates
+    tb.hline(0, w, 300, 0);
+    tb.put(w-1, h-1, 0);
+    IA_TEST_CHECK(tb.numTiles()==4);
+    // a pixel in the corner of the last tile
+    tb.put(w-1, h-1, 1);
+    ref[(size_t)(h-1)*w+w-1] = 1;
+    IA_TEST_CHECK(tb.numTiles()==5);
+    // short lines that start and end within words and tiles
+    srand(1);
+    for (int i=0; i<2000; i++) {
+        int y = rand()%h, x1 = rand()%w, x2 = x1+rand()%300, c = rand()%3 ? 1 : 0;
+        tb.hline(x1, x2, y, c);
+        for (int x=x1; x<x2 && x<w; x++) ref[(size_t)y*w+x] = (char)c;
+    }
+    IA_TEST_CHECK(compare(tb, ref)==0);
+
+    IATiledBitmap copy(tb);
+    IA_TEST_CHECK(copy.numTiles()==tb.numTiles());
+    IA_TEST_CHECK(compare(copy, ref)==0);
+
+    // bits past the right and bottom edge stay clear
+    tb.fill(1);
+    IA_TEST_CHECK(tb.numTiles()==(size_t)tb.columns()*tb.rows());
+    size_t nBits = 0;
+    for (int ty=0; ty<tb.rows(); ty++)
+        for (int tx=0; tx<tb.columns(); tx++)
+            for (int i=0; i<IATiledBitmap::kTileSize; i++)
+                for (potrace_word m = tb.tile(tx, ty)[i]; m; m &= m-1) nBits++;
+    IA_TEST_CHECK(nBits==(size_t)w*h);
+    tb.fill(0);
+    IA_TEST_CHECK(tb.numTiles()==0 && tb.memoryUsed()<copy.memoryUsed());
+}
+
+
+/**
+ * Draw a few shapes that cover parts of several tiles.
+ */
+static void drawShapes(IAFramebuffer &fb)
+{
+    fb.bindForRendering();
+    fb.fill(0);
+    fb.beginComplexPolygon();
+    for (int i=0; i<14; i++) {
+        double a = 2.0*M_PI*i/14, r = (i&1) ? 15.0 : 35.0;
+        fb.addPoint(70.0+r*cos(a), 70.0+r*sin(a));
+    }
+    fb.addGap();
+    for (int i=0; i<20; i++) {
+        double a = -2.0*M_PI*i/20;
+        fb.addPoint(70.0+8.0*cos(a), 70.0+8.0*sin(a));
+    }
+    fb.endComplexPolygon(1);
+    fb.beginComplexPolygon();
+    fb.addPoint(150.0, 25.6);
+    fb.addPoint(151.3, 25.6);
+    fb.addPoint(151.3, 180.0);
+    fb.addPoint(150.0, 180.0);
+    fb.endComplexPolygon(1);
+    fb.unbindFromRendering();
+}
+
+
+/**
+ * Converting between BITMAP and TILED buffers must keep every pixel, and
+ * both must count the same pixels.
+ */
+static void testConversion(IAFDMPrinter *printer)
+{
+    IAFramebuffer bitmap(printer, IAFramebuffer::BITMAP);
+    drawShapes(bitmap);
+    IAFramebuffer drawn(printer, IAFramebuffer::TILED);
+    drawShapes(drawn);
+    IAFramebuffer tiled(&bitmap, IAFramebuffer::TILED);
+    IAFramebuffer back(&tiled, IAFramebuffer::BITMAP);
+
+    size_t n = bitmap.countPixels();
+    IA_TEST_CHECK(n>0);
+    IA_TEST_CHECK(drawn.countPixels()==n);
+    IA_TEST_CHECK(tiled.countPixels()==n);
+    IA_TEST_CHECK(back.countPixels()==n);
+    size_t nDiff = 0;
+    for (int y=0; y<bitmap.height(); y++) {
+        for (int x=0; x<bitmap.width(); x++) {
+            bool c = BM_UGET(bitmap.pBitmap, x, y)!=0;
+            if (tiled.pTiles->get(x, y)!=c || drawn.pTiles->get(x, y)!=c
+                || (BM_UGET(back.pBitmap, x, y)!=0)!=c)
+                nDiff++;
+        }
+    }
+    printf("conversion: %zu pixels, %zu differ, %zu of %d tiles, "
+           "%zu bytes tiled, %zu bytes dense\n", n, nDiff, tiled.pTiles->numTiles(),
+           tiled.pTiles->columns()*tiled.pTiles->rows(), tiled.memoryUsed(),
+           bitmap.memoryUsed());
+    IA_TEST_CHECK(nDiff==0);
+    IA_TEST_CHECK(tiled.memoryUsed()<bitmap.memoryUsed());
+
+    // the tiled buffer combines with the dense one like another dense one
+    IAFramebuffer x(&bitmap);
+    x.logicXor(&tiled);
+    IA_TEST_CHECK(x.countPixels()==0);
+    tiled.logicXor(&bitmap);
+    IA_TEST_CHECK(tiled.countPixels()==0);
+}
+
+
+/**
+ * IATiledBitmap must hold the same pixels as a dense bitmap, and only
+ * allocate the tiles that are needed.
+ */
+int main(int argc, char **argv)
+{
+    IAFDMPrinter *printer = ia_test_printer(kPixelSize);
+    testTiles();
+    testConversion(printer);
+    return ia_test_result("tiled_bitmap_test");
+}